@@ -0,0 +1,264 @@
+/*
+ * alloc.c
+ * Allocation tracking for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file implements the tracked allocation calls. Each block carries a
+ * small header in front of it with its size and site, so free knows what
+ * to take off the totals. Counters and the site table sit behind one lock:
+ * this is a measuring build, not a fast one.
+ */
+
+/* This file calls the real allocator */
+#define ALLOC_IMPLEMENTATION
+
+#include <threads.h>
+
+#include "ccrypt.h"
+#include "alloc.h"
+
+#ifdef CCRYPT_ALLOC_TRACKING
+
+#define ALLOC_MAGIC 0xA110CA7EDB10C4EDULL
+
+/* Keeps the block behind it aligned for any type */
+typedef union {
+    struct {
+        uint64_t magic;
+        size_t size;
+        int site;
+    } info;
+    max_align_t align;
+} alloc_header_t;
+
+typedef struct {
+    const char *file;        /* NULL while the slot is free */
+    int line;
+    uint64_t count;
+    uint64_t bytes;          /* total requested at this site */
+    uint64_t largest;
+    uint64_t live_bytes;
+} alloc_site_t;
+
+static alloc_totals_t totals;
+static alloc_site_t sites[ALLOC_MAX_SITES];
+static int sites_dropped;    /* sites beyond the table, charged to no site */
+static once_flag alloc_once = ONCE_FLAG_INIT;
+static mtx_t alloc_lock;
+
+/* forward declarations for internal helpers */
+static void init_lock(void);
+static int find_site(const char *file, int line);
+static void charge(alloc_header_t *header, size_t size, const char *file, int line);
+static void discharge(const alloc_header_t *header);
+static int cmp_site_bytes(const void *a, const void *b);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+static void init_lock(void)
+{
+    mtx_init(&alloc_lock, mtx_plain);
+}
+
+/* Slot of a file:line site, claiming one if new; -1 when the table is full.
+   Caller holds the lock. */
+static int find_site(const char *file, int line)
+{
+    uintptr_t key = (uintptr_t)file * 31u + (uintptr_t)line;
+    for (int probe = 0; probe < ALLOC_MAX_SITES; ++probe) {
+        alloc_site_t *site = &sites[(key + (uintptr_t)probe) % ALLOC_MAX_SITES];
+        if (!site->file) {
+            site->file = file;
+            site->line = line;
+            return (int)(site - sites);
+        }
+        if (site->line == line && (site->file == file || strcmp(site->file, file) == 0)) {
+            return (int)(site - sites);
+        }
+    }
+    sites_dropped++;
+    return -1;
+}
+
+/* Record a new block; caller holds the lock */
+static void charge(alloc_header_t *header, size_t size, const char *file, int line)
+{
+    header->info.magic = ALLOC_MAGIC;
+    header->info.size = size;
+    header->info.site = find_site(file, line);
+    totals.allocations++;
+    totals.live_bytes += size;
+    totals.live_blocks++;
+    if (totals.live_bytes > totals.peak_bytes) totals.peak_bytes = totals.live_bytes;
+    if (size > totals.largest) totals.largest = size;
+    if (header->info.site >= 0) {
+        alloc_site_t *site = &sites[header->info.site];
+        site->count++;
+        site->bytes += size;
+        site->live_bytes += size;
+        if (size > site->largest) site->largest = size;
+    }
+}
+
+/* Take a block off the totals; caller holds the lock */
+static void discharge(const alloc_header_t *header)
+{
+    totals.live_bytes -= header->info.size;
+    totals.live_blocks--;
+    if (header->info.site >= 0) sites[header->info.site].live_bytes -= header->info.size;
+}
+
+/* Most bytes first */
+static int cmp_site_bytes(const void *a, const void *b)
+{
+    const alloc_site_t *x = (const alloc_site_t *)a;
+    const alloc_site_t *y = (const alloc_site_t *)b;
+    if (x->bytes > y->bytes) return -1;
+    if (x->bytes < y->bytes) return 1;
+    return 0;
+}
+
+/* ========================================================================
+ * ALLOCATION FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Tracked malloc
+ * [Chu-Cheng Yu]
+ */
+void *alloc_tracked_malloc(size_t size, const char *file, int line)
+{
+    if (size > SIZE_MAX - sizeof(alloc_header_t)) return NULL;
+    alloc_header_t *header = (alloc_header_t *)malloc(sizeof(alloc_header_t) + size);
+    if (!header) return NULL;
+    call_once(&alloc_once, init_lock);
+    mtx_lock(&alloc_lock);
+    charge(header, size, file, line);
+    mtx_unlock(&alloc_lock);
+    return header + 1;
+}
+
+/*
+ * Tracked calloc
+ * [Chu-Cheng Yu]
+ */
+void *alloc_tracked_calloc(size_t count, size_t size, const char *file, int line)
+{
+    if (size != 0 && count > (SIZE_MAX - sizeof(alloc_header_t)) / size) return NULL;
+    void *block = alloc_tracked_malloc(count * size, file, line);
+    if (block) memset(block, 0, count * size);
+    return block;
+}
+
+/*
+ * Tracked realloc
+ * [Chu-Cheng Yu]
+ */
+void *alloc_tracked_realloc(void *pointer, size_t size, const char *file, int line)
+{
+    if (!pointer) return alloc_tracked_malloc(size, file, line);
+    if (size > SIZE_MAX - sizeof(alloc_header_t)) return NULL;
+    alloc_header_t *old_header = (alloc_header_t *)pointer - 1;
+    if (old_header->info.magic != ALLOC_MAGIC) {
+        fprintf(stderr, "Warning: realloc of an untracked block at %s:%d\n", file, line);
+        return realloc(pointer, size);
+    }
+
+    /* Taken off first: realloc may move the block and its header with it */
+    call_once(&alloc_once, init_lock);
+    mtx_lock(&alloc_lock);
+    alloc_header_t saved = *old_header;
+    discharge(old_header);
+    mtx_unlock(&alloc_lock);
+
+    alloc_header_t *header = (alloc_header_t *)realloc(old_header, sizeof(alloc_header_t) + size);
+    mtx_lock(&alloc_lock);
+    if (!header) {
+        /* The old block is still there: put it back as it was */
+        totals.live_bytes += saved.info.size;
+        totals.live_blocks++;
+        if (saved.info.site >= 0) sites[saved.info.site].live_bytes += saved.info.size;
+        mtx_unlock(&alloc_lock);
+        return NULL;
+    }
+    charge(header, size, file, line);
+    mtx_unlock(&alloc_lock);
+    return header + 1;
+}
+
+/*
+ * Tracked free
+ * [Chu-Cheng Yu]
+ */
+void alloc_tracked_free(void *pointer)
+{
+    if (!pointer) return;
+    alloc_header_t *header = (alloc_header_t *)pointer - 1;
+    if (header->info.magic != ALLOC_MAGIC) {
+        /* Memory from an untracked allocator (a library call, say) */
+        free(pointer);
+        return;
+    }
+    call_once(&alloc_once, init_lock);
+    mtx_lock(&alloc_lock);
+    discharge(header);
+    totals.frees++;
+    mtx_unlock(&alloc_lock);
+    header->info.magic = 0;    /* a second free is caught as untracked */
+    free(header);
+}
+
+/*
+ * Read the process-wide counters
+ * [Chu-Cheng Yu]
+ */
+void alloc_get_totals(alloc_totals_t *out)
+{
+    if (!out) return;
+    call_once(&alloc_once, init_lock);
+    mtx_lock(&alloc_lock);
+    *out = totals;
+    mtx_unlock(&alloc_lock);
+}
+
+/*
+ * Print the counters and the sites that allocated the most bytes
+ * [Chu-Cheng Yu]
+ */
+void alloc_report(void)
+{
+    static alloc_site_t sorted[ALLOC_MAX_SITES];
+    call_once(&alloc_once, init_lock);
+    mtx_lock(&alloc_lock);
+    alloc_totals_t snapshot = totals;
+    int dropped = sites_dropped;
+    int count = 0;
+    for (int i = 0; i < ALLOC_MAX_SITES; ++i) {
+        if (sites[i].file) sorted[count++] = sites[i];
+    }
+    mtx_unlock(&alloc_lock);
+    qsort(sorted, (size_t)count, sizeof(alloc_site_t), cmp_site_bytes);
+
+    printf("\nAllocation report\n");
+    printf("Allocations: %llu (%llu freed); peak live: %.1f MB; largest: %llu bytes\n",
+           (unsigned long long)snapshot.allocations, (unsigned long long)snapshot.frees,
+           (double)snapshot.peak_bytes / (1024.0 * 1024.0),
+           (unsigned long long)snapshot.largest);
+    printf("Live at exit: %llu bytes in %llu blocks\n",
+           (unsigned long long)snapshot.live_bytes, (unsigned long long)snapshot.live_blocks);
+    printf("%-28s %10s %14s %12s %12s\n", "Site", "Count", "Bytes", "Largest", "Live");
+    for (int i = 0; i < count && i < ALLOC_REPORT_SITES; ++i) {
+        char where[64];
+        const char *name = strrchr(sorted[i].file, '/');
+        snprintf(where, sizeof(where), "%s:%d", name ? name + 1 : sorted[i].file, sorted[i].line);
+        printf("%-28s %10llu %14llu %12llu %12llu\n", where,
+               (unsigned long long)sorted[i].count, (unsigned long long)sorted[i].bytes,
+               (unsigned long long)sorted[i].largest, (unsigned long long)sorted[i].live_bytes);
+    }
+    if (dropped) printf("(%d allocations from sites past the first %d not listed)\n",
+                        dropped, ALLOC_MAX_SITES);
+}
+
+#endif /* CCRYPT_ALLOC_TRACKING */
@@ -0,0 +1,94 @@
+/*
+ * alloc.h
+ * Header file for allocation tracking
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines an opt-in accounting layer over malloc, calloc,
+ * realloc and free. Built with `make ALLOC_TRACKING=1` (which defines
+ * CCRYPT_ALLOC_TRACKING), ccrypt.h includes it in every source file and
+ * the four calls become macros that record the file and line of each
+ * allocation. CCrypt then reports live and peak bytes, allocation counts
+ * and the largest allocation sites at exit. Without the flag nothing
+ * changes.
+ */
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALLOC_MAX_SITES 512       /* distinct file:line sites tracked */
+#define ALLOC_REPORT_SITES 10     /* sites listed in the report */
+
+/*
+ * alloc_totals
+ * Process-wide allocation counters
+ */
+typedef struct {
+    uint64_t allocations;    /* successful malloc, calloc and realloc calls */
+    uint64_t frees;
+    uint64_t live_bytes;
+    uint64_t live_blocks;
+    uint64_t peak_bytes;     /* most live bytes at any one time */
+    uint64_t largest;        /* largest single request */
+} alloc_totals_t;
+
+/* ========================================================================
+ * ALLOCATION FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Tracked malloc
+ * size Bytes to allocate
+ * file Source file of the call
+ * line Source line of the call
+ * The allocation, or NULL on failure
+ */
+void *alloc_tracked_malloc(size_t size, const char *file, int line);
+
+/*
+ * Tracked calloc
+ * count Number of elements
+ * size Size of each element
+ * file Source file of the call
+ * line Source line of the call
+ * The zeroed allocation, or NULL on failure or overflow
+ */
+void *alloc_tracked_calloc(size_t count, size_t size, const char *file, int line);
+
+/*
+ * Tracked realloc; the block is charged to the new site
+ * pointer Block from a tracked allocation, or NULL
+ * size New size in bytes
+ * file Source file of the call
+ * line Source line of the call
+ * The resized allocation, or NULL on failure (pointer is then untouched)
+ */
+void *alloc_tracked_realloc(void *pointer, size_t size, const char *file, int line);
+
+/*
+ * Tracked free
+ * pointer Block from a tracked allocation, or NULL
+ */
+void alloc_tracked_free(void *pointer);
+
+/*
+ * Read the process-wide counters
+ * totals Out parameter to receive the counters
+ */
+void alloc_get_totals(alloc_totals_t *totals);
+
+/*
+ * Print the counters and the sites that allocated the most bytes
+ */
+void alloc_report(void);
+
+#if defined(CCRYPT_ALLOC_TRACKING) && !defined(ALLOC_IMPLEMENTATION)
+#define malloc(size) alloc_tracked_malloc((size), __FILE__, __LINE__)
+#define calloc(count, size) alloc_tracked_calloc((count), (size), __FILE__, __LINE__)
+#define realloc(pointer, size) alloc_tracked_realloc((pointer), (size), __FILE__, __LINE__)
+#define free(pointer) alloc_tracked_free(pointer)
+#endif
+
+#endif /* ALLOC_H */
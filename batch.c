@@ -0,0 +1,902 @@
+/*
+ * batch.c
+ * Parallel batch encryption of directory trees for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file encrypts whole directory trees on a work-stealing thread pool.
+ * Directories, files and segments of large files are all tasks; a worker
+ * runs its own newest task first and steals the oldest task of another
+ * worker when its queue is empty.
+ */
+
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "ccrypt.h"
+#include "batch.h"
+#include "encryption.h"
+#include "library.h"
+#include "checksum.h"
+#include "utils.h"
+#include "ui.h"
+#include "platform.h"
+#include "pack.h"
+#include "stats.h"
+#include "buffer_pool.h"
+
+#define MAX_BATCH_WORKERS 64
+#define BATCH_SEGMENT_CHUNKS 4   /* container chunks per segment task */
+#define BATCH_SEGMENT_BYTES ((long)BATCH_SEGMENT_CHUNKS * CHUNK_SIZE)
+#define BATCH_SPLIT_SIZE (4 * BATCH_SEGMENT_BYTES) /* larger files are split */
+
+typedef enum {
+    TASK_DIRECTORY,          /* list a directory and queue what it holds */
+    TASK_FILE,               /* encrypt one file, or start splitting it */
+    TASK_SEGMENTS            /* help encrypt the segments of a large file */
+} batch_task_kind_t;
+
+struct batch_file_job;
+
+typedef struct {
+    batch_task_kind_t kind;
+    char *path;              /* TASK_DIRECTORY and TASK_FILE, owned by the task */
+    struct batch_file_job *job; /* TASK_SEGMENTS */
+} batch_task_t;
+
+/* Ring buffer of tasks. The owner pushes and pops at the bottom; thieves
+   take from the top, so they get the oldest and usually largest work. */
+typedef struct {
+    batch_task_t *tasks;
+    size_t capacity;         /* power of two */
+    size_t top;
+    size_t bottom;
+    mtx_t lock;              /* only contended while someone is stealing */
+} task_deque_t;
+
+struct batch_pool;
+
+typedef struct {
+    struct batch_pool *pool;
+    task_deque_t deque;
+    int index;
+    unsigned steal_seed;
+} batch_worker_t;
+
+/* State shared by all workers */
+typedef struct batch_pool {
+    batch_worker_t workers[MAX_BATCH_WORKERS];
+    int worker_count;
+    atomic_long pending;     /* tasks queued or running */
+    atomic_ulong next_id;    /* encryption ids handed to files */
+    encryption_library_t *library; /* read-only while workers run */
+    const char *password;
+    const char *key_fingerprint;
+    int use_compression;
+    pack_writer_t *packs;    /* NULL unless small files go to packfiles */
+
+    mtx_t results_lock;      /* guards the results array */
+    file_metadata_t *results;
+    int result_count;
+    int result_capacity;
+
+    atomic_int files_failed;
+    atomic_int files_packed;
+    atomic_int files_skipped;
+    atomic_int directories_failed;
+} batch_pool_t;
+
+/* One encrypted segment, kept until every earlier segment is written */
+typedef struct {
+    unsigned char *plain;    /* BATCH_SEGMENT_BYTES, chunk i at i * CHUNK_SIZE */
+    unsigned char *stored;   /* same layout */
+    uint32_t raw_sizes[BATCH_SEGMENT_CHUNKS];
+    uint32_t stored_sizes[BATCH_SEGMENT_CHUNKS];
+    uint64_t hashes[BATCH_SEGMENT_CHUNKS];
+    int chunk_count;
+} batch_segment_t;
+
+/*
+ * A large file being encrypted by several workers. Segments are claimed in
+ * order from next_segment and encrypted in parallel; the container stream
+ * and its checksums must be written in order, so a finished segment is
+ * parked until the ones before it are out and whoever completes the gap
+ * writes the run. A helper never claims more than window segments ahead of
+ * the writer, which bounds the memory parked.
+ */
+typedef struct batch_file_job {
+    char source_path[MAX_PATH_LENGTH];
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    char encrypted_path[MAX_PATH_LENGTH];
+    unsigned long encryption_id;
+    uint64_t source_size;
+    uint64_t source_mtime_ns;
+    uint64_t chunk_count;
+    uint64_t segment_count;
+    uint64_t window;
+    atomic_ullong next_segment;
+    atomic_int references;   /* helpers still running */
+
+    int synchronised;        /* lock and advanced are initialised */
+    mtx_t lock;              /* guards everything below */
+    cnd_t advanced;          /* signalled when next_write moves or the job fails */
+    FILE *fout;
+    batch_segment_t **parked;
+    uint64_t next_write;
+    uint64_t arrived;
+    uint64_t payload_size;
+    chunk_index_entry_t *index;
+    uint64_t *leaves;
+    container_header_t header;
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    int result;
+#ifdef CCRYPT_STATS
+    stats_file_t stats;      /* stage times summed over every helper */
+#endif
+} batch_file_job_t;
+
+/* forward declarations for internal helpers */
+static int deque_init(task_deque_t *deque);
+static void deque_free(task_deque_t *deque);
+static int push_task(batch_worker_t *worker, batch_task_kind_t kind, const char *path,
+                     batch_file_job_t *job);
+static int pop_task(task_deque_t *deque, batch_task_t *task);
+static int steal_task(batch_worker_t *thief, batch_task_t *task);
+static int push_listed_path(const char *path, int is_directory, void *context);
+static int batch_worker(void *arg);
+static void run_task(batch_worker_t *worker, batch_task_t *task);
+static void run_file_task(batch_worker_t *worker, const char *path);
+static int pack_file(batch_pool_t *pool, const char *path, unsigned long id);
+static int record_result(batch_pool_t *pool, file_metadata_t *metadata, unsigned long id);
+static void record_failure(batch_pool_t *pool, const char *path, int error_code);
+static int start_file_job(batch_worker_t *worker, const char *path, const platform_file_id_t *id,
+                          unsigned long encryption_id, const char *encrypted_filename,
+                          const char *encrypted_path);
+static void run_segments(batch_pool_t *pool, batch_file_job_t *job);
+static int encrypt_segment(batch_pool_t *pool, batch_file_job_t *job, FILE *fin,
+                           uint64_t number, batch_segment_t **segment);
+static void commit_segment(batch_pool_t *pool, batch_file_job_t *job, uint64_t number,
+                           batch_segment_t *segment, int result);
+static int write_segment(batch_file_job_t *job, batch_segment_t *segment, uint64_t number);
+static void finish_file_job(batch_pool_t *pool, batch_file_job_t *job);
+static void free_segment(batch_segment_t *segment);
+static void free_file_job(batch_file_job_t *job);
+static int cmp_result_id(const void *a, const void *b);
+
+/* ========================================================================
+ * TASK QUEUES
+ * ======================================================================== */
+
+static int deque_init(task_deque_t *deque)
+{
+    deque->capacity = 64;
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->tasks = (batch_task_t *)malloc(sizeof(batch_task_t) * deque->capacity);
+    if (!deque->tasks) return ERROR_MEMORY_ALLOCATION;
+    if (mtx_init(&deque->lock, mtx_plain) != thrd_success) {
+        free(deque->tasks);
+        deque->tasks = NULL;
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    return SUCCESS;
+}
+
+static void deque_free(task_deque_t *deque)
+{
+    if (!deque->tasks) return;
+    free(deque->tasks);
+    deque->tasks = NULL;
+    mtx_destroy(&deque->lock);
+}
+
+/* Queue a task on a worker's own deque, growing it when full */
+static int push_task(batch_worker_t *worker, batch_task_kind_t kind, const char *path,
+                     batch_file_job_t *job)
+{
+    batch_task_t task;
+    task.kind = kind;
+    task.path = NULL;
+    task.job = job;
+    if (path) {
+        size_t len = strlen(path) + 1;
+        task.path = (char *)malloc(len);
+        if (!task.path) return ERROR_MEMORY_ALLOCATION;
+        memcpy(task.path, path, len);
+    }
+
+    task_deque_t *deque = &worker->deque;
+    mtx_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        size_t capacity = deque->capacity * 2;
+        batch_task_t *tasks = (batch_task_t *)malloc(sizeof(batch_task_t) * capacity);
+        if (!tasks) {
+            mtx_unlock(&deque->lock);
+            free(task.path);
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        for (size_t i = deque->top; i != deque->bottom; ++i) {
+            tasks[i & (capacity - 1)] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    deque->tasks[deque->bottom & (deque->capacity - 1)] = task;
+    deque->bottom++;
+    /* Counted before the task can be seen so pending never reaches zero early */
+    atomic_fetch_add(&worker->pool->pending, 1);
+    mtx_unlock(&deque->lock);
+    return SUCCESS;
+}
+
+/* Owner side: newest task first, which keeps a directory's files together */
+static int pop_task(task_deque_t *deque, batch_task_t *task)
+{
+    int found = 0;
+    mtx_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom & (deque->capacity - 1)];
+        found = 1;
+    }
+    mtx_unlock(&deque->lock);
+    return found;
+}
+
+/* Thief side: oldest task of the first non-empty victim, starting at random */
+static int steal_task(batch_worker_t *thief, batch_task_t *task)
+{
+    batch_pool_t *pool = thief->pool;
+    thief->steal_seed = thief->steal_seed * 1103515245u + 12345u;
+    int start = (int)((thief->steal_seed >> 16) % (unsigned)pool->worker_count);
+    for (int i = 0; i < pool->worker_count; ++i) {
+        batch_worker_t *victim = &pool->workers[(start + i) % pool->worker_count];
+        if (victim == thief) continue;
+        task_deque_t *deque = &victim->deque;
+        int found = 0;
+        mtx_lock(&deque->lock);
+        if (deque->bottom != deque->top) {
+            *task = deque->tasks[deque->top & (deque->capacity - 1)];
+            deque->top++;
+            found = 1;
+        }
+        mtx_unlock(&deque->lock);
+        if (found) return 1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * WORKERS
+ * ======================================================================== */
+
+/* Directory walk callback: queue subdirectories and source files */
+static int push_listed_path(const char *path, int is_directory, void *context)
+{
+    batch_worker_t *worker = (batch_worker_t *)context;
+    if (!is_directory && is_ccrypt_artifact(path)) return SUCCESS;
+    if (push_task(worker, is_directory ? TASK_DIRECTORY : TASK_FILE, path, NULL) != SUCCESS) {
+        record_failure(worker->pool, path, ERROR_MEMORY_ALLOCATION);
+    }
+    return SUCCESS;
+}
+
+/* Worker thread: run tasks until none are queued or running anywhere */
+static int batch_worker(void *arg)
+{
+    batch_worker_t *self = (batch_worker_t *)arg;
+    batch_pool_t *pool = self->pool;
+    batch_task_t task;
+    while (atomic_load(&pool->pending) > 0) {
+        if (pop_task(&self->deque, &task) || steal_task(self, &task)) {
+            run_task(self, &task);
+            atomic_fetch_sub(&pool->pending, 1);
+        } else {
+            thrd_yield();
+        }
+    }
+    return SUCCESS;
+}
+
+static void run_task(batch_worker_t *worker, batch_task_t *task)
+{
+    switch (task->kind) {
+        case TASK_DIRECTORY:
+            if (platform_list_directory(task->path, push_listed_path, worker) != SUCCESS) {
+                printf("Error: could not read directory '%s'\n", task->path);
+                atomic_fetch_add(&worker->pool->directories_failed, 1);
+            }
+            break;
+        case TASK_FILE:
+            run_file_task(worker, task->path);
+            break;
+        case TASK_SEGMENTS:
+            run_segments(worker->pool, task->job);
+            break;
+    }
+    free(task->path);
+}
+
+/* Encrypt a small file directly; hand a large one to segment helpers */
+static void run_file_task(batch_worker_t *worker, const char *path)
+{
+    batch_pool_t *pool = worker->pool;
+    platform_file_id_t id;
+    if (platform_file_identity(path, &id) != SUCCESS) {
+        record_failure(pool, path, ERROR_FILE_NOT_FOUND);
+        return;
+    }
+    if (id.size == 0) {
+        atomic_fetch_add(&pool->files_skipped, 1);
+        return;
+    }
+
+    unsigned long encryption_id = atomic_fetch_add(&pool->next_id, 1);
+    if (pool->packs && id.size <= PACK_OBJECT_MAX_SIZE) {
+        int packed = pack_file(pool, path, encryption_id);
+        if (packed != SUCCESS) record_failure(pool, path, packed);
+        return;
+    }
+
+    /* Workers name files without consulting each other, and files from
+       different directories can share a base name, so batch names always
+       carry the encryption id; the file itself goes to the fanned-out
+       path of that id, which no other entry can hold */
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    char encrypted_path[MAX_PATH_LENGTH];
+    int result = generate_encrypted_filename(path, encrypted_filename, sizeof(encrypted_filename),
+                                             encryption_id);
+    if (result == SUCCESS) {
+        result = generate_encrypted_path(encryption_id, encrypted_path, sizeof(encrypted_path));
+    }
+    if (result != SUCCESS) {
+        record_failure(pool, path, result);
+        return;
+    }
+
+    if (id.size <= (uint64_t)BATCH_SPLIT_SIZE) {
+        file_metadata_t metadata;
+        result = encrypt_file(path, encrypted_path, pool->password, pool->use_compression,
+                              ENC_XOR, &metadata);
+        if (result == SUCCESS) {
+            set_encrypted_location(&metadata, encrypted_filename, encrypted_path);
+            result = record_result(pool, &metadata, encryption_id);
+        }
+    } else {
+        result = start_file_job(worker, path, &id, encryption_id, encrypted_filename,
+                                encrypted_path);
+    }
+    if (result != SUCCESS) {
+        remove(encrypted_path);
+        record_failure(pool, path, result);
+    }
+}
+
+/* Encrypt a small file in memory and append it to the shared packfile */
+static int pack_file(batch_pool_t *pool, const char *path, unsigned long id)
+{
+    file_metadata_t metadata;
+    unsigned char *object = NULL;
+    size_t length = 0;
+    STATS_FILE(stats);
+    STATS_FILE_BEGIN(stats, STATS_OPERATION_ENCRYPT);
+    int result = pack_encrypt_object(path, pool->password, pool->use_compression, &object,
+                                     &length, &metadata);
+    if (result == SUCCESS) {
+        result = pack_writer_append(pool->packs, object, length, id, &metadata.pack_id,
+                                    &metadata.pack_offset);
+    }
+    free(object);
+    if (result != SUCCESS) return result;
+
+    metadata.pack_length = length;
+    generate_encrypted_filename(path, metadata.encrypted_filename,
+                                sizeof(metadata.encrypted_filename), id);
+    result = record_result(pool, &metadata, id);
+    if (result == SUCCESS) {
+        atomic_fetch_add(&pool->files_packed, 1);
+        STATS_FILE_END(stats, path, metadata.original_size, length);
+    }
+    return result;
+}
+
+/* Keep a finished file for the library update at the end of the batch */
+static int record_result(batch_pool_t *pool, file_metadata_t *metadata, unsigned long id)
+{
+    metadata->encryption_id = id;
+    safe_string_copy(metadata->key_fingerprint, pool->key_fingerprint,
+                     sizeof(metadata->key_fingerprint));
+
+    mtx_lock(&pool->results_lock);
+    if (pool->result_count == pool->result_capacity) {
+        int capacity = pool->result_capacity ? pool->result_capacity * 2 : 256;
+        file_metadata_t *results = (file_metadata_t *)realloc(pool->results,
+                                                              sizeof(file_metadata_t) * (size_t)capacity);
+        if (!results) {
+            mtx_unlock(&pool->results_lock);
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        pool->results = results;
+        pool->result_capacity = capacity;
+    }
+    pool->results[pool->result_count++] = *metadata;
+    mtx_unlock(&pool->results_lock);
+    return SUCCESS;
+}
+
+static void record_failure(batch_pool_t *pool, const char *path, int error_code)
+{
+    printf("Error: could not encrypt '%s' (error %d)\n", path, error_code);
+    atomic_fetch_add(&pool->files_failed, 1);
+    STATS_ERROR(error_code);
+}
+
+/* ========================================================================
+ * LARGE FILES
+ * ======================================================================== */
+
+/*
+ * Set up a split file, queue helpers for the other workers to steal and
+ * start on the segments here
+ */
+static int start_file_job(batch_worker_t *worker, const char *path, const platform_file_id_t *id,
+                          unsigned long encryption_id, const char *encrypted_filename,
+                          const char *encrypted_path)
+{
+    batch_pool_t *pool = worker->pool;
+    batch_file_job_t *job = (batch_file_job_t *)calloc(1, sizeof(batch_file_job_t));
+    if (!job) return ERROR_MEMORY_ALLOCATION;
+    safe_string_copy(job->source_path, path, sizeof(job->source_path));
+    safe_string_copy(job->encrypted_filename, encrypted_filename, sizeof(job->encrypted_filename));
+    safe_string_copy(job->encrypted_path, encrypted_path, sizeof(job->encrypted_path));
+    job->encryption_id = encryption_id;
+    job->source_size = id->size;
+    job->source_mtime_ns = id->mtime_ns;
+    job->chunk_count = (id->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    job->segment_count = (job->chunk_count + BATCH_SEGMENT_CHUNKS - 1) / BATCH_SEGMENT_CHUNKS;
+
+    job->index = (chunk_index_entry_t *)buffer_pool_acquire(sizeof(chunk_index_entry_t) *
+                                                            (size_t)job->chunk_count);
+    job->leaves = (uint64_t *)buffer_pool_acquire(sizeof(uint64_t) * (size_t)job->chunk_count);
+    job->parked = (batch_segment_t **)calloc((size_t)job->segment_count, sizeof(batch_segment_t *));
+    if (!job->index || !job->leaves || !job->parked) {
+        free_file_job(job);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    STATS_FILE_BEGIN(job->stats, STATS_OPERATION_ENCRYPT);
+    job->fout = fopen(encrypted_path, "wb");
+    if (!job->fout) {
+        free_file_job(job);
+        return ERROR_FILE_NOT_FOUND;
+    }
+    if (mtx_init(&job->lock, mtx_plain) != thrd_success) {
+        free_file_job(job);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    if (cnd_init(&job->advanced) != thrd_success) {
+        mtx_destroy(&job->lock);
+        free_file_job(job);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    job->synchronised = 1;
+
+    /* Header is rewritten with the payload size once all chunks are out */
+    memcpy(job->header.signature, CONTAINER_SIGNATURE, sizeof(job->header.signature));
+    job->header.version = CONTAINER_VERSION;
+    job->header.flags = pool->use_compression ? CONTAINER_FLAG_COMPRESSED : 0;
+    job->header.chunk_size = CHUNK_SIZE;
+    job->header.original_size = id->size;
+    fwrite(&job->header, sizeof(job->header), 1, job->fout);
+    checksum_init(&job->plain_state);
+    checksum_init(&job->cipher_state);
+    job->result = SUCCESS;
+
+    uint64_t helpers = (uint64_t)pool->worker_count;
+    if (helpers > job->segment_count) helpers = job->segment_count;
+    job->window = helpers * 2;
+    atomic_init(&job->next_segment, 0);
+    atomic_init(&job->references, (int)helpers);
+    for (uint64_t i = 1; i < helpers; ++i) {
+        if (push_task(worker, TASK_SEGMENTS, NULL, job) != SUCCESS) {
+            atomic_fetch_sub(&job->references, 1); /* fewer helpers, same result */
+        }
+    }
+    run_segments(pool, job);
+    return SUCCESS;
+}
+
+/* Helper: claim and encrypt segments until all are taken */
+static void run_segments(batch_pool_t *pool, batch_file_job_t *job)
+{
+    FILE *fin = fopen(job->source_path, "rb");
+    uint64_t number;
+    while ((number = atomic_fetch_add(&job->next_segment, 1)) < job->segment_count) {
+        /* Wait while too far ahead of the writer; the segments in between
+           are all claimed by running helpers, so the wait always ends */
+        mtx_lock(&job->lock);
+        while (number >= job->next_write + job->window && job->result == SUCCESS) {
+            cnd_wait(&job->advanced, &job->lock);
+        }
+        int result = job->result;
+        mtx_unlock(&job->lock);
+
+        batch_segment_t *segment = NULL;
+        if (result == SUCCESS) {
+            result = fin ? encrypt_segment(pool, job, fin, number, &segment) : ERROR_FILE_NOT_FOUND;
+        }
+        commit_segment(pool, job, number, segment, result);
+    }
+    if (fin) fclose(fin);
+    if (atomic_fetch_sub(&job->references, 1) == 1) {
+        free_file_job(job);
+    }
+}
+
+/* Read and encrypt one segment; chunks are keyed from their plaintext offset */
+static int encrypt_segment(batch_pool_t *pool, batch_file_job_t *job, FILE *fin,
+                           uint64_t number, batch_segment_t **segment)
+{
+    batch_segment_t *s = (batch_segment_t *)calloc(1, sizeof(batch_segment_t));
+    if (!s) return ERROR_MEMORY_ALLOCATION;
+    s->plain = (unsigned char *)buffer_pool_acquire(BATCH_SEGMENT_BYTES);
+    s->stored = (unsigned char *)buffer_pool_acquire(BATCH_SEGMENT_BYTES);
+    if (!s->plain || !s->stored) {
+        free_segment(s);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    uint64_t offset = number * (uint64_t)BATCH_SEGMENT_BYTES;
+    int result = SUCCESS;
+    uint64_t first_chunk = number * BATCH_SEGMENT_CHUNKS;
+    for (int i = 0; i < BATCH_SEGMENT_CHUNKS && first_chunk + (uint64_t)i < job->chunk_count; ++i) {
+        uint64_t chunk_offset = offset + (uint64_t)i * CHUNK_SIZE;
+        size_t expected = CHUNK_SIZE;
+        if (chunk_offset + expected > job->source_size) {
+            expected = (size_t)(job->source_size - chunk_offset);
+        }
+        unsigned char *plain = s->plain + (size_t)i * CHUNK_SIZE;
+        unsigned char *stored = s->stored + (size_t)i * CHUNK_SIZE;
+        STATS_START(read_started);
+        if (platform_read_at(fin, plain, expected, chunk_offset) != SUCCESS) {
+            result = ERROR_FILE_NOT_FOUND;   /* file shrank while reading */
+            break;
+        }
+        STATS_STOP(job->stats, STATS_READ, read_started, expected);
+
+        long stored_size = (long)expected;
+        STATS_START(encrypt_started);
+        if (pool->use_compression) {
+            result = compress_encrypt_chunk(plain, (long)expected, pool->password,
+                                            (long)chunk_offset, stored, &stored_size);
+            STATS_STOP(job->stats, STATS_COMPRESS, encrypt_started, expected);
+        } else {
+            result = encrypt_data_at(plain, (long)expected, pool->password, (long)chunk_offset,
+                                     stored);
+            STATS_STOP(job->stats, STATS_ENCRYPT, encrypt_started, expected);
+        }
+        if (result != SUCCESS) break;
+        s->raw_sizes[i] = (uint32_t)expected;
+        s->stored_sizes[i] = (uint32_t)stored_size;
+        STATS_START(hash_started);
+        s->hashes[i] = checksum_buffer(stored, (size_t)stored_size);
+        STATS_STOP(job->stats, STATS_CHECKSUM, hash_started, stored_size);
+        s->chunk_count = i + 1;
+    }
+    if (result != SUCCESS) {
+        free_segment(s);
+        return result;
+    }
+    *segment = s;
+    return SUCCESS;
+}
+
+/* Park a finished segment and write out every segment now in order */
+static void commit_segment(batch_pool_t *pool, batch_file_job_t *job, uint64_t number,
+                           batch_segment_t *segment, int result)
+{
+    mtx_lock(&job->lock);
+    if (result != SUCCESS && job->result == SUCCESS) job->result = result;
+    job->parked[number] = segment;
+    job->arrived++;
+
+    int advanced = result != SUCCESS;
+    while (job->result == SUCCESS && job->next_write < job->segment_count &&
+           job->parked[job->next_write]) {
+        batch_segment_t *next = job->parked[job->next_write];
+        job->result = write_segment(job, next, job->next_write);
+        free_segment(next);
+        job->parked[job->next_write] = NULL;
+        job->next_write++;
+        advanced = 1;
+    }
+    if (advanced) cnd_broadcast(&job->advanced);
+
+    if (job->arrived == job->segment_count) {
+        finish_file_job(pool, job);
+    }
+    mtx_unlock(&job->lock);
+}
+
+/* Append one segment's chunks to the container; caller holds the lock */
+static int write_segment(batch_file_job_t *job, batch_segment_t *segment, uint64_t number)
+{
+    for (int i = 0; i < segment->chunk_count; ++i) {
+        uint64_t chunk_number = number * BATCH_SEGMENT_CHUNKS + (uint64_t)i;
+        const unsigned char *plain = segment->plain + (size_t)i * CHUNK_SIZE;
+        const unsigned char *stored = segment->stored + (size_t)i * CHUNK_SIZE;
+        STATS_START(checksum_started);
+        checksum_update(&job->plain_state, plain, segment->raw_sizes[i]);
+        checksum_update(&job->cipher_state, stored, segment->stored_sizes[i]);
+        STATS_STOP(job->stats, STATS_CHECKSUM, checksum_started,
+                   (uint64_t)segment->raw_sizes[i] + segment->stored_sizes[i]);
+
+        chunk_index_entry_t *entry = &job->index[chunk_number];
+        entry->offset = sizeof(container_header_t) + job->payload_size +
+                        chunk_number * sizeof(chunk_header_t);
+        entry->raw_size = segment->raw_sizes[i];
+        entry->stored_size = segment->stored_sizes[i];
+        entry->hash = segment->hashes[i];
+        job->leaves[chunk_number] = entry->hash;
+
+        chunk_header_t chunk;
+        chunk.raw_size = segment->raw_sizes[i];
+        chunk.stored_size = segment->stored_sizes[i];
+        STATS_START(write_started);
+        if (fwrite(&chunk, sizeof(chunk), 1, job->fout) != 1 ||
+            fwrite(stored, 1, chunk.stored_size, job->fout) != chunk.stored_size) {
+            return ERROR_ENCRYPTION_FAILED;
+        }
+        STATS_STOP(job->stats, STATS_WRITE, write_started, sizeof(chunk) + chunk.stored_size);
+        job->payload_size += chunk.stored_size;
+    }
+    return SUCCESS;
+}
+
+/* Complete the container once every segment has arrived; caller holds the lock */
+static void finish_file_job(batch_pool_t *pool, batch_file_job_t *job)
+{
+    int result = job->result;
+    if (result == SUCCESS && job->next_write != job->segment_count) {
+        result = ERROR_ENCRYPTION_FAILED;
+    }
+    if (result == SUCCESS) {
+        job->header.plaintext_checksum = checksum_final(&job->plain_state);
+        job->header.ciphertext_checksum = checksum_final(&job->cipher_state);
+        result = finish_container(job->fout, &job->header, job->index, job->leaves,
+                                  job->chunk_count, job->payload_size);
+    }
+    uint64_t stream_size = 0;
+    platform_stream_size(job->fout, &stream_size);
+    long output_size = (long)stream_size;
+    if (fclose(job->fout) != 0 && result == SUCCESS) {
+        result = ERROR_ENCRYPTION_FAILED;
+    }
+    job->fout = NULL;
+
+    if (result == SUCCESS) {
+        file_metadata_t metadata;
+        memset(&metadata, 0, sizeof(metadata));
+        safe_string_copy(metadata.original_filename, job->source_path, sizeof(metadata.original_filename));
+        set_encrypted_location(&metadata, job->encrypted_filename, job->encrypted_path);
+        metadata.is_compressed = pool->use_compression;
+        metadata.original_size = (long)job->source_size;
+        metadata.encrypted_size = output_size;
+        metadata.encryption_method = (int)ENC_XOR;
+        metadata.source_mtime_ns = job->source_mtime_ns;
+        format_checksum(job->header.plaintext_checksum, metadata.checksum, sizeof(metadata.checksum));
+        printf("Encrypted: %s → %s (%ld bytes → %ld bytes, %llu segments)\n", job->source_path,
+               job->encrypted_path, metadata.original_size, output_size,
+               (unsigned long long)job->segment_count);
+        STATS_FILE_END(job->stats, job->source_path, job->source_size, output_size);
+        result = record_result(pool, &metadata, job->encryption_id);
+    }
+    if (result != SUCCESS) {
+        remove(job->encrypted_path);
+        record_failure(pool, job->source_path, result);
+    }
+    job->result = result;
+    cnd_broadcast(&job->advanced);
+}
+
+static void free_segment(batch_segment_t *segment)
+{
+    if (!segment) return;
+    buffer_pool_release(segment->plain, BATCH_SEGMENT_BYTES);
+    buffer_pool_release(segment->stored, BATCH_SEGMENT_BYTES);
+    free(segment);
+}
+
+/* Release a job after its last helper has left */
+static void free_file_job(batch_file_job_t *job)
+{
+    if (job->parked) {
+        for (uint64_t i = 0; i < job->segment_count; ++i) free_segment(job->parked[i]);
+    }
+    if (job->fout) fclose(job->fout);
+    if (job->synchronised) {
+        mtx_destroy(&job->lock);
+        cnd_destroy(&job->advanced);
+    }
+    free(job->parked);
+    buffer_pool_release(job->index, sizeof(chunk_index_entry_t) * (size_t)job->chunk_count);
+    buffer_pool_release(job->leaves, sizeof(uint64_t) * (size_t)job->chunk_count);
+    free(job);
+}
+
+/* Library order follows encryption id, whatever order workers finished in */
+static int cmp_result_id(const void *a, const void *b)
+{
+    const file_metadata_t *x = (const file_metadata_t *)a;
+    const file_metadata_t *y = (const file_metadata_t *)b;
+    if (x->encryption_id < y->encryption_id) return -1;
+    if (x->encryption_id > y->encryption_id) return 1;
+    return 0;
+}
+
+/* ========================================================================
+ * BATCH FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Complete workflow for encrypting a user-specified directory tree
+ * [Chu-Cheng Yu]
+ */
+int encrypt_directory_workflow(encryption_library_t *library)
+{
+    char directory_path[MAX_PATH_LENGTH];
+    char password[MAX_PASSWORD_LENGTH];
+
+    printf("Enter the path to the directory to encrypt: ");
+    if (!fgets(directory_path, sizeof(directory_path), stdin)) {
+        return ERROR_INVALID_PATH;
+    }
+    directory_path[strcspn(directory_path, "\r\n")] = '\0';
+    if (directory_path[0] == '\0') return ERROR_INVALID_PATH;
+
+    int use_compression = get_user_confirmation("Compress before encryption? (y/n): ");
+    int use_packs = get_user_confirmation("Store small files together in packfiles? (y/n): ");
+
+    printf("Enter encryption password: ");
+    if (!fgets(password, sizeof(password), stdin)) {
+        return ERROR_INVALID_PASSWORD;
+    }
+    password[strcspn(password, "\r\n")] = '\0';
+
+    int result = batch_encrypt_directory(library, directory_path, password, use_compression,
+                                         use_packs, 0, NULL);
+    secure_memory_clear(password, sizeof(password));
+    return result;
+}
+
+/*
+ * Encrypt every file under a directory on a work-stealing thread pool
+ * [Chu-Cheng Yu]
+ */
+int batch_encrypt_directory(encryption_library_t *library, const char *directory_path,
+                            const char *password, int use_compression, int use_packs,
+                            int worker_count, batch_report_t *report)
+{
+    if (!library || !directory_path || !password) return ERROR_INVALID_PATH;
+    if (strlen(password) == 0) return ERROR_INVALID_PASSWORD;
+
+    batch_pool_t *pool = (batch_pool_t *)calloc(1, sizeof(batch_pool_t));
+    if (!pool) return ERROR_MEMORY_ALLOCATION;
+
+    if (worker_count <= 0) worker_count = platform_cpu_count();
+    if (worker_count > MAX_BATCH_WORKERS) worker_count = MAX_BATCH_WORKERS;
+    if (worker_count < 1) worker_count = 1;
+
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+    compute_key_fingerprint(password, key_fingerprint, sizeof(key_fingerprint));
+    pool->library = library;
+    pool->password = password;
+    pool->key_fingerprint = key_fingerprint;
+    pool->use_compression = use_compression;
+    pool->worker_count = worker_count;
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->next_id, library->next_id);
+    atomic_init(&pool->files_failed, 0);
+    atomic_init(&pool->files_packed, 0);
+    atomic_init(&pool->files_skipped, 0);
+    atomic_init(&pool->directories_failed, 0);
+
+    int result = mtx_init(&pool->results_lock, mtx_plain) == thrd_success
+                 ? SUCCESS : ERROR_MEMORY_ALLOCATION;
+    pack_writer_t packs;
+    if (result == SUCCESS && use_packs) {
+        result = pack_writer_open(&packs, library);
+        if (result == SUCCESS) pool->packs = &packs;
+    }
+    int initialised = 0;
+    for (; result == SUCCESS && initialised < worker_count; ++initialised) {
+        batch_worker_t *worker = &pool->workers[initialised];
+        worker->pool = pool;
+        worker->index = initialised;
+        worker->steal_seed = 2654435761u * (unsigned)(initialised + 1);
+        result = deque_init(&worker->deque);
+    }
+
+    /* The top level is listed here so an unreadable root fails up front;
+       everything below it is found by the workers */
+    double start = platform_monotonic_seconds();
+    if (result == SUCCESS) {
+        result = platform_list_directory(directory_path, push_listed_path, &pool->workers[0]);
+        if (result != SUCCESS) printf("Error: could not read directory '%s'\n", directory_path);
+    }
+
+    int started = 0;
+    if (result == SUCCESS) {
+        thrd_t threads[MAX_BATCH_WORKERS];
+        for (; started < worker_count; ++started) {
+            if (thrd_create(&threads[started], batch_worker, &pool->workers[started]) != thrd_success) break;
+        }
+        if (started == 0) {
+            pool->worker_count = 1;
+            batch_worker(&pool->workers[0]); /* no threads available: run here */
+        } else {
+            pool->worker_count = started;
+        }
+        for (int i = 0; i < started; ++i) {
+            thrd_join(threads[i], NULL);
+        }
+    }
+
+    /* Tasks left behind by a failed start still own their paths */
+    batch_task_t task;
+    for (int i = 0; i < initialised; ++i) {
+        while (pop_task(&pool->workers[i].deque, &task)) free(task.path);
+        deque_free(&pool->workers[i].deque);
+    }
+
+    /* Packed objects must be on disk before the library points at them */
+    if (pool->packs && pack_writer_close(pool->packs) != SUCCESS && result == SUCCESS) {
+        printf("Error: could not write packfile\n");
+        result = ERROR_PERMISSION_DENIED;
+    }
+
+    /* All results go into the library in one update */
+    batch_report_t totals;
+    memset(&totals, 0, sizeof(totals));
+    if (result == SUCCESS && pool->result_count > 0) {
+        qsort(pool->results, (size_t)pool->result_count, sizeof(file_metadata_t), cmp_result_id);
+        result = add_files_to_library(library, pool->results, pool->result_count);
+        if (result != SUCCESS) {
+            printf("Error: could not add encrypted files to the library\n");
+        }
+    }
+    if (result == SUCCESS) {
+        library->next_id = atomic_load(&pool->next_id);
+    }
+
+    totals.seconds = platform_monotonic_seconds() - start;
+    totals.worker_count = started > 0 ? started : 1;
+    totals.files_encrypted = pool->result_count;
+    totals.files_failed = atomic_load(&pool->files_failed);
+    totals.files_packed = atomic_load(&pool->files_packed);
+    totals.files_skipped = atomic_load(&pool->files_skipped);
+    totals.directories_failed = atomic_load(&pool->directories_failed);
+    for (int i = 0; i < pool->result_count; ++i) {
+        totals.bytes_in += pool->results[i].original_size;
+        totals.bytes_out += pool->results[i].encrypted_size;
+    }
+
+    if (result == SUCCESS) {
+        double mb = (double)totals.bytes_in / (1024.0 * 1024.0);
+        printf("Batch of %s: %d files encrypted (%d packed), %d failed, %d empty skipped, "
+               "%d directories unreadable (%d workers)\n", directory_path, totals.files_encrypted,
+               totals.files_packed, totals.files_failed, totals.files_skipped,
+               totals.directories_failed, totals.worker_count);
+        printf("Encrypted %.1f MB in %.3f s (%.1f MB/s, %.0f files/s)\n", mb, totals.seconds,
+               totals.seconds > 0 ? mb / totals.seconds : 0.0,
+               totals.seconds > 0 ? totals.files_encrypted / totals.seconds : 0.0);
+    }
+
+    free(pool->results);
+    mtx_destroy(&pool->results_lock);
+    free(pool);
+    if (report) *report = totals;
+
+    if (result != SUCCESS) return result;
+    return (totals.files_failed + totals.directories_failed) > 0 ? ERROR_ENCRYPTION_FAILED : SUCCESS;
+}
@@ -0,0 +1,63 @@
+/*
+ * batch.h
+ * Header file for parallel batch encryption of directory trees
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the batch encrypt operation. A pool of worker threads
+ * walks the tree and encrypts the files it finds, each worker keeping its
+ * own queue of tasks and stealing from the others when it runs dry. Large
+ * files are split into segment tasks so several workers share them, small
+ * files can be appended to packfiles instead of getting a file each, and
+ * every result is added to the library in one update at the end.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "ccrypt.h"
+
+/*
+ * batch_report
+ * Totals and throughput for a batch run
+ */
+typedef struct {
+    int files_encrypted;
+    int files_failed;
+    int files_packed;        /* of files_encrypted, those stored in packfiles */
+    int files_skipped;       /* empty files, which have nothing to encrypt */
+    int directories_failed;  /* subdirectories that could not be read */
+    long long bytes_in;
+    long long bytes_out;
+    double seconds;
+    int worker_count;
+} batch_report_t;
+
+/* ========================================================================
+ * BATCH FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Complete workflow for encrypting a user-specified directory tree
+ * library Pointer to the encryption library
+ * SUCCESS on success, or an error code on failure
+ */
+int encrypt_directory_workflow(encryption_library_t *library);
+
+/*
+ * Encrypt every file under a directory on a work-stealing pool of worker
+ * threads, add the results to the library and print a summary
+ * library Pointer to the encryption library
+ * directory_path Root of the tree to encrypt (walked recursively)
+ * password Encryption password
+ * use_compression 1 to compress before encryption, 0 otherwise
+ * use_packs 1 to store files of up to PACK_OBJECT_MAX_SIZE bytes in packfiles
+ * worker_count Number of worker threads (0 picks one per processor)
+ * report Optional pointer to receive the totals
+ * SUCCESS if every file was encrypted, ERROR_ENCRYPTION_FAILED if any
+ * failed, or another error code if the directory cannot be read
+ */
+int batch_encrypt_directory(encryption_library_t *library, const char *directory_path,
+                            const char *password, int use_compression, int use_packs,
+                            int worker_count, batch_report_t *report);
+
+#endif /* BATCH_H */
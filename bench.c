@@ -0,0 +1,468 @@
+/*
+ * bench.c
+ * Benchmark driver for the CCrypt hot paths
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file times the data kernels over a range of buffer sizes and data
+ * shapes, and the library operations over a range of library sizes, and
+ * prints ns/op, MB/s and cycles/byte for each. Built with `make bench`;
+ * `./ccrypt_bench --csv` gives one machine-readable line per measurement.
+ * Inputs come from the seeded corpus generator, so every machine measures
+ * the same bytes.
+ * Usage: ./ccrypt_bench [--csv] [--max-size 64M] [--max-entries 100000]
+ *                       [--min-time 0.1] [--only <name>] [--seed 1]
+ */
+
+#include "ccrypt.h"
+#include "encryption.h"
+#include "library.h"
+#include "utils.h"
+#include "checksum.h"
+#include "checksum_cache.h"
+#include "platform.h"
+#include "corpus.h"
+
+#define BENCH_DIRECTORY "ccrypt_bench.tmp"
+#define BENCH_DATA_FILENAME "bench_data.tmp"
+#define BENCH_PASSWORD "benchmark password"
+#define BENCH_MIN_SIZE (4L * 1024)
+#define BENCH_BUFFER_LIMIT (256L * 1024 * 1024) /* larger sizes run as passes over this */
+#define BENCH_MIN_ENTRIES 1000L
+#define BENCH_LIBRARY_OPS 1000  /* inserts and lookups timed per library size */
+#ifdef _WIN32
+#define BENCH_NULL_DEVICE "NUL"
+#else
+#define BENCH_NULL_DEVICE "/dev/null"
+#endif
+
+/* Command-line settings */
+typedef struct {
+    int csv;
+    long long max_size;
+    long max_entries;
+    double min_time;
+    const char *only;
+    uint64_t seed;
+} bench_options_t;
+
+/* Buffers shared by the kernel benchmarks */
+typedef struct {
+    unsigned char *input;
+    unsigned char *output;
+    unsigned char *compressed;  /* twice the buffer size: RLE can double it */
+    long compressed_size;
+    long buffer_size;           /* bytes of input per kernel call */
+    long long total_size;       /* bytes per operation, a multiple of buffer_size */
+} bench_buffers_t;
+
+/* One kernel: processes the buffers once, returns SUCCESS or an error code */
+typedef int (*bench_kernel_t)(bench_buffers_t *buffers);
+
+/* forward declarations for internal helpers */
+static int parse_options(int argc, char *argv[], bench_options_t *options);
+static long long parse_size(const char *text);
+static void fill_shape(unsigned char *data, long size, corpus_shape_t shape, uint64_t seed);
+static void report(const bench_options_t *options, const char *name, const char *shape,
+                   long long size, const char *unit, long iterations, double seconds,
+                   uint64_t cycles, long long bytes_per_op);
+static int selected(const bench_options_t *options, const char *name);
+static int kernel_encrypt(bench_buffers_t *buffers);
+static int kernel_decrypt(bench_buffers_t *buffers);
+static int kernel_compress(bench_buffers_t *buffers);
+static int kernel_decompress(bench_buffers_t *buffers);
+static int kernel_checksum(bench_buffers_t *buffers);
+static int kernel_file_checksum(bench_buffers_t *buffers);
+static int write_data_file(const bench_buffers_t *buffers);
+static void run_kernel(const bench_options_t *options, const char *name, bench_kernel_t kernel,
+                       bench_buffers_t *buffers, const char *shape);
+static void bench_kernels(const bench_options_t *options);
+static void bench_library(const bench_options_t *options);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Parse the command line; returns SUCCESS, or an error after printing usage */
+static int parse_options(int argc, char *argv[], bench_options_t *options)
+{
+    options->csv = 0;
+    options->max_size = 64LL * 1024 * 1024;
+    options->max_entries = 100000;
+    options->min_time = 0.1;
+    options->only = NULL;
+    options->seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            options->csv = 1;
+        } else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            options->max_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--max-entries") == 0 && i + 1 < argc) {
+            options->max_entries = (long)parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options->min_time = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            options->only = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            printf("Usage: %s [--csv] [--max-size <bytes, 4K-4G>] [--max-entries <n, 1K-10M>]\n"
+                   "          [--min-time <seconds>] [--only <benchmark name>] [--seed <n>]\n",
+                   argv[0]);
+            return ERROR_INVALID_PATH;
+        }
+    }
+    if (options->max_size < BENCH_MIN_SIZE || options->max_entries < BENCH_MIN_ENTRIES ||
+        options->min_time < 0) {
+        printf("Error: sizes start at 4K bytes and 1000 entries\n");
+        return ERROR_INVALID_PATH;
+    }
+    return SUCCESS;
+}
+
+/* "64M" and friends; K, M and G are powers of 1024 */
+static long long parse_size(const char *text)
+{
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024; break;
+        case 'm': case 'M': value *= 1024 * 1024; break;
+        case 'g': case 'G': value *= 1024LL * 1024 * 1024; break;
+        default: break;
+    }
+    return value;
+}
+
+/* Fill a buffer with generated data of the given shape */
+static void fill_shape(unsigned char *data, long size, corpus_shape_t shape, uint64_t seed)
+{
+    corpus_stream_t stream;
+    corpus_stream_init(&stream, shape, seed);
+    corpus_generate(&stream, data, (size_t)size);
+}
+
+/* Print one measurement as a table row or a CSV line */
+static void report(const bench_options_t *options, const char *name, const char *shape,
+                   long long size, const char *unit, long iterations, double seconds,
+                   uint64_t cycles, long long bytes_per_op)
+{
+    double ns_per_op = seconds * 1e9 / (double)iterations;
+    double total_bytes = (double)bytes_per_op * (double)iterations;
+    double mb_per_s = bytes_per_op > 0 && seconds > 0 ? total_bytes / seconds / (1024.0 * 1024.0) : 0;
+    double cycles_per_byte = bytes_per_op > 0 && cycles > 0 ? (double)cycles / total_bytes : 0;
+    if (options->csv) {
+        printf("%s,%s,%lld,%s,%ld,%.1f,%.2f,%.3f\n", name, shape, size, unit, iterations,
+               ns_per_op, mb_per_s, cycles_per_byte);
+    } else {
+        printf("%-16s %-8s %12lld %-7s %10ld %16.1f %10.2f %10.3f\n", name, shape, size, unit,
+               iterations, ns_per_op, mb_per_s, cycles_per_byte);
+    }
+    fflush(stdout);
+}
+
+/* Whether a benchmark was asked for (--only matches a substring of the name) */
+static int selected(const bench_options_t *options, const char *name)
+{
+    return !options->only || strstr(name, options->only) != NULL;
+}
+
+static int kernel_encrypt(bench_buffers_t *buffers)
+{
+    int result = SUCCESS;
+    for (long long done = 0; result == SUCCESS && done < buffers->total_size;
+         done += buffers->buffer_size) {
+        result = encrypt_data_at(buffers->input, buffers->buffer_size, BENCH_PASSWORD,
+                                 (long)done, buffers->output);
+    }
+    return result;
+}
+
+static int kernel_decrypt(bench_buffers_t *buffers)
+{
+    int result = SUCCESS;
+    for (long long done = 0; result == SUCCESS && done < buffers->total_size;
+         done += buffers->buffer_size) {
+        result = decrypt_data_at(buffers->input, buffers->buffer_size, BENCH_PASSWORD,
+                                 (long)done, buffers->output);
+    }
+    return result;
+}
+
+static int kernel_compress(bench_buffers_t *buffers)
+{
+    int result = SUCCESS;
+    for (long long done = 0; result == SUCCESS && done < buffers->total_size;
+         done += buffers->buffer_size) {
+        result = compress_data(buffers->input, buffers->buffer_size, buffers->compressed,
+                               &buffers->compressed_size);
+    }
+    return result;
+}
+
+static int kernel_decompress(bench_buffers_t *buffers)
+{
+    int result = SUCCESS;
+    long output_size;
+    for (long long done = 0; result == SUCCESS && done < buffers->total_size;
+         done += buffers->buffer_size) {
+        result = decompress_data(buffers->compressed, buffers->compressed_size, buffers->output,
+                                 buffers->buffer_size, &output_size);
+    }
+    return result;
+}
+
+static int kernel_checksum(bench_buffers_t *buffers)
+{
+    checksum_state_t state;
+    checksum_init(&state);
+    for (long long done = 0; done < buffers->total_size; done += buffers->buffer_size) {
+        checksum_update(&state, buffers->input, (size_t)buffers->buffer_size);
+    }
+    /* Keep the result observable so the loop is not optimised away */
+    buffers->output[0] = (unsigned char)checksum_final(&state);
+    return SUCCESS;
+}
+
+/* Hash the data file from a warm page cache, bypassing the checksum cache */
+static int kernel_file_checksum(bench_buffers_t *buffers)
+{
+    (void)buffers;
+    platform_file_id_t id;
+    if (platform_file_identity(BENCH_DATA_FILENAME, &id) != SUCCESS) return ERROR_FILE_NOT_FOUND;
+    checksum_cache_invalidate(&id, CHECKSUM_KIND_FILE);
+    char checksum[CHECKSUM_HEX_LENGTH + 1];
+    return calculate_file_checksum(BENCH_DATA_FILENAME, checksum, sizeof(checksum));
+}
+
+/* Write total_size bytes of the input buffer to the data file */
+static int write_data_file(const bench_buffers_t *buffers)
+{
+    FILE *fp = fopen(BENCH_DATA_FILENAME, "wb");
+    if (!fp) return ERROR_PERMISSION_DENIED;
+    int result = SUCCESS;
+    for (long long done = 0; result == SUCCESS && done < buffers->total_size;
+         done += buffers->buffer_size) {
+        if (fwrite(buffers->input, 1, (size_t)buffers->buffer_size, fp) !=
+            (size_t)buffers->buffer_size) {
+            result = ERROR_PERMISSION_DENIED;
+        }
+    }
+    if (fclose(fp) != 0) result = ERROR_PERMISSION_DENIED;
+    return result;
+}
+
+/* Time a kernel until min_time has passed (at least once) and report it */
+static void run_kernel(const bench_options_t *options, const char *name, bench_kernel_t kernel,
+                       bench_buffers_t *buffers, const char *shape)
+{
+    if (!selected(options, name)) return;
+    if (kernel(buffers) != SUCCESS) {   /* warm-up, and a check that it runs at all */
+        printf("Error: %s failed on %s data of %lld bytes\n", name, shape, buffers->total_size);
+        return;
+    }
+    long iterations = 0;
+    double start = platform_monotonic_seconds();
+    uint64_t cycles_start = platform_cycle_counter();
+    double elapsed;
+    do {
+        kernel(buffers);
+        iterations++;
+        elapsed = platform_monotonic_seconds() - start;
+    } while (elapsed < options->min_time);
+    uint64_t cycles = platform_cycle_counter() - cycles_start;
+    report(options, name, shape, buffers->total_size, "bytes", iterations, elapsed, cycles,
+           buffers->total_size);
+}
+
+/* Every kernel on every shape at sizes from 4K up to max_size, by powers of 16 */
+static void bench_kernels(const bench_options_t *options)
+{
+    long limit = options->max_size < BENCH_BUFFER_LIMIT ? (long)options->max_size : BENCH_BUFFER_LIMIT;
+    bench_buffers_t buffers;
+    buffers.input = malloc((size_t)limit);
+    buffers.output = malloc((size_t)limit);
+    buffers.compressed = malloc((size_t)limit * 2);
+    if (!buffers.input || !buffers.output || !buffers.compressed) {
+        printf("Error: could not allocate %ld-byte benchmark buffers\n", limit);
+        free(buffers.input);
+        free(buffers.output);
+        free(buffers.compressed);
+        return;
+    }
+
+    for (long long size = BENCH_MIN_SIZE; size <= options->max_size; size *= 16) {
+        buffers.buffer_size = size < limit ? (long)size : limit;
+        buffers.total_size = size;
+        for (int shape = 0; shape < CORPUS_SHAPE_COUNT; ++shape) {
+            const char *shape_name = corpus_shape_name((corpus_shape_t)shape);
+            fill_shape(buffers.input, buffers.buffer_size, (corpus_shape_t)shape,
+                       corpus_derive_seed(options->seed, (uint64_t)shape));
+            run_kernel(options, "encrypt_data", kernel_encrypt, &buffers, shape_name);
+            run_kernel(options, "decrypt_data", kernel_decrypt, &buffers, shape_name);
+            run_kernel(options, "compress_data", kernel_compress, &buffers, shape_name);
+            /* Data compress_data could not shrink is stored raw, not as RLE */
+            kernel_compress(&buffers);
+            if (buffers.compressed_size < buffers.buffer_size) {
+                run_kernel(options, "decompress_data", kernel_decompress, &buffers,
+                           shape_name);
+            }
+            run_kernel(options, "checksum", kernel_checksum, &buffers, shape_name);
+        }
+        /* Hashing speed does not depend on the data, so one shape is enough */
+        if (selected(options, "file_checksum")) {
+            fill_shape(buffers.input, buffers.buffer_size, CORPUS_RANDOM,
+                       corpus_derive_seed(options->seed, CORPUS_RANDOM));
+            if (write_data_file(&buffers) == SUCCESS) {
+                run_kernel(options, "file_checksum", kernel_file_checksum, &buffers,
+                           corpus_shape_name(CORPUS_RANDOM));
+            } else {
+                printf("Error: could not write %lld-byte data file\n", size);
+            }
+            remove(BENCH_DATA_FILENAME);
+        }
+    }
+    free(buffers.input);
+    free(buffers.output);
+    free(buffers.compressed);
+}
+
+/* Library operations at 1000 entries up to max_entries, by powers of 10 */
+static void bench_library(const bench_options_t *options)
+{
+    for (long entries = BENCH_MIN_ENTRIES; entries <= options->max_entries; entries *= 10) {
+        encryption_library_t library;
+        if (corpus_build_library(&library, entries,
+                                 corpus_derive_seed(options->seed, (uint64_t)entries)) != SUCCESS) {
+            printf("Error: could not build a library of %ld entries\n", entries);
+            return;
+        }
+
+        if (selected(options, "library_insert")) {
+            /* Cost of one more entry in a library this size */
+            uint64_t state = corpus_derive_seed(options->seed, 7);
+            file_metadata_t extra;
+            double start = platform_monotonic_seconds();
+            uint64_t cycles_start = platform_cycle_counter();
+            for (int i = 0; i < BENCH_LIBRARY_OPS; ++i) {
+                corpus_make_entry(&extra, library.next_id++, &state);
+                add_file_to_library(&library, &extra);
+            }
+            uint64_t cycles = platform_cycle_counter() - cycles_start;
+            report(options, "library_insert", "-", entries, "entries", BENCH_LIBRARY_OPS,
+                   platform_monotonic_seconds() - start, cycles, 0);
+        }
+
+        if (selected(options, "library_lookup")) {
+            uint64_t state = corpus_derive_seed(options->seed, 11);
+            char name[MAX_FILENAME_LENGTH];
+            int found = 0;
+            double start = platform_monotonic_seconds();
+            uint64_t cycles_start = platform_cycle_counter();
+            for (int i = 0; i < BENCH_LIBRARY_OPS; ++i) {
+                snprintf(name, sizeof(name), "report-%lu.ccrypt",
+                         1 + (unsigned long)(corpus_random(&state) % (uint64_t)entries));
+                found += find_library_entry_by_encrypted_name(&library, name) != NULL;
+            }
+            uint64_t cycles = platform_cycle_counter() - cycles_start;
+            report(options, "library_lookup", "-", entries, "entries", BENCH_LIBRARY_OPS,
+                   platform_monotonic_seconds() - start, cycles, 0);
+            if (found != BENCH_LIBRARY_OPS) printf("Error: library lookup missed entries\n");
+        }
+
+        if (selected(options, "library_sort")) {
+            /* Id order is random name order, so every pass sorts the same input */
+            long iterations = 0;
+            double elapsed = 0;
+            uint64_t cycles = 0;
+            do {
+                sort_library_by_date(&library);
+                double start = platform_monotonic_seconds();
+                uint64_t cycles_start = platform_cycle_counter();
+                sort_library_by_name(&library);
+                cycles += platform_cycle_counter() - cycles_start;
+                elapsed += platform_monotonic_seconds() - start;
+                iterations++;
+            } while (elapsed < options->min_time);
+            report(options, "library_sort", "-", entries, "entries", iterations, elapsed,
+                   cycles, 0);
+        }
+
+        if (selected(options, "library_save") || selected(options, "library_load")) {
+            long long bytes = (long long)library.count * (long long)sizeof(file_metadata_t);
+            long iterations = 0;
+            double start = platform_monotonic_seconds();
+            uint64_t cycles_start = platform_cycle_counter();
+            double elapsed;
+            do {
+                library.is_modified = 1;
+                save_encryption_library(&library);
+                iterations++;
+                elapsed = platform_monotonic_seconds() - start;
+            } while (elapsed < options->min_time);
+            uint64_t cycles = platform_cycle_counter() - cycles_start;
+            if (selected(options, "library_save")) {
+                report(options, "library_save", "-", entries, "entries", iterations, elapsed,
+                       cycles, bytes);
+            }
+
+            if (selected(options, "library_load")) {
+                iterations = 0;
+                start = platform_monotonic_seconds();
+                cycles_start = platform_cycle_counter();
+                do {
+                    encryption_library_t loaded;
+                    memset(&loaded, 0, sizeof(loaded));
+                    load_encryption_library(&loaded);
+                    free_library(&loaded);
+                    iterations++;
+                    elapsed = platform_monotonic_seconds() - start;
+                } while (elapsed < options->min_time);
+                cycles = platform_cycle_counter() - cycles_start;
+                report(options, "library_load", "-", entries, "entries", iterations, elapsed,
+                       cycles, bytes);
+            }
+            remove(LIBRARY_FILENAME);
+        }
+        free_library(&library);
+    }
+}
+
+/* ========================================================================
+ * MAIN PROGRAM
+ * ======================================================================== */
+
+/*
+ * Benchmark entry point: runs in a scratch directory so the library
+ * benchmarks never touch a real library
+ * [Chu-Cheng Yu]
+ */
+int main(int argc, char *argv[])
+{
+    bench_options_t options;
+    if (parse_options(argc, argv, &options) != SUCCESS) return EXIT_FAILURE;
+
+    if (platform_make_directory(BENCH_DIRECTORY) != SUCCESS ||
+        platform_change_directory(BENCH_DIRECTORY) != SUCCESS) {
+        printf("Error: could not enter scratch directory '%s'\n", BENCH_DIRECTORY);
+        return EXIT_FAILURE;
+    }
+    /* The library's debug tracing would time the terminal, not the library */
+    if (!freopen(BENCH_NULL_DEVICE, "w", stderr)) {
+        printf("Warning: library debug output is not suppressed\n");
+    }
+
+    if (options.csv) {
+        printf("benchmark,shape,size,unit,iterations,ns_per_op,mb_per_s,cycles_per_byte\n");
+    } else {
+        printf("%-16s %-8s %12s %-7s %10s %16s %10s %10s\n", "benchmark", "shape", "size", "unit",
+               "iterations", "ns/op", "MB/s", "cycles/B");
+    }
+    bench_kernels(&options);
+    bench_library(&options);
+    checksum_cache_free();
+
+    platform_change_directory("..");
+    remove(BENCH_DIRECTORY);
+    return EXIT_SUCCESS;
+}
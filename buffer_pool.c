@@ -0,0 +1,148 @@
+/*
+ * buffer_pool.c
+ * Shared buffer pool for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file keeps released buffers in one stack per power-of-two size
+ * class. A request is served from its class when a buffer is waiting and
+ * from the allocator otherwise; a release wipes the bytes that were used
+ * and keeps the buffer unless its class or the pool is full.
+ */
+
+#include <threads.h>
+
+#include "ccrypt.h"
+#include "buffer_pool.h"
+#include "platform.h"
+#include "utils.h"
+#include "stats.h"
+
+#define BUFFER_POOL_CLASSES 15   /* 4 KiB to 64 MiB */
+
+typedef struct {
+    void *buffers[BUFFER_POOL_SLOTS];
+    int count;
+} pool_class_t;
+
+static pool_class_t classes[BUFFER_POOL_CLASSES];
+static long pooled_bytes;        /* bytes waiting in all classes */
+static int huge_pages;
+static once_flag pool_once = ONCE_FLAG_INIT;
+static mtx_t pool_lock;
+
+/* forward declarations for internal helpers */
+static void init_lock(void);
+static int class_of(size_t size);
+static size_t class_size(int index);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+static void init_lock(void)
+{
+    mtx_init(&pool_lock, mtx_plain);
+}
+
+/* Class serving a request, or -1 for requests too large to pool */
+static int class_of(size_t size)
+{
+    if (size > BUFFER_POOL_MAX_SIZE) return -1;
+    int index = 0;
+    while (class_size(index) < size) index++;
+    return index;
+}
+
+static size_t class_size(int index)
+{
+    return (size_t)BUFFER_POOL_MIN_SIZE << index;
+}
+
+/* ========================================================================
+ * BUFFER POOL FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Take a buffer of at least size bytes
+ * [Chu-Cheng Yu]
+ */
+void *buffer_pool_acquire(size_t size)
+{
+    int index = class_of(size);
+    if (index < 0) {
+        STATS_ALLOCATION(size);
+        return malloc(size);
+    }
+
+    call_once(&pool_once, init_lock);
+    mtx_lock(&pool_lock);
+    pool_class_t *pc = &classes[index];
+    void *buffer = NULL;
+    if (pc->count > 0) {
+        buffer = pc->buffers[--pc->count];
+        pooled_bytes -= (long)class_size(index);
+    }
+    int huge = huge_pages && class_size(index) >= BUFFER_POOL_HUGE_SIZE;
+    mtx_unlock(&pool_lock);
+
+    if (!buffer) {
+        buffer = malloc(class_size(index));
+        if (buffer && huge) platform_advise_huge_pages(buffer, class_size(index));
+        if (buffer) STATS_ALLOCATION(class_size(index));
+    }
+    return buffer;
+}
+
+/*
+ * Wipe a buffer and give it back for reuse
+ * [Chu-Cheng Yu]
+ */
+void buffer_pool_release(void *buffer, size_t size)
+{
+    if (!buffer) return;
+    secure_memory_clear(buffer, size);
+    int index = class_of(size);
+    if (index < 0) {
+        free(buffer);
+        return;
+    }
+
+    call_once(&pool_once, init_lock);
+    mtx_lock(&pool_lock);
+    pool_class_t *pc = &classes[index];
+    if (pc->count < BUFFER_POOL_SLOTS &&
+        pooled_bytes + (long)class_size(index) <= BUFFER_POOL_LIMIT) {
+        pc->buffers[pc->count++] = buffer;
+        pooled_bytes += (long)class_size(index);
+        buffer = NULL;
+    }
+    mtx_unlock(&pool_lock);
+    free(buffer);
+}
+
+/*
+ * Back large buffers with transparent huge pages
+ * [Chu-Cheng Yu]
+ */
+void buffer_pool_use_huge_pages(int enabled)
+{
+    call_once(&pool_once, init_lock);
+    mtx_lock(&pool_lock);
+    huge_pages = enabled;
+    mtx_unlock(&pool_lock);
+}
+
+/*
+ * Free every buffer the pool is keeping
+ * [Chu-Cheng Yu]
+ */
+void buffer_pool_trim(void)
+{
+    call_once(&pool_once, init_lock);
+    mtx_lock(&pool_lock);
+    for (int i = 0; i < BUFFER_POOL_CLASSES; ++i) {
+        while (classes[i].count > 0) free(classes[i].buffers[--classes[i].count]);
+    }
+    pooled_bytes = 0;
+    mtx_unlock(&pool_lock);
+}
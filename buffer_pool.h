@@ -0,0 +1,56 @@
+/*
+ * buffer_pool.h
+ * Header file for the shared buffer pool
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines a size-classed pool of large buffers that the
+ * encryption paths reuse from one file to the next, so a batch of many
+ * files does not pay a malloc, a free and fresh page faults for every
+ * chunk buffer. Sizes are rounded up to a power of two; each class keeps
+ * a few released buffers, wiped on release since they held plaintext.
+ * Classes of 2 MiB and up can be backed by transparent huge pages. The
+ * pool is safe to use from worker threads.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "ccrypt.h"
+
+#define BUFFER_POOL_MIN_SIZE (4 * 1024)          /* smallest class */
+#define BUFFER_POOL_MAX_SIZE (64 * 1024 * 1024)  /* larger requests are not pooled */
+#define BUFFER_POOL_SLOTS 16                     /* released buffers kept per class */
+#define BUFFER_POOL_LIMIT (256L * 1024 * 1024)   /* bytes kept across all classes */
+#define BUFFER_POOL_HUGE_SIZE (2 * 1024 * 1024)  /* huge page size and alignment */
+
+/* ========================================================================
+ * BUFFER POOL FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Take a buffer of at least size bytes; its contents are undefined
+ * size Bytes needed
+ * The buffer, or NULL if memory is exhausted
+ */
+void *buffer_pool_acquire(size_t size);
+
+/*
+ * Wipe a buffer and give it back for reuse (freed if its class is full)
+ * buffer Buffer from buffer_pool_acquire, or NULL
+ * size The size it was acquired with
+ */
+void buffer_pool_release(void *buffer, size_t size);
+
+/*
+ * Back buffers of BUFFER_POOL_HUGE_SIZE and up allocated from now on with
+ * transparent huge pages, where the system supports them
+ * enabled Nonzero to turn huge pages on
+ */
+void buffer_pool_use_huge_pages(int enabled);
+
+/*
+ * Free every buffer the pool is keeping
+ */
+void buffer_pool_trim(void);
+
+#endif /* BUFFER_POOL_H */
@@ -18,6 +18,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+
+/* make ALLOC_TRACKING=1 routes every allocation through alloc.c */
+#ifdef CCRYPT_ALLOC_TRACKING
+#include "alloc.h"
+#endif
 
 /* ========================================================================
  * CONSTANTS AND MACROS
@@ -27,9 +33,49 @@
 #define MAX_FILENAME_LENGTH 100
 #define MAX_PASSWORD_LENGTH 64
 #define MAX_LIBRARY_ENTRIES 1000
+#define LIBRARY_SLAB_NODES 256      /* smallest block of library nodes */
+#define LIBRARY_SLAB_MAX_NODES 65536 /* largest block, so a bad count cannot ask for gigabytes */
 #define BUFFER_SIZE 4096
-#define ENCRYPTION_SIGNATURE "CCRYPT1.0"
+#define DECOMPRESS_BLOCK_PAIRS 64 /* RLE pairs decoded per bounds check */
+#define KEYSTREAM_BLOCK_SIZE 256  /* unrolled key bytes for the XOR kernel */
+#define ENCRYPTION_SIGNATURE "CCRYPT1.3"
+#define LEGACY_LIBRARY_SIGNATURE "CCRYPT1.0" /* entries without key_fingerprint */
+#define LEGACY_LIBRARY_SIGNATURE_V11 "CCRYPT1.1" /* entries without source_mtime_ns */
+#define LEGACY_LIBRARY_SIGNATURE_V12 "CCRYPT1.2" /* entries without pack location */
+#define KEY_FINGERPRINT_LENGTH 16  /* hex digits in a key fingerprint */
+#define KEY_FINGERPRINT_ROUNDS 65536
 #define LIBRARY_FILENAME "ccrypt_library.dat"
+#define ENCRYPTED_FILES_DIRECTORY "ccrypt_files" /* fanned out as ab/cd/<id>.ccrypt */
+#define CHECKSUM_CACHE_FILENAME "ccrypt_checksum_cache.dat"
+#define CHECKSUM_CACHE_CAPACITY 524288 /* default entries kept before the least recently used
+                                         is dropped; 48 bytes each on disk, 24 MB when full */
+#define CHECKSUM_CACHE_INITIAL 4096 /* slots allocated at first, doubled as the cache fills */
+#define CONTAINER_SIGNATURE "CCRYPTC1" /* 8 bytes, no terminator stored */
+#define CONTAINER_VERSION 3
+#define CONTAINER_FLAG_COMPRESSED 0x1
+#define CONTAINER_FLAG_IN_PLACE 0x2    /* header is a trailer after a plain XOR stream */
+#define CONTAINER_FLAG_CIPHER_CHECKSUM 0x4 /* ciphertext_checksum is recorded */
+#define CONTAINER_FLAG_KEY_CHECK 0x8   /* in-place trailer: merkle_root holds a key check */
+#define CHUNK_SIZE (1024 * 1024)       /* plaintext bytes per container chunk */
+#define MAX_CHUNK_SIZE (64 * 1024 * 1024)
+#define CHUNK_STORE_FILENAME "ccrypt_chunks.pack"
+#define CHUNK_STORE_SIGNATURE "CCSTORE1" /* 8 bytes, no terminator stored */
+#define RECIPE_SIGNATURE "CCRECIP1" /* 8 bytes, no terminator stored */
+#define RECIPE_VERSION 1
+#define CDC_MIN_SIZE (8 * 1024)        /* content-defined chunk bounds */
+#define CDC_AVG_SIZE (32 * 1024)
+#define CDC_MAX_SIZE (128 * 1024)
+#define PACK_FILENAME_FORMAT "ccrypt_pack_%06llu.ccpack"
+#define PACK_SUFFIX ".ccpack"
+#define PACK_SIGNATURE "CCPACK01"   /* 8 bytes, no terminator stored */
+#define PACK_VERSION 1
+#define PACK_OBJECT_MAX_SIZE (64 * 1024) /* larger files get a container of their own */
+#define PACK_TARGET_SIZE (256L * 1024 * 1024) /* a pack takes no more objects past this */
+#define PACK_GC_PERCENT 25             /* repack once this share of a pack is garbage */
+#define JOURNAL_SIGNATURE "CCJRNL01"   /* 8 bytes, no terminator stored */
+#define JOURNAL_SUFFIX ".ccjournal"
+#define JOURNAL_DIRECTION_ENCRYPT 1
+#define JOURNAL_DIRECTION_DECRYPT 2
 
 /* Error codes */
 #define SUCCESS 0
@@ -44,6 +90,8 @@
 #define ERROR_RENAME_FAILED -9
 #define ERROR_DELETE_FAILED -10
 #define ERROR_NEW_FILE_NAME -11
+#define ERROR_CONTAINER_CORRUPT -12
+#define ERROR_CHECKSUM_MISMATCH -13
 
 /* Sort options */
 typedef enum {
@@ -68,16 +116,120 @@ typedef enum {
 typedef struct {
     char original_filename[MAX_FILENAME_LENGTH];
     char encrypted_filename[MAX_FILENAME_LENGTH];
-    char file_path[MAX_PATH_LENGTH];
+    char file_path[MAX_PATH_LENGTH]; /* where the encrypted file lives; empty means
+                                        encrypted_filename is the path */
     long original_size;
     long encrypted_size;
     unsigned long encryption_id;
     int encryption_method; /* encryption_method_t value used for this file */
     int is_compressed;
     char file_type[10];
-    char checksum[33]; /* MD5-style checksum for integrity */
+    char checksum[33]; /* plaintext checksum as hex (see checksum.h) */
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1]; /* identifies the password, not secret */
+    uint64_t source_mtime_ns; /* modification time of the source when encrypted */
+    uint64_t pack_id;     /* packfile holding the container, 0 if it is a file of its own */
+    uint64_t pack_offset; /* offset of the container within the packfile */
+    uint64_t pack_length; /* container bytes in the packfile */
 } file_metadata_t;
 
+/*
+ * container_header
+ * Header at the start of every encrypted file, followed by chunk_header_t
+ * records each trailed by stored_size bytes of encrypted payload. Chunk
+ * payloads are keyed from the plaintext offset of the chunk, so any chunk
+ * can be decrypted on its own. After the last chunk comes a table of
+ * chunk_count chunk_index_entry_t records whose hashes are the leaves of a
+ * Merkle tree with root merkle_root.
+ */
+typedef struct {
+    char signature[8];       /* CONTAINER_SIGNATURE */
+    uint32_t version;
+    uint32_t flags;          /* CONTAINER_FLAG_* */
+    uint32_t chunk_size;     /* plaintext bytes per chunk (last may be short) */
+    uint32_t reserved;
+    uint64_t original_size;  /* plaintext bytes */
+    uint64_t payload_size;   /* sum of stored chunk sizes */
+    uint64_t plaintext_checksum;  /* checksum of the original file */
+    uint64_t ciphertext_checksum; /* checksum of the stored payload bytes */
+    uint64_t index_offset;   /* file offset of the chunk index (0 if none) */
+    uint64_t chunk_count;
+    uint64_t merkle_root;    /* root over the chunk index hashes; in-place trailers have
+                                no index and keep a password check here instead */
+} container_header_t;
+
+typedef struct {
+    uint32_t raw_size;       /* plaintext bytes in this chunk */
+    uint32_t stored_size;    /* equal to raw_size when stored uncompressed */
+} chunk_header_t;
+
+typedef struct {
+    uint64_t offset;         /* file offset of the chunk's chunk_header_t */
+    uint32_t raw_size;
+    uint32_t stored_size;
+    uint64_t hash;           /* checksum of the stored bytes (Merkle leaf) */
+} chunk_index_entry_t;
+
+/*
+ * recipe_header
+ * An encrypted file stored in the chunk store: this header followed by
+ * chunk_count recipe_entry_t records naming the store chunks, in order,
+ * that make up the plaintext
+ */
+typedef struct {
+    char signature[8];       /* RECIPE_SIGNATURE */
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t original_size;
+    uint64_t chunk_count;
+    uint64_t plaintext_checksum;
+} recipe_header_t;
+
+typedef struct {
+    uint64_t chunk_id;       /* keyed hash of the chunk plaintext */
+    uint32_t raw_size;
+    uint32_t reserved;
+} recipe_entry_t;
+
+/*
+ * pack_header
+ * Start of a packfile: this header followed by pack_record_t records, each
+ * trailed by length bytes holding one complete container. Library entries
+ * locate their container by pack id and offset; objects no entry points to
+ * any more are garbage until the pack is rewritten.
+ */
+typedef struct {
+    char signature[8];       /* PACK_SIGNATURE */
+    uint32_t version;
+    uint32_t reserved;
+} pack_header_t;
+
+typedef struct {
+    uint64_t length;         /* container bytes following this record */
+    uint64_t encryption_id;  /* entry the object was written for */
+} pack_record_t;
+
+/*
+ * inplace_journal
+ * Crash-recovery record for in-place encryption, stored next to the file
+ * being rewritten and followed by the original bytes of the chunk in flight.
+ * Chunks before offset are done; restoring the saved chunk makes the rest
+ * of the file untouched, so the job can resume at offset.
+ */
+typedef struct {
+    char signature[8];       /* JOURNAL_SIGNATURE */
+    uint32_t direction;      /* 1 = encrypting, 2 = decrypting */
+    uint32_t length;         /* saved chunk bytes following this record */
+    uint64_t offset;         /* file offset of the chunk in flight */
+    uint64_t total_size;     /* plaintext bytes to process */
+    uint64_t saved_hash;     /* checksum of the saved bytes; a mismatch means the
+                                chunk at offset was completed and the saved
+                                area already holds the next one */
+    uint64_t expected_checksum; /* plaintext checksum from the trailer when
+                                   decrypting, so a resumed run can verify */
+    uint64_t key_check;      /* password check, so a resumed run with another
+                                password stops before changing anything */
+} inplace_journal_t;
+
 /*
  * encryption_library
  * Structure to manage the library of encrypted files
@@ -87,11 +239,18 @@ typedef struct file_node {
     struct file_node *next;
 } file_node_t;
 
+typedef struct library_slab library_slab_t; /* block of nodes, see library.c */
+typedef struct library_hot library_hot_t;   /* compact scan record, see library.c */
+
 typedef struct {
     file_node_t *head; /* linked list head for dynamic storage */
     int count;
     int is_modified;
     unsigned long next_id;
+    library_slab_t *slabs;     /* blocks the nodes are carved from */
+    file_node_t *free_nodes;   /* removed nodes waiting for reuse */
+    library_hot_t *hot;        /* one hot record per entry, in list order */
+    int hot_capacity;
 } encryption_library_t;
 
 /* ========================================================================
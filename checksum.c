@@ -0,0 +1,235 @@
+/*
+ * checksum.c
+ * Checksum functions for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file implements XXH64 over 32-byte stripes. It runs at several GB/s
+ * on one core, so hashing alongside encryption costs little.
+ */
+
+#include "ccrypt.h"
+#include "checksum.h"
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/* Little-endian loads; compilers turn these into single moves */
+static uint64_t read64(const unsigned char *p)
+{
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+           ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static uint32_t read32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static uint64_t merge_round64(uint64_t acc, uint64_t value)
+{
+    acc ^= round64(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+/* Fold whole 32-byte stripes into the accumulators; returns bytes used */
+static size_t consume_stripes(uint64_t acc[4], const unsigned char *p, size_t size)
+{
+    uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+    size_t used = 0;
+    while (size - used >= 32) {
+        v1 = round64(v1, read64(p + used));
+        v2 = round64(v2, read64(p + used + 8));
+        v3 = round64(v3, read64(p + used + 16));
+        v4 = round64(v4, read64(p + used + 24));
+        used += 32;
+    }
+    acc[0] = v1; acc[1] = v2; acc[2] = v3; acc[3] = v4;
+    return used;
+}
+
+/* ========================================================================
+ * CHECKSUM FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Start a new incremental checksum
+ * [Chu-Cheng Yu]
+ */
+void checksum_init(checksum_state_t *state)
+{
+    if (!state) return;
+    memset(state, 0, sizeof(*state));
+    state->acc[0] = PRIME64_1 + PRIME64_2;
+    state->acc[1] = PRIME64_2;
+    state->acc[2] = 0;
+    state->acc[3] = 0 - PRIME64_1;
+}
+
+/*
+ * Add data to an incremental checksum
+ * [Chu-Cheng Yu]
+ */
+void checksum_update(checksum_state_t *state, const unsigned char *data, size_t size)
+{
+    if (!state || !data || size == 0) return;
+    state->total_length += size;
+
+    /* Top up a partial stripe left by the previous call */
+    if (state->pending_size > 0) {
+        size_t need = 32 - state->pending_size;
+        size_t take = size < need ? size : need;
+        memcpy(state->pending + state->pending_size, data, take);
+        state->pending_size += (uint32_t)take;
+        data += take;
+        size -= take;
+        if (state->pending_size < 32) return;
+        consume_stripes(state->acc, state->pending, 32);
+        state->pending_size = 0;
+    }
+
+    size_t used = consume_stripes(state->acc, data, size);
+    if (used < size) {
+        memcpy(state->pending, data + used, size - used);
+        state->pending_size = (uint32_t)(size - used);
+    }
+}
+
+/*
+ * Finish an incremental checksum
+ * [Chu-Cheng Yu]
+ */
+uint64_t checksum_final(const checksum_state_t *state)
+{
+    if (!state) return 0;
+    uint64_t h;
+    if (state->total_length >= 32) {
+        h = rotl64(state->acc[0], 1) + rotl64(state->acc[1], 7) +
+            rotl64(state->acc[2], 12) + rotl64(state->acc[3], 18);
+        h = merge_round64(h, state->acc[0]);
+        h = merge_round64(h, state->acc[1]);
+        h = merge_round64(h, state->acc[2]);
+        h = merge_round64(h, state->acc[3]);
+    } else {
+        h = PRIME64_5;
+    }
+    h += state->total_length;
+
+    const unsigned char *p = state->pending;
+    size_t left = state->pending_size;
+    while (left >= 8) {
+        h ^= round64(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+        left -= 8;
+    }
+    if (left >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        left -= 4;
+    }
+    while (left > 0) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+        left--;
+    }
+
+    /* Avalanche */
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * Checksum a single buffer
+ * [Chu-Cheng Yu]
+ */
+uint64_t checksum_buffer(const unsigned char *data, size_t size)
+{
+    checksum_state_t state;
+    checksum_init(&state);
+    checksum_update(&state, data, size);
+    return checksum_final(&state);
+}
+
+/*
+ * Combine two child hashes into their parent Merkle node
+ * [Chu-Cheng Yu]
+ */
+uint64_t merkle_combine(uint64_t left, uint64_t right)
+{
+    unsigned char pair[16];
+    for (int i = 0; i < 8; ++i) {
+        pair[i] = (unsigned char)(left >> (8 * i));
+        pair[8 + i] = (unsigned char)(right >> (8 * i));
+    }
+    return checksum_buffer(pair, sizeof(pair));
+}
+
+/*
+ * Compute the root of a binary Merkle tree over a list of leaf hashes
+ * [Chu-Cheng Yu]
+ */
+int merkle_root(const uint64_t *leaves, uint64_t leaf_count, uint64_t *root)
+{
+    if (!leaves || leaf_count == 0 || !root) return ERROR_INVALID_PATH;
+    if (leaf_count == 1) {
+        *root = leaves[0];
+        return SUCCESS;
+    }
+
+    /* Each level is at most half the one below, so one scratch array of
+       half the leaves holds every level in turn */
+    uint64_t *level = (uint64_t *)malloc(sizeof(uint64_t) * (size_t)((leaf_count + 1) / 2));
+    if (!level) return ERROR_MEMORY_ALLOCATION;
+
+    const uint64_t *below = leaves;
+    uint64_t count = leaf_count;
+    while (count > 1) {
+        uint64_t parents = (count + 1) / 2;
+        for (uint64_t i = 0; i < count / 2; ++i) {
+            level[i] = merkle_combine(below[2 * i], below[2 * i + 1]);
+        }
+        if (count % 2) level[parents - 1] = below[count - 1];
+        below = level;
+        count = parents;
+    }
+    *root = level[0];
+    free(level);
+    return SUCCESS;
+}
+
+/*
+ * Format a checksum as fixed-width lowercase hex
+ * [Chu-Cheng Yu]
+ */
+void format_checksum(uint64_t checksum, char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size == 0) return;
+    snprintf(buffer, buffer_size, "%016llx", (unsigned long long)checksum);
+}
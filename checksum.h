@@ -0,0 +1,89 @@
+/*
+ * checksum.h
+ * Header file for checksum functions
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the 64-bit block hash CCrypt uses for file integrity.
+ * The algorithm is XXH64 (seed 0), written in portable C; a streaming state
+ * lets callers hash data in whatever blocks they already have in memory.
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "ccrypt.h"
+
+#define CHECKSUM_HEX_LENGTH 16 /* hex digits in a formatted checksum */
+
+/*
+ * checksum_state
+ * Running state for an incremental checksum
+ */
+typedef struct {
+    uint64_t total_length;
+    uint64_t acc[4];
+    unsigned char pending[32]; /* input not yet folded into acc */
+    uint32_t pending_size;
+} checksum_state_t;
+
+/* ========================================================================
+ * CHECKSUM FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Start a new incremental checksum
+ * state Pointer to state to initialise
+ */
+void checksum_init(checksum_state_t *state);
+
+/*
+ * Add data to an incremental checksum
+ * state Pointer to running state
+ * data Pointer to the next bytes of input
+ * size Number of bytes
+ */
+void checksum_update(checksum_state_t *state, const unsigned char *data, size_t size);
+
+/*
+ * Finish an incremental checksum (state is left unchanged)
+ * state Pointer to running state
+ * 64-bit checksum of all data added so far
+ */
+uint64_t checksum_final(const checksum_state_t *state);
+
+/*
+ * Checksum a single buffer
+ * data Pointer to input
+ * size Number of bytes
+ * 64-bit checksum of the buffer
+ */
+uint64_t checksum_buffer(const unsigned char *data, size_t size);
+
+/*
+ * Combine two child hashes into their parent Merkle node
+ * left Hash of the left child
+ * right Hash of the right child
+ * Parent hash
+ */
+uint64_t merkle_combine(uint64_t left, uint64_t right);
+
+/*
+ * Compute the root of a binary Merkle tree over a list of leaf hashes.
+ * Pairs are combined level by level; an odd node at the end of a level is
+ * carried up unchanged.
+ * leaves Array of leaf hashes
+ * leaf_count Number of leaves
+ * root Out parameter to receive the root
+ * SUCCESS on success, ERROR_MEMORY_ALLOCATION if scratch space is unavailable
+ */
+int merkle_root(const uint64_t *leaves, uint64_t leaf_count, uint64_t *root);
+
+/*
+ * Format a checksum as fixed-width lowercase hex
+ * checksum Value to format
+ * buffer Buffer to receive the string (at least CHECKSUM_HEX_LENGTH + 1 bytes)
+ * buffer_size Size of the buffer
+ */
+void format_checksum(uint64_t checksum, char *buffer, size_t buffer_size);
+
+#endif /* CHECKSUM_H */
@@ -0,0 +1,430 @@
+/*
+ * checksum_cache.c
+ * Persistent checksum cache for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file keeps a bounded LRU map from file identity to checksum, loaded
+ * at startup and written back at exit, so unchanged files are not rehashed.
+ */
+
+#include <limits.h>
+#include <threads.h>
+
+#include "ccrypt.h"
+#include "checksum_cache.h"
+#include "utils.h"
+
+#define CACHE_SIGNATURE "CCCACHE1" /* 8 bytes, no terminator stored */
+#define CACHE_VERSION 1
+
+/* In-memory entry: chained in a hash bucket and in the LRU list */
+typedef struct {
+    platform_file_id_t id;
+    uint64_t checksum;
+    uint32_t kind;
+    int chain;               /* next entry in the bucket, or next free slot */
+    int newer;               /* LRU neighbours, -1 at either end */
+    int older;
+} cache_entry_t;
+
+/* On-disk record, written oldest first */
+typedef struct {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t mtime_ns;
+    uint64_t checksum;
+    uint32_t kind;
+    uint32_t reserved;
+} cache_record_t;
+
+typedef struct {
+    char signature[8];       /* CACHE_SIGNATURE */
+    uint32_t version;
+    uint32_t count;
+} cache_file_header_t;
+
+static struct {
+    cache_entry_t *entries;  /* capacity slots */
+    int *buckets;            /* 2 * capacity heads, -1 when empty */
+    int capacity;            /* slots allocated, a power of two */
+    int limit;               /* most live entries kept */
+    int used;                /* slots ever handed out */
+    int count;               /* live entries */
+    int free_slot;           /* head of the free list threaded through chain */
+    int newest;
+    int oldest;
+    int dirty;
+    char path[MAX_PATH_LENGTH];
+} cache;
+
+static mtx_t cache_lock;
+static once_flag cache_once = ONCE_FLAG_INIT;
+
+/* forward declarations for internal helpers */
+static void init_lock(void);
+static int ensure_tables(void);
+static int grow_tables(void);
+static void reset_tables(void);
+static unsigned bucket_of(const platform_file_id_t *id, uint32_t kind);
+static int find_entry(const platform_file_id_t *id, uint32_t kind);
+static void unlink_lru(int slot);
+static void push_newest(int slot);
+static void remove_entry(int slot);
+static void insert_entry(const platform_file_id_t *id, uint32_t kind, uint64_t checksum);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+static void init_lock(void)
+{
+    mtx_init(&cache_lock, mtx_plain);
+}
+
+/* Allocate the tables on first use; caller holds the lock */
+static int ensure_tables(void)
+{
+    if (cache.entries) return SUCCESS;
+    if (cache.limit <= 0) cache.limit = CHECKSUM_CACHE_CAPACITY;
+    cache.capacity = CHECKSUM_CACHE_INITIAL;
+    cache.entries = (cache_entry_t *)malloc(sizeof(cache_entry_t) * (size_t)cache.capacity);
+    cache.buckets = (int *)malloc(sizeof(int) * 2 * (size_t)cache.capacity);
+    if (!cache.entries || !cache.buckets) {
+        free(cache.entries);
+        free(cache.buckets);
+        cache.entries = NULL;
+        cache.buckets = NULL;
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    reset_tables();
+    return SUCCESS;
+}
+
+/* Double the tables when every slot is live and the limit allows more;
+   caller holds the lock */
+static int grow_tables(void)
+{
+    if (cache.capacity >= cache.limit || cache.capacity > INT_MAX / 4) {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    int capacity = cache.capacity * 2;
+    cache_entry_t *entries = (cache_entry_t *)realloc(cache.entries,
+                                                      sizeof(cache_entry_t) * (size_t)capacity);
+    if (!entries) return ERROR_MEMORY_ALLOCATION;
+    cache.entries = entries;
+    int *buckets = (int *)malloc(sizeof(int) * 2 * (size_t)capacity);
+    if (!buckets) return ERROR_MEMORY_ALLOCATION;
+    free(cache.buckets);
+    cache.buckets = buckets;
+    cache.capacity = capacity;
+
+    /* No slot is free, so every used slot goes back in a bucket */
+    for (int i = 0; i < 2 * capacity; ++i) cache.buckets[i] = -1;
+    for (int slot = 0; slot < cache.used; ++slot) {
+        unsigned b = bucket_of(&cache.entries[slot].id, cache.entries[slot].kind);
+        cache.entries[slot].chain = cache.buckets[b];
+        cache.buckets[b] = slot;
+    }
+    return SUCCESS;
+}
+
+/* Empty the tables without freeing them; caller holds the lock */
+static void reset_tables(void)
+{
+    for (int i = 0; i < 2 * cache.capacity; ++i) cache.buckets[i] = -1;
+    cache.used = 0;
+    cache.count = 0;
+    cache.free_slot = -1;
+    cache.newest = -1;
+    cache.oldest = -1;
+}
+
+static unsigned bucket_of(const platform_file_id_t *id, uint32_t kind)
+{
+    uint64_t h = id->inode * 0x9E3779B97F4A7C15ULL;
+    h ^= id->device + (h << 6) + (h >> 2);
+    h ^= id->mtime_ns + (h << 6) + (h >> 2);
+    h ^= id->size + kind;
+    h ^= h >> 29;
+    return (unsigned)(h & (uint64_t)(2 * cache.capacity - 1));
+}
+
+static int find_entry(const platform_file_id_t *id, uint32_t kind)
+{
+    for (int slot = cache.buckets[bucket_of(id, kind)]; slot >= 0; slot = cache.entries[slot].chain) {
+        const cache_entry_t *e = &cache.entries[slot];
+        if (e->kind == kind && e->id.inode == id->inode && e->id.device == id->device &&
+            e->id.size == id->size && e->id.mtime_ns == id->mtime_ns) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static void unlink_lru(int slot)
+{
+    cache_entry_t *e = &cache.entries[slot];
+    if (e->newer >= 0) cache.entries[e->newer].older = e->older;
+    else cache.newest = e->older;
+    if (e->older >= 0) cache.entries[e->older].newer = e->newer;
+    else cache.oldest = e->newer;
+}
+
+static void push_newest(int slot)
+{
+    cache_entry_t *e = &cache.entries[slot];
+    e->newer = -1;
+    e->older = cache.newest;
+    if (cache.newest >= 0) cache.entries[cache.newest].newer = slot;
+    cache.newest = slot;
+    if (cache.oldest < 0) cache.oldest = slot;
+}
+
+/* Take an entry out of its bucket and the LRU list and free its slot */
+static void remove_entry(int slot)
+{
+    cache_entry_t *e = &cache.entries[slot];
+    int *link = &cache.buckets[bucket_of(&e->id, e->kind)];
+    while (*link != slot) link = &cache.entries[*link].chain;
+    *link = e->chain;
+    unlink_lru(slot);
+    e->chain = cache.free_slot;
+    cache.free_slot = slot;
+    cache.count--;
+}
+
+static void insert_entry(const platform_file_id_t *id, uint32_t kind, uint64_t checksum)
+{
+    int slot = find_entry(id, kind);
+    if (slot >= 0) {
+        cache.entries[slot].checksum = checksum;
+        unlink_lru(slot);
+        push_newest(slot);
+        return;
+    }
+
+    while (cache.count >= cache.limit) remove_entry(cache.oldest);
+    if (cache.free_slot < 0 && cache.used == cache.capacity && grow_tables() != SUCCESS) {
+        remove_entry(cache.oldest);
+    }
+    if (cache.free_slot >= 0) {
+        slot = cache.free_slot;
+        cache.free_slot = cache.entries[slot].chain;
+    } else {
+        slot = cache.used++;
+    }
+
+    cache_entry_t *e = &cache.entries[slot];
+    e->id = *id;
+    e->kind = kind;
+    e->checksum = checksum;
+    unsigned b = bucket_of(id, kind);
+    e->chain = cache.buckets[b];
+    cache.buckets[b] = slot;
+    push_newest(slot);
+    cache.count++;
+}
+
+/* ========================================================================
+ * CHECKSUM CACHE FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Load the cache from disk, replacing anything already in memory
+ * [Chu-Cheng Yu]
+ */
+int checksum_cache_load(const char *cache_path)
+{
+    if (!cache_path) return ERROR_INVALID_PATH;
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+
+    int result = ensure_tables();
+    if (result != SUCCESS) {
+        mtx_unlock(&cache_lock);
+        return result;
+    }
+    reset_tables();
+    safe_string_copy(cache.path, cache_path, sizeof(cache.path));
+    cache.dirty = 0;
+
+    FILE *fp = fopen(cache_path, "rb");
+    if (!fp) {
+        mtx_unlock(&cache_lock);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    cache_file_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.signature, CACHE_SIGNATURE, sizeof(header.signature)) != 0 ||
+        header.version != CACHE_VERSION) {
+        result = ERROR_LIBRARY_CORRUPT;
+    }
+
+    /* Records are oldest first, so inserting in order rebuilds the LRU list */
+    for (uint32_t i = 0; result == SUCCESS && i < header.count; ++i) {
+        cache_record_t record;
+        if (fread(&record, sizeof(record), 1, fp) != 1) {
+            result = ERROR_LIBRARY_CORRUPT;
+            break;
+        }
+        platform_file_id_t id = { record.device, record.inode, record.size, record.mtime_ns };
+        insert_entry(&id, record.kind, record.checksum);
+    }
+    fclose(fp);
+
+    if (result != SUCCESS) {
+        reset_tables();
+        cache.dirty = 1;     /* rewrite the damaged file on save */
+    }
+    mtx_unlock(&cache_lock);
+    return result;
+}
+
+/*
+ * Write the cache back to the file it was loaded from, if it changed
+ * [Chu-Cheng Yu]
+ */
+int checksum_cache_save(void)
+{
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    if (!cache.entries || !cache.dirty || cache.path[0] == '\0') {
+        mtx_unlock(&cache_lock);
+        return SUCCESS;
+    }
+
+    /* Write a temporary file and swap it in so a crash never leaves half a cache */
+    char temp_path[MAX_PATH_LENGTH + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache.path);
+    FILE *fp = fopen(temp_path, "wb");
+    if (!fp) {
+        mtx_unlock(&cache_lock);
+        return ERROR_PERMISSION_DENIED;
+    }
+
+    cache_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, CACHE_SIGNATURE, sizeof(header.signature));
+    header.version = CACHE_VERSION;
+    header.count = (uint32_t)cache.count;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    for (int slot = cache.oldest; ok && slot >= 0; slot = cache.entries[slot].newer) {
+        const cache_entry_t *e = &cache.entries[slot];
+        cache_record_t record;
+        memset(&record, 0, sizeof(record));
+        record.device = e->id.device;
+        record.inode = e->id.inode;
+        record.size = e->id.size;
+        record.mtime_ns = e->id.mtime_ns;
+        record.checksum = e->checksum;
+        record.kind = e->kind;
+        ok = fwrite(&record, sizeof(record), 1, fp) == 1;
+    }
+    if (fclose(fp) != 0) ok = 0;
+
+    if (ok) {
+        remove(cache.path);
+        ok = rename(temp_path, cache.path) == 0;
+    }
+    if (!ok) {
+        remove(temp_path);
+    } else {
+        cache.dirty = 0;
+    }
+    mtx_unlock(&cache_lock);
+    return ok ? SUCCESS : ERROR_PERMISSION_DENIED;
+}
+
+/*
+ * Set how many entries the cache keeps
+ * [Chu-Cheng Yu]
+ */
+void checksum_cache_set_capacity(int entries)
+{
+    if (entries < 1) return;
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    cache.limit = entries;
+    while (cache.entries && cache.count > cache.limit) {
+        remove_entry(cache.oldest);
+        cache.dirty = 1;
+    }
+    mtx_unlock(&cache_lock);
+}
+
+/*
+ * Drop every entry and release the cache's memory
+ * [Chu-Cheng Yu]
+ */
+void checksum_cache_free(void)
+{
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    free(cache.entries);
+    free(cache.buckets);
+    cache.entries = NULL;
+    cache.buckets = NULL;
+    cache.dirty = 0;
+    mtx_unlock(&cache_lock);
+}
+
+/*
+ * Look up the checksum recorded for a file identity
+ * [Chu-Cheng Yu]
+ */
+int checksum_cache_lookup(const platform_file_id_t *id, uint32_t kind, uint64_t *checksum)
+{
+    if (!id || !checksum) return ERROR_INVALID_PATH;
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    int result = ERROR_FILE_NOT_FOUND;
+    if (cache.entries) {
+        int slot = find_entry(id, kind);
+        if (slot >= 0) {
+            *checksum = cache.entries[slot].checksum;
+            unlink_lru(slot);
+            push_newest(slot);
+            result = SUCCESS;
+        }
+    }
+    mtx_unlock(&cache_lock);
+    return result;
+}
+
+/*
+ * Record the checksum of a file identity
+ * [Chu-Cheng Yu]
+ */
+void checksum_cache_store(const platform_file_id_t *id, uint32_t kind, uint64_t checksum)
+{
+    if (!id) return;
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    if (ensure_tables() == SUCCESS) {
+        insert_entry(id, kind, checksum);
+        cache.dirty = 1;
+    }
+    mtx_unlock(&cache_lock);
+}
+
+/*
+ * Forget the checksum of a file identity
+ * [Chu-Cheng Yu]
+ */
+void checksum_cache_invalidate(const platform_file_id_t *id, uint32_t kind)
+{
+    if (!id) return;
+    call_once(&cache_once, init_lock);
+    mtx_lock(&cache_lock);
+    if (cache.entries) {
+        int slot = find_entry(id, kind);
+        if (slot >= 0) {
+            remove_entry(slot);
+            cache.dirty = 1;
+        }
+    }
+    mtx_unlock(&cache_lock);
+}
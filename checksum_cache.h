@@ -0,0 +1,79 @@
+/*
+ * checksum_cache.h
+ * Header file for the persistent checksum cache
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines a small side cache mapping a file's identity
+ * (device, inode, size, modification time) to a checksum computed earlier,
+ * so files that have not changed since the last run are not hashed again.
+ * The cache holds at most CHECKSUM_CACHE_CAPACITY entries unless told
+ * otherwise and drops the least recently used one when full; its tables
+ * start small and grow with it. It is safe to use from worker threads.
+ */
+
+#ifndef CHECKSUM_CACHE_H
+#define CHECKSUM_CACHE_H
+
+#include "ccrypt.h"
+#include "platform.h"
+
+/* What a cached checksum was computed over */
+#define CHECKSUM_KIND_FILE 1     /* every byte of the file */
+#define CHECKSUM_KIND_PAYLOAD 2  /* the stored chunk bytes of a container */
+
+/* ========================================================================
+ * CHECKSUM CACHE FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Load the cache from disk, replacing anything already in memory
+ * cache_path Path of the cache file
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND if there is no cache yet,
+ * ERROR_LIBRARY_CORRUPT if the file is unreadable (the cache starts empty)
+ */
+int checksum_cache_load(const char *cache_path);
+
+/*
+ * Write the cache back to the file it was loaded from, if it changed
+ * SUCCESS on success, ERROR_PERMISSION_DENIED if it could not be written
+ */
+int checksum_cache_save(void);
+
+/*
+ * Set how many entries the cache keeps; each file checked with --verify
+ * and tracked by the library can take two (FILE and PAYLOAD checksums)
+ * entries Maximum number of entries, at least 1
+ */
+void checksum_cache_set_capacity(int entries);
+
+/*
+ * Drop every entry and release the cache's memory
+ */
+void checksum_cache_free(void);
+
+/*
+ * Look up the checksum recorded for a file identity
+ * id Identity of the file as it is now
+ * kind CHECKSUM_KIND_* the checksum was computed over
+ * checksum Out parameter to receive the cached checksum
+ * SUCCESS on a hit, ERROR_FILE_NOT_FOUND on a miss
+ */
+int checksum_cache_lookup(const platform_file_id_t *id, uint32_t kind, uint64_t *checksum);
+
+/*
+ * Record the checksum of a file identity, evicting the least recently used
+ * entry if the cache is full
+ * id Identity of the file the checksum was computed from
+ * kind CHECKSUM_KIND_* the checksum was computed over
+ * checksum Checksum to record
+ */
+void checksum_cache_store(const platform_file_id_t *id, uint32_t kind, uint64_t checksum);
+
+/*
+ * Forget the checksum of a file identity, e.g. after it failed to match
+ * id Identity of the file
+ * kind CHECKSUM_KIND_* to forget
+ */
+void checksum_cache_invalidate(const platform_file_id_t *id, uint32_t kind);
+
+#endif /* CHECKSUM_CACHE_H */
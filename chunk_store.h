@@ -0,0 +1,158 @@
+/*
+ * chunk_store.h
+ * Header file for the deduplicated chunk store
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the content-defined chunker and the encrypted chunk
+ * store. Files are cut at boundaries chosen by a Gear rolling hash, so an
+ * edit only changes the chunks around it; each distinct chunk is encrypted
+ * and kept once in CHUNK_STORE_FILENAME, and a file is stored as a recipe
+ * listing its chunks.
+ */
+
+#ifndef CHUNK_STORE_H
+#define CHUNK_STORE_H
+
+#include "ccrypt.h"
+
+/*
+ * chunk_store_entry
+ * Where one chunk lives in the pack file
+ */
+typedef struct {
+    uint64_t chunk_id;       /* 0 marks an empty slot */
+    uint64_t offset;         /* file offset of the chunk's record header */
+    uint32_t raw_size;
+    uint32_t stored_size;
+} chunk_store_entry_t;
+
+/*
+ * chunk_store
+ * An open pack file and an in-memory hash index of its chunks
+ */
+typedef struct {
+    FILE *pack;
+    chunk_store_entry_t *slots;
+    size_t capacity;         /* power of two */
+    size_t count;
+    uint64_t pack_size;      /* end of the last complete record */
+    int damaged;             /* a record before the end is unreadable, so
+                                nothing may be appended */
+    unsigned char *scratch;  /* CDC_MAX_SIZE bytes of stored chunk data */
+} chunk_store_t;
+
+/* ========================================================================
+ * CHUNKING FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Find the end of the next content-defined chunk
+ * data Start of the unchunked data
+ * size Bytes available at data
+ * Length of the chunk starting at data: between CDC_MIN_SIZE and
+ * CDC_MAX_SIZE, or size if less data than that remains
+ */
+size_t cdc_next_boundary(const unsigned char *data, size_t size);
+
+/* ========================================================================
+ * CHUNK STORE FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Open a chunk store, creating it if needed, and index its chunks
+ * store Store to initialise
+ * pack_path Path of the pack file
+ * SUCCESS on success, or an error code on failure
+ */
+int chunk_store_open(chunk_store_t *store, const char *pack_path);
+
+/*
+ * Flush and close a chunk store
+ * store Store to close
+ * SUCCESS on success, ERROR_PERMISSION_DENIED if pending writes failed
+ */
+int chunk_store_close(chunk_store_t *store);
+
+/*
+ * Add a chunk unless the store already holds it
+ * store Open chunk store
+ * chunk_id Keyed hash of the chunk plaintext
+ * data Chunk plaintext
+ * size Chunk length (at most CDC_MAX_SIZE)
+ * password Encryption password
+ * stored_bytes Out parameter to receive the bytes appended (0 if known)
+ * SUCCESS on success, or an error code on failure
+ */
+int chunk_store_put(chunk_store_t *store, uint64_t chunk_id, const unsigned char *data,
+                    size_t size, const char *password, long *stored_bytes);
+
+/*
+ * Read and decrypt one chunk, checking it against its id
+ * store Open chunk store
+ * chunk_id Id of the chunk
+ * key Key half of the id (see chunk_store_key)
+ * password Password used for decryption
+ * output Buffer of at least CDC_MAX_SIZE bytes
+ * size Out parameter to receive the chunk length
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND if the chunk is not stored,
+ * ERROR_CHECKSUM_MISMATCH if it is damaged or the password is wrong
+ */
+int chunk_store_get(chunk_store_t *store, uint64_t chunk_id, uint64_t key,
+                    const char *password, unsigned char *output, size_t *size);
+
+/*
+ * Look a chunk up in the store's index without reading it; safe to call
+ * from several threads while nothing is being added
+ * store Open chunk store
+ * chunk_id Chunk to look up
+ * The chunk's index entry, or NULL if the store does not hold it
+ */
+const chunk_store_entry_t *chunk_store_find(const chunk_store_t *store, uint64_t chunk_id);
+
+/*
+ * Derive the value mixed into chunk ids so equal plaintext under different
+ * passwords is stored separately and ids reveal nothing without the key
+ * password Encryption password
+ * Key value for chunk_store_id
+ */
+uint64_t chunk_store_key(const char *password);
+
+/*
+ * Compute the id of a chunk
+ * data Chunk plaintext
+ * size Chunk length
+ * key Value from chunk_store_key
+ * Chunk id (never 0)
+ */
+uint64_t chunk_store_id(const unsigned char *data, size_t size, uint64_t key);
+
+/*
+ * Encrypt a file into the chunk store and write its recipe
+ * input_path Path to the file to encrypt
+ * recipe_path Path of the recipe to write
+ * password Encryption password
+ * metadata Pointer to metadata structure to populate
+ * SUCCESS on success, or an error code on failure
+ */
+int encrypt_file_to_store(const char *input_path, const char *recipe_path,
+                          const char *password, file_metadata_t *metadata);
+
+/*
+ * Rebuild a file from its recipe and the chunk store
+ * recipe_path Path of the recipe
+ * output_path Path where the decrypted output should be written
+ * password Password used for decryption
+ * output_size Out parameter to receive the bytes written
+ * SUCCESS on success, or an error code on failure (output is removed)
+ */
+int decrypt_file_from_store(const char *recipe_path, const char *output_path,
+                            const char *password, long *output_size);
+
+/*
+ * Check whether a file is a chunk store recipe
+ * file_path Path to the file
+ * 1 if it starts with RECIPE_SIGNATURE, 0 otherwise
+ */
+int is_store_recipe(const char *file_path);
+
+#endif /* CHUNK_STORE_H */
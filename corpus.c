@@ -0,0 +1,248 @@
+/*
+ * corpus.c
+ * Synthetic benchmark corpus for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file generates reproducible test data and library fixtures from a
+ * seed, for the benchmark driver and the corpus tool.
+ */
+
+#include "ccrypt.h"
+#include "corpus.h"
+#include "library.h"
+#include "utils.h"
+#include "checksum.h"
+
+static const char *shape_names[CORPUS_SHAPE_COUNT] = { "random", "runs", "text", "sparse" };
+
+static const char *corpus_words[] = {
+    "the", "cipher", "library", "of", "encrypted", "files", "and", "a",
+    "chunk", "container", "is", "written", "to", "disk", "with", "its", "checksum"
+};
+#define CORPUS_WORD_COUNT (sizeof(corpus_words) / sizeof(corpus_words[0]))
+
+/* ========================================================================
+ * CORPUS FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Name of a shape
+ * [Chu-Cheng Yu]
+ */
+const char *corpus_shape_name(corpus_shape_t shape)
+{
+    return (shape >= 0 && shape < CORPUS_SHAPE_COUNT) ? shape_names[shape] : "unknown";
+}
+
+/*
+ * Look up a shape by name
+ * [Chu-Cheng Yu]
+ */
+int corpus_shape_from_name(const char *name, corpus_shape_t *shape)
+{
+    if (!name || !shape) return ERROR_INVALID_PATH;
+    for (int i = 0; i < CORPUS_SHAPE_COUNT; ++i) {
+        if (strcmp(name, shape_names[i]) == 0) {
+            *shape = (corpus_shape_t)i;
+            return SUCCESS;
+        }
+    }
+    return ERROR_INVALID_PATH;
+}
+
+/*
+ * Next value of a seeded xorshift64* sequence
+ * [Chu-Cheng Yu]
+ */
+uint64_t corpus_random(uint64_t *state)
+{
+    /* xorshift has a fixed point at 0; any other value is as good a seed */
+    uint64_t x = *state ? *state : 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Derive an independent seed for an item of a corpus (splitmix64 finaliser)
+ * [Chu-Cheng Yu]
+ */
+uint64_t corpus_derive_seed(uint64_t seed, uint64_t index)
+{
+    uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Start a stream of generated data
+ * [Chu-Cheng Yu]
+ */
+void corpus_stream_init(corpus_stream_t *stream, corpus_shape_t shape, uint64_t seed)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->shape = shape;
+    stream->state = seed;
+}
+
+/*
+ * Generate the next bytes of a stream; the output does not depend on how
+ * the stream is split into calls
+ * [Chu-Cheng Yu]
+ */
+void corpus_generate(corpus_stream_t *stream, unsigned char *buffer, size_t size)
+{
+    size_t i = 0;
+    switch (stream->shape) {
+        case CORPUS_RUNS:
+            while (i < size) {
+                if (stream->pending == 0) {
+                    uint64_t r = corpus_random(&stream->state);
+                    stream->pending = 1 + r % 512;
+                    stream->value = (unsigned char)(r >> 32);
+                }
+                size_t n = size - i < stream->pending ? size - i : (size_t)stream->pending;
+                memset(buffer + i, stream->value, n);
+                stream->pending -= n;
+                i += n;
+            }
+            break;
+        case CORPUS_TEXT:
+            while (i < size) {
+                if (stream->word && *stream->word) {
+                    buffer[i++] = (unsigned char)*stream->word++;
+                } else if (stream->pending) {
+                    buffer[i++] = stream->value;
+                    stream->pending = 0;
+                } else {
+                    uint64_t r = corpus_random(&stream->state);
+                    stream->word = corpus_words[r % CORPUS_WORD_COUNT];
+                    stream->value = (r >> 40) % 12 == 0 ? '\n' : ' ';
+                    stream->pending = 1;
+                }
+            }
+            break;
+        case CORPUS_SPARSE:
+            /* Each gap is up to 127 zeros followed by one non-zero byte */
+            while (i < size) {
+                if (stream->pending == 0) {
+                    uint64_t r = corpus_random(&stream->state);
+                    stream->pending = 1 + r % 128;
+                    stream->value = (unsigned char)((r >> 32) | 1);
+                }
+                if (stream->pending == 1) {
+                    buffer[i++] = stream->value;
+                    stream->pending = 0;
+                } else {
+                    size_t zeros = (size_t)stream->pending - 1;
+                    size_t n = size - i < zeros ? size - i : zeros;
+                    memset(buffer + i, 0, n);
+                    stream->pending -= n;
+                    i += n;
+                }
+            }
+            break;
+        default:
+            while (i < size) {
+                if (stream->pending == 0) {
+                    /* Whole words straight out while nothing is left over */
+                    while (size - i >= 8) {
+                        uint64_t r = corpus_random(&stream->state);
+                        for (int b = 0; b < 8; ++b, r >>= 8) buffer[i++] = (unsigned char)r;
+                    }
+                    if (i == size) break;
+                    stream->bits = corpus_random(&stream->state);
+                    stream->pending = 8;
+                }
+                buffer[i++] = (unsigned char)stream->bits;
+                stream->bits >>= 8;
+                stream->pending--;
+            }
+            break;
+    }
+}
+
+/*
+ * Write a file of generated data
+ * [Chu-Cheng Yu]
+ */
+int corpus_write_file(const char *path, corpus_shape_t shape, uint64_t seed, uint64_t size,
+                      uint64_t *checksum)
+{
+    if (!path) return ERROR_INVALID_PATH;
+    unsigned char *block = malloc(CHUNK_SIZE);
+    if (!block) return ERROR_MEMORY_ALLOCATION;
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        free(block);
+        return ERROR_PERMISSION_DENIED;
+    }
+
+    corpus_stream_t stream;
+    corpus_stream_init(&stream, shape, seed);
+    checksum_state_t state;
+    checksum_init(&state);
+    int result = SUCCESS;
+    for (uint64_t done = 0; result == SUCCESS && done < size;) {
+        size_t n = size - done < CHUNK_SIZE ? (size_t)(size - done) : CHUNK_SIZE;
+        corpus_generate(&stream, block, n);
+        checksum_update(&state, block, n);
+        if (fwrite(block, 1, n, fp) != n) result = ERROR_PERMISSION_DENIED;
+        done += n;
+    }
+    if (fclose(fp) != 0 && result == SUCCESS) result = ERROR_PERMISSION_DENIED;
+    free(block);
+    if (result != SUCCESS) {
+        remove(path);
+        return result;
+    }
+    if (checksum) *checksum = checksum_final(&state);
+    return SUCCESS;
+}
+
+/*
+ * Fill in a plausible library entry for an id
+ * [Chu-Cheng Yu]
+ */
+void corpus_make_entry(file_metadata_t *metadata, unsigned long id, uint64_t *state)
+{
+    static const char *types[] = { "txt", "log", "csv", "bin", "dat", "md" };
+    memset(metadata, 0, sizeof(*metadata));
+    uint64_t r = corpus_random(state);
+    const char *type = types[r % (sizeof(types) / sizeof(types[0]))];
+    snprintf(metadata->original_filename, sizeof(metadata->original_filename),
+             "docs/%08llx/report-%lu.%s", (unsigned long long)((r >> 8) & 0xffffffffu), id, type);
+    snprintf(metadata->encrypted_filename, sizeof(metadata->encrypted_filename),
+             "report-%lu.ccrypt", id);
+    safe_string_copy(metadata->file_type, type, sizeof(metadata->file_type));
+    metadata->original_size = (long)(r >> 40);
+    metadata->encrypted_size = metadata->original_size + (long)sizeof(container_header_t);
+    metadata->encryption_id = id;
+    metadata->encryption_method = (int)ENC_XOR;
+    metadata->is_compressed = (int)((r >> 4) & 1);
+    metadata->source_mtime_ns = corpus_random(state) >> 4;
+    format_checksum(corpus_random(state), metadata->checksum, sizeof(metadata->checksum));
+}
+
+/*
+ * Fill an empty library with generated entries
+ * [Chu-Cheng Yu]
+ */
+int corpus_build_library(encryption_library_t *library, long entries, uint64_t seed)
+{
+    if (!library || entries < 0) return ERROR_INVALID_PATH;
+    memset(library, 0, sizeof(*library));
+    library->next_id = 1;
+    if (entries == 0) return SUCCESS;
+
+    file_metadata_t *batch = malloc(sizeof(file_metadata_t) * (size_t)entries);
+    if (!batch) return ERROR_MEMORY_ALLOCATION;
+    uint64_t state = seed;
+    for (long i = 0; i < entries; ++i) corpus_make_entry(&batch[i], library->next_id++, &state);
+    int result = add_files_to_library(library, batch, (int)entries);
+    free(batch);
+    return result;
+}
@@ -0,0 +1,123 @@
+/*
+ * corpus.h
+ * Header file for the synthetic benchmark corpus
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines a deterministic generator of test data in the shapes
+ * that matter to CCrypt's kernels (random bytes, long runs, text, sparse
+ * binary) and of library fixtures. Everything is derived from a seed with
+ * integer arithmetic only, so the same seed gives the same bytes on every
+ * machine, whatever block size the data is generated in.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "ccrypt.h"
+
+/*
+ * corpus_shape
+ * Kinds of generated data
+ */
+typedef enum {
+    CORPUS_RANDOM = 0,  /* incompressible bytes */
+    CORPUS_RUNS,        /* runs of 1 to 512 repeated bytes */
+    CORPUS_TEXT,        /* words, spaces and newlines */
+    CORPUS_SPARSE,      /* zeros with a non-zero byte every 64 on average */
+    CORPUS_SHAPE_COUNT
+} corpus_shape_t;
+
+/*
+ * corpus_stream
+ * Generator state for one stream of data; a stream continues exactly
+ * where the previous call left off
+ */
+typedef struct {
+    corpus_shape_t shape;
+    uint64_t state;
+    uint64_t bits;           /* random bytes not yet used */
+    uint64_t pending;        /* bytes left in bits, or in the current run or gap */
+    unsigned char value;     /* byte of the current run, separator or gap end */
+    const char *word;        /* rest of the current word */
+} corpus_stream_t;
+
+/* ========================================================================
+ * CORPUS FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Name of a shape ("random", "runs", "text" or "sparse")
+ * shape Shape to name
+ * The name, or "unknown"
+ */
+const char *corpus_shape_name(corpus_shape_t shape);
+
+/*
+ * Look up a shape by name
+ * name Shape name as returned by corpus_shape_name
+ * shape Out parameter to receive the shape
+ * SUCCESS on success, ERROR_INVALID_PATH for an unknown name
+ */
+int corpus_shape_from_name(const char *name, corpus_shape_t *shape);
+
+/*
+ * Next value of a seeded pseudo-random sequence (xorshift64*)
+ * state Sequence state; any value, including 0, may be used as a seed
+ * The next value
+ */
+uint64_t corpus_random(uint64_t *state);
+
+/*
+ * Derive an independent seed, e.g. one per file of a corpus
+ * seed Corpus seed
+ * index Index of the item
+ * The derived seed
+ */
+uint64_t corpus_derive_seed(uint64_t seed, uint64_t index);
+
+/*
+ * Start a stream of generated data
+ * stream Stream to initialise
+ * shape Shape of the data
+ * seed Seed of the data
+ */
+void corpus_stream_init(corpus_stream_t *stream, corpus_shape_t shape, uint64_t seed);
+
+/*
+ * Generate the next bytes of a stream
+ * stream Stream started with corpus_stream_init
+ * buffer Buffer to fill
+ * size Bytes to generate
+ */
+void corpus_generate(corpus_stream_t *stream, unsigned char *buffer, size_t size);
+
+/*
+ * Write a file of generated data, streaming it in CHUNK_SIZE blocks
+ * path Path of the file to create (replaced if it exists)
+ * shape Shape of the data
+ * seed Seed of the data
+ * size Bytes to write
+ * checksum Optional out parameter to receive the checksum of the contents
+ * SUCCESS on success, or an error code on failure
+ */
+int corpus_write_file(const char *path, corpus_shape_t shape, uint64_t seed, uint64_t size,
+                      uint64_t *checksum);
+
+/*
+ * Fill in a plausible library entry with a unique name for an id
+ * metadata Entry to fill in
+ * id Encryption id of the entry
+ * state Sequence state the rest of the entry is drawn from
+ */
+void corpus_make_entry(file_metadata_t *metadata, unsigned long id, uint64_t *state);
+
+/*
+ * Fill an empty library with generated entries, in random name order
+ * library Library to initialise (any previous contents are not freed)
+ * entries Number of entries
+ * seed Seed of the entries
+ * SUCCESS on success, or an error code on failure
+ */
+int corpus_build_library(encryption_library_t *library, long entries, uint64_t seed);
+
+#endif /* CORPUS_H */
@@ -11,6 +11,26 @@
 #include "ui.h"
 #include "library.h"
 #include "utils.h"
+#include "platform.h"
+#include "checksum.h"
+#include "chunk_store.h"
+#include "pack.h"
+#include "stats.h"
+#include "buffer_pool.h"
+
+/* forward declarations for internal helpers */
+static int decrypt_container_stream(FILE *fin, const container_header_t *header,
+                                    const char *output_path, const char *password,
+                                    long *output_size);
+static int decrypt_in_place_stream(FILE *fin, const container_header_t *trailer,
+                                   const char *output_path, const char *password,
+                                   long *output_size);
+static int load_chunk_index(FILE *fin, container_header_t *header,
+                            chunk_index_entry_t **index);
+static int read_indexed_chunk(FILE *fin, const chunk_index_entry_t *entry,
+                              unsigned char *stored_data);
+static int link_duplicate_content(encryption_library_t *library, const char *file_path,
+                                  const char *key_fingerprint, file_metadata_t *metadata);
 
 /* ========================================================================
  * FILE ENCRYPTION FUNCTIONS
@@ -25,6 +45,7 @@ int encrypt_file_workflow(encryption_library_t *library)
     char file_path[MAX_PATH_LENGTH];
     char password[MAX_PASSWORD_LENGTH];
     char encrypted_filename[MAX_FILENAME_LENGTH];
+    char encrypted_path[MAX_PATH_LENGTH];
     file_metadata_t metadata;
     int use_compression;
     int result;
@@ -44,6 +65,12 @@ int encrypt_file_workflow(encryption_library_t *library)
     if (use_compression < 0) {
         return ERROR_INVALID_PATH;
     }
+
+    /* In-place mode rewrites the file itself; compression changes its size */
+    int in_place = 0;
+    if (!use_compression) {
+        in_place = get_user_confirmation("Encrypt in place without keeping a second copy? (y/n): ");
+    }
     
     /* Get password */
     printf("Enter encryption password: ");
@@ -57,25 +84,59 @@ int encrypt_file_workflow(encryption_library_t *library)
         password[pwlen - 1] = '\0';
     }
     
-    /* Generate encrypted filename using library next_id */
-    result = generate_encrypted_filename(file_path, encrypted_filename, sizeof(encrypted_filename), library->next_id);
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+    compute_key_fingerprint(password, key_fingerprint, sizeof(key_fingerprint));
+
+    /* Content already encrypted under this key: add an entry for the existing
+       file instead of encrypting it again. In-place mode is left alone since
+       it is expected to consume the plaintext. */
+    if (!in_place &&
+        link_duplicate_content(library, file_path, key_fingerprint, &metadata) == SUCCESS) {
+        metadata.encryption_id = library->next_id;
+        result = add_file_to_library(library, &metadata);
+        if (result == SUCCESS) {
+            library->next_id++;
+            printf("Identical content is already encrypted as %s; linked instead of re-encrypting\n",
+                   metadata.encrypted_filename);
+        }
+        secure_memory_clear(password, sizeof(password));
+        return result;
+    }
+
+    /* Generate encrypted filename, adding the library next_id if the plain
+       name is taken, and the fanned-out path the file is written to */
+    result = generate_encrypted_filename(file_path, encrypted_filename, sizeof(encrypted_filename), 0);
+    if (result == SUCCESS && find_library_entry_by_encrypted_name(library, encrypted_filename)) {
+        result = generate_encrypted_filename(file_path, encrypted_filename,
+                                             sizeof(encrypted_filename), library->next_id);
+    }
+    if (result == SUCCESS) {
+        result = generate_encrypted_path(library->next_id, encrypted_path, sizeof(encrypted_path));
+    }
     if (result != SUCCESS) {
         return result;
     }
     
     /* Perform encryption */
-    result = encrypt_file(file_path, encrypted_filename, password, use_compression, method, &metadata);
+    if (in_place) {
+        result = encrypt_file_in_place(file_path, encrypted_path, password, method, &metadata);
+    } else {
+        result = encrypt_file(file_path, encrypted_path, password, use_compression, method, &metadata);
+    }
     if (result != SUCCESS) {
         return result;
     }
+    set_encrypted_location(&metadata, encrypted_filename, encrypted_path);
     
     /* Add to library */
     /* Set metadata id and add to library */
     metadata.encryption_id = library->next_id;
+    safe_string_copy(metadata.key_fingerprint, key_fingerprint, sizeof(metadata.key_fingerprint));
     result = add_file_to_library(library, &metadata);
     if (result == SUCCESS) {
         library->next_id++;
-        printf("File encrypted successfully and added to library\n");
+        printf("File encrypted successfully and added to library as %s\n",
+               metadata.encrypted_filename);
     }
     
     /* Clear password from memory */
@@ -107,87 +168,246 @@ FILE *fin = fopen(input_path, "rb");
     }
 
     /* Determine file size */
-    fseek(fin, 0, SEEK_END);
-    long input_size = ftell(fin);
-    fseek(fin, 0, SEEK_SET);
-
-    if (input_size <= 0) {
-        printf("Error: input file size invalid (%ld)\n", input_size);
+    uint64_t input_size = 0;
+    if (platform_stream_size(fin, &input_size) != SUCCESS || input_size == 0) {
+        printf("Error: input file size invalid (%llu)\n", (unsigned long long)input_size);
         fclose(fin);
         fclose(fout);
         return ERROR_FILE_NOT_FOUND;
     }
 
-    /* Read entire file */
-    unsigned char *input_data = malloc(input_size);
-    if (!input_data) {
+    /* Recorded so a later sync can tell whether the source changed */
+    platform_file_id_t source_id;
+    if (platform_file_identity(input_path, &source_id) != SUCCESS) {
+        source_id.mtime_ns = 0;
+    }
+
+    /* One chunk-sized buffer each way: every byte is read once and written
+       once. The buffers come from the shared pool, so a batch of files
+       reuses the same few instead of allocating fresh ones per file */
+    uint64_t chunk_count = (input_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t index_size = sizeof(chunk_index_entry_t) * (size_t)chunk_count;
+    size_t leaves_size = sizeof(uint64_t) * (size_t)chunk_count;
+    unsigned char *input_data = buffer_pool_acquire(CHUNK_SIZE);
+    unsigned char *output_data = buffer_pool_acquire(CHUNK_SIZE);
+    chunk_index_entry_t *index = buffer_pool_acquire(index_size);
+    uint64_t *leaves = buffer_pool_acquire(leaves_size);
+    if (!input_data || !output_data || !index || !leaves) {
+        buffer_pool_release(input_data, CHUNK_SIZE);
+        buffer_pool_release(output_data, CHUNK_SIZE);
+        buffer_pool_release(index, index_size);
+        buffer_pool_release(leaves, leaves_size);
         fclose(fin);
         fclose(fout);
         return ERROR_MEMORY_ALLOCATION;
     }
-    fread(input_data, 1, input_size, fin);
-    fclose(fin);
-
-    /* Optional compression */
-    unsigned char *processed_data = input_data;
-    long processed_size = input_size;
+    STATS_FILE(stats);
+    STATS_FILE_BEGIN(stats, STATS_OPERATION_ENCRYPT);
+
+    /* Header is rewritten with the payload size once all chunks are out */
+    container_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature));
+    header.version = CONTAINER_VERSION;
+    header.flags = use_compression ? CONTAINER_FLAG_COMPRESSED : 0;
+    header.chunk_size = CHUNK_SIZE;
+    header.original_size = input_size;
+    fwrite(&header, sizeof(header), 1, fout);
+
+    /* Checksums are accumulated over the buffers already in memory */
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    checksum_init(&plain_state);
+    checksum_init(&cipher_state);
+
+    int result = SUCCESS;
+    uint64_t total_read = 0;
+    uint64_t payload_size = 0;
+    uint64_t chunk_number = 0;
+    while (total_read < input_size) {
+        STATS_START(read_started);
+        size_t n = fread(input_data, 1, CHUNK_SIZE, fin);
+        STATS_STOP(stats, STATS_READ, read_started, n);
+        if (n == 0) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
 
-    if (use_compression) {
-        unsigned char *compressed_data = malloc(input_size * 2);
-        if (!compressed_data) {
-            free(input_data);
-            fclose(fout);
-            return ERROR_MEMORY_ALLOCATION;
+        /* Chunks are keyed from their plaintext offset so each is independent */
+        long stored_size = (long)n;
+        STATS_START(encrypt_started);
+        if (use_compression) {
+            result = compress_encrypt_chunk(input_data, (long)n, password, (long)total_read,
+                                            output_data, &stored_size);
+            STATS_STOP(stats, STATS_COMPRESS, encrypt_started, n);
+        } else {
+            result = encrypt_data_at(input_data, (long)n, password, (long)total_read,
+                                     output_data);
+            STATS_STOP(stats, STATS_ENCRYPT, encrypt_started, n);
+        }
+        if (result != SUCCESS) {
+            printf("Error: encryption failed (code %d).\n", result);
+            break;
+        }
+        if (chunk_number >= chunk_count) {
+            result = ERROR_ENCRYPTION_FAILED;   /* file grew while reading */
+            break;
         }
-        int comp_result = compress_data(input_data, input_size, compressed_data, &processed_size);
-        if (comp_result != SUCCESS) {
-            printf("Error: compression failed (code %d).\n", comp_result);
-            free(input_data);
-            free(compressed_data);
-            fclose(fout);
-            return comp_result;
+        STATS_START(checksum_started);
+        checksum_update(&plain_state, input_data, n);
+        checksum_update(&cipher_state, output_data, (size_t)stored_size);
+
+        /* Merkle leaf for this chunk, hashed while it is still in cache */
+        chunk_index_entry_t *entry = &index[chunk_number];
+        entry->offset = sizeof(header) + payload_size + chunk_number * sizeof(chunk_header_t);
+        entry->raw_size = (uint32_t)n;
+        entry->stored_size = (uint32_t)stored_size;
+        entry->hash = checksum_buffer(output_data, (size_t)stored_size);
+        leaves[chunk_number] = entry->hash;
+        STATS_STOP(stats, STATS_CHECKSUM, checksum_started, n + 2 * (size_t)stored_size);
+
+        chunk_header_t chunk;
+        chunk.raw_size = (uint32_t)n;
+        chunk.stored_size = (uint32_t)stored_size;
+        STATS_START(write_started);
+        if (fwrite(&chunk, sizeof(chunk), 1, fout) != 1 ||
+            fwrite(output_data, 1, (size_t)stored_size, fout) != (size_t)stored_size) {
+            result = ERROR_ENCRYPTION_FAILED;
+            break;
         }
-        free(input_data);
-        processed_data = compressed_data;
+        STATS_STOP(stats, STATS_WRITE, write_started, sizeof(chunk) + (size_t)stored_size);
+        total_read += n;
+        payload_size += (uint64_t)stored_size;
+        chunk_number++;
     }
+    fclose(fin);
+    buffer_pool_release(input_data, CHUNK_SIZE);
+    buffer_pool_release(output_data, CHUNK_SIZE);
 
-    /* XOR encryption */
-    unsigned char *encrypted_data = malloc(processed_size);
-    if (!encrypted_data) {
-        free(processed_data);
-        fclose(fout);
-        return ERROR_MEMORY_ALLOCATION;
+    /* Chunk index and Merkle root follow the last chunk */
+    if (result == SUCCESS) {
+        header.plaintext_checksum = checksum_final(&plain_state);
+        header.ciphertext_checksum = checksum_final(&cipher_state);
+        result = finish_container(fout, &header, index, leaves, chunk_number, payload_size);
     }
-
-    int enc_result = encrypt_data(processed_data, processed_size, password, encrypted_data);
-    if (enc_result != SUCCESS) {
-        free(processed_data);
-        free(encrypted_data);
-        fclose(fout);
-        return enc_result;
+    buffer_pool_release(index, index_size);
+    buffer_pool_release(leaves, leaves_size);
+    uint64_t output_size = 0;
+    platform_stream_size(fout, &output_size);
+    if (fclose(fout) != 0 && result == SUCCESS) {
+        result = ERROR_ENCRYPTION_FAILED;
+    }
+    if (result != SUCCESS) {
+        remove(output_path);
+        return result;
     }
-
-    /* Write encrypted output */
-    fwrite(encrypted_data, 1, processed_size, fout);
-    fclose(fout);
 
     /* Populate metadata */
     memset(metadata, 0, sizeof(file_metadata_t));
     safe_string_copy(metadata->original_filename, input_path, sizeof(metadata->original_filename));
     safe_string_copy(metadata->encrypted_filename, output_path, sizeof(metadata->encrypted_filename));
     metadata->is_compressed = use_compression;
-    metadata->original_size = input_size;
-    metadata->encrypted_size = processed_size;
+    metadata->original_size = (long)input_size;
+    metadata->encrypted_size = (long)output_size;
     metadata->encryption_method = (int)method;
+    metadata->source_mtime_ns = source_id.mtime_ns;
+    format_checksum(header.plaintext_checksum, metadata->checksum, sizeof(metadata->checksum));
 
-    free(encrypted_data);
-    free(processed_data);
-
-    printf("Encrypted: %s → %s (%ld bytes → %ld bytes)\n",
-           input_path, output_path, input_size, processed_size);
+    printf("Encrypted: %s → %s (%llu bytes → %llu bytes)\n", input_path, output_path,
+           (unsigned long long)input_size, (unsigned long long)output_size);
     if (use_compression)
         printf("Compression applied before encryption.\n");
+    STATS_FILE_END(stats, input_path, input_size, output_size);
+
+    return SUCCESS;
+}
 
+/*
+ * Write the chunk index after the last chunk and rewrite the header
+ * [Chu-Cheng Yu]
+ */
+int finish_container(FILE *fout, container_header_t *header, const chunk_index_entry_t *index,
+                     const uint64_t *leaves, uint64_t chunk_count, uint64_t payload_size)
+{
+    if (!fout || !header || (chunk_count > 0 && (!index || !leaves))) return ERROR_INVALID_PATH;
+
+    header->index_offset = sizeof(*header) + payload_size + chunk_count * sizeof(chunk_header_t);
+    header->chunk_count = chunk_count;
+    header->payload_size = payload_size;
+    header->flags |= CONTAINER_FLAG_CIPHER_CHECKSUM;
+    int result = merkle_root(leaves, chunk_count, &header->merkle_root);
+    if (result != SUCCESS) return result;
+
+    if (fwrite(index, sizeof(chunk_index_entry_t), (size_t)chunk_count, fout) != (size_t)chunk_count ||
+        fseek(fout, 0, SEEK_SET) != 0 ||
+        fwrite(header, sizeof(*header), 1, fout) != 1) {
+        return ERROR_ENCRYPTION_FAILED;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Derive the key fingerprint stored with library entries
+ * [Chu-Cheng Yu]
+ */
+int compute_key_fingerprint(const char *password, char *fingerprint, size_t buffer_size)
+{
+    if (!password || !fingerprint || buffer_size <= KEY_FINGERPRINT_LENGTH) return ERROR_INVALID_PATH;
+
+    /* Domain-separated from file checksums, then iterated so a stolen
+       library is slower to test password guesses against */
+    uint64_t h = checksum_buffer((const unsigned char *)"ccrypt-key", 10);
+    h = merkle_combine(h, checksum_buffer((const unsigned char *)password, strlen(password)));
+    for (uint64_t round = 0; round < KEY_FINGERPRINT_ROUNDS; ++round) {
+        h = merkle_combine(h, round);
+    }
+    format_checksum(h, fingerprint, buffer_size);
+    return SUCCESS;
+}
+
+/*
+ * Find a library entry with the same plaintext and key and copy it for a
+ * new source path. The plaintext is only hashed when an entry of the same
+ * size and key exists, so unique files cost nothing extra.
+ * library Pointer to the encryption library
+ * file_path Path of the file about to be encrypted
+ * key_fingerprint Fingerprint of the password it will be encrypted with
+ * metadata Out parameter to receive the entry for file_path
+ * SUCCESS if an existing encrypted file can be reused, ERROR_FILE_NOT_FOUND otherwise
+ * [Chu-Cheng Yu]
+ */
+static int link_duplicate_content(encryption_library_t *library, const char *file_path,
+                                  const char *key_fingerprint, file_metadata_t *metadata)
+{
+    platform_file_id_t id;
+    if (platform_file_identity(file_path, &id) != SUCCESS) return ERROR_FILE_NOT_FOUND;
+
+    int candidates = 0;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if ((uint64_t)cur->data.original_size == id.size &&
+            strncmp(cur->data.key_fingerprint, key_fingerprint, sizeof(cur->data.key_fingerprint)) == 0) {
+            candidates++;
+        }
+    }
+    if (candidates == 0) return ERROR_FILE_NOT_FOUND;
+
+    char checksum[CHECKSUM_HEX_LENGTH + 1];
+    if (calculate_file_checksum(file_path, checksum, sizeof(checksum)) != SUCCESS) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+    const file_metadata_t *existing = find_library_entry_by_content(library, (long)id.size,
+                                                                    checksum, key_fingerprint);
+    if (!existing || (existing->pack_id == 0 &&
+                      validate_file_path(encrypted_file_location(existing)) != SUCCESS)) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    /* Shares the encrypted file, but the source is this one: sync compares
+       the recorded size and mtime against it */
+    *metadata = *existing;
+    safe_string_copy(metadata->original_filename, file_path, sizeof(metadata->original_filename));
+    metadata->original_size = (long)id.size;
+    metadata->source_mtime_ns = id.mtime_ns;
     return SUCCESS;
 }
 
@@ -210,11 +430,19 @@ int decrypt_file_workflow(encryption_library_t *library)
     }
     encrypted_path[strcspn(encrypted_path, "\r\n")] = 0;  /* Strip newline */
 
+    /* Use library metadata (compression flag, original size) when tracked.
+       A packed file only exists inside its packfile, so it has no path. */
+    const file_metadata_t *metadata = find_library_entry_by_encrypted_name(library, encrypted_path);
+    int is_packed = metadata && metadata->pack_id != 0;
+    const char *location = metadata ? encrypted_file_location(metadata) : encrypted_path;
+
     /* Validate the path */
-    result = validate_file_path(encrypted_path);
-    if (result != SUCCESS) {
-        printf("Error: could not open encrypted file '%s'\n", encrypted_path);
-        return result;
+    if (!is_packed) {
+        result = validate_file_path(location);
+        if (result != SUCCESS) {
+            printf("Error: could not open encrypted file '%s'\n", encrypted_path);
+            return result;
+        }
     }
 
     /* Ask user for password */
@@ -250,8 +478,29 @@ int decrypt_file_workflow(encryption_library_t *library)
     dummy_metadata.is_compressed = 0;
     dummy_metadata.original_size = 0;
 
+    if (!metadata) {
+        metadata = &dummy_metadata;
+    }
+
     /* Perform actual decryption */
-    result = decrypt_file(encrypted_path, output_path, password, ENC_XOR, &dummy_metadata);
+    if (is_packed) {
+        long output_size = 0;
+        result = decrypt_packed_file(metadata, output_path, password, &output_size);
+    } else if (is_in_place_encrypted(location) &&
+               (metadata == &dummy_metadata ||
+                count_location_references(library, location) == 1) &&
+               get_user_confirmation("Decrypt in place without keeping a second copy? (y/n): ")) {
+        /* The encrypted file is gone afterwards, even when its plaintext
+           fails the checksum, so its entry goes too; a file shared with
+           linked duplicates is never decrypted in place */
+        result = decrypt_file_in_place(location, output_path, password);
+        if ((result == SUCCESS || result == ERROR_CHECKSUM_MISMATCH) &&
+            metadata != &dummy_metadata) {
+            remove_file_from_library(library, get_library_index(library, metadata));
+        }
+    } else {
+        result = decrypt_file(location, output_path, password, ENC_XOR, metadata);
+    }
     if (result == SUCCESS) {
         printf("Decryption complete.\n");
     } else {
@@ -279,6 +528,176 @@ int select_file_for_decryption(encryption_library_t *library, int *selected_inde
     return SUCCESS;
 }
 
+/*
+ * Decrypt the chunk stream of a container whose header has already been read
+ * fin Encrypted file positioned just after the container header
+ * header Container header read from fin
+ * output_path Path where the decrypted output should be written
+ * password Password used for decryption
+ * output_size Out parameter to receive the number of bytes written
+ * SUCCESS on success, or an error code on failure (output is removed)
+ * [Agam Grewal]
+ */
+static int decrypt_container_stream(FILE *fin, const container_header_t *header,
+                                    const char *output_path, const char *password,
+                                    long *output_size)
+{
+    if (header->version != CONTAINER_VERSION || header->chunk_size == 0 ||
+        header->chunk_size > MAX_CHUNK_SIZE) {
+        return ERROR_CONTAINER_CORRUPT;
+    }
+
+    unsigned char *stored_data = buffer_pool_acquire(header->chunk_size);
+    unsigned char *output_data = buffer_pool_acquire(header->chunk_size);
+    if (!stored_data || !output_data) {
+        buffer_pool_release(stored_data, header->chunk_size);
+        buffer_pool_release(output_data, header->chunk_size);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    FILE *fout = fopen(output_path, "wb");
+    if (!fout) {
+        printf("Error: could not create output file.\n");
+        buffer_pool_release(stored_data, header->chunk_size);
+        buffer_pool_release(output_data, header->chunk_size);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    checksum_init(&plain_state);
+    checksum_init(&cipher_state);
+
+    STATS_FILE(stats);
+    STATS_FILE_BEGIN(stats, STATS_OPERATION_DECRYPT);
+    int result = SUCCESS;
+    uint64_t total = 0;
+    while (total < header->original_size) {
+        chunk_header_t chunk;
+        STATS_START(read_started);
+        if (fread(&chunk, sizeof(chunk), 1, fin) != 1 ||
+            chunk.raw_size == 0 || chunk.raw_size > header->chunk_size ||
+            chunk.stored_size > chunk.raw_size ||
+            chunk.raw_size > header->original_size - total) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        if (fread(stored_data, 1, chunk.stored_size, fin) != chunk.stored_size) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        STATS_STOP(stats, STATS_READ, read_started, sizeof(chunk) + chunk.stored_size);
+
+        STATS_START(checksum_started);
+        checksum_update(&cipher_state, stored_data, chunk.stored_size);
+        STATS_STOP(stats, STATS_CHECKSUM, checksum_started, chunk.stored_size);
+
+        long n = 0;
+        STATS_START(decrypt_started);
+        result = decrypt_decompress_chunk(stored_data, (long)chunk.stored_size, password,
+                                          (long)total, output_data, (long)chunk.raw_size, &n);
+        STATS_STOP(stats, STATS_DECRYPT, decrypt_started, chunk.raw_size);
+        if (result != SUCCESS) break;
+        STATS_START(plain_checksum_started);
+        checksum_update(&plain_state, output_data, (size_t)n);
+        STATS_STOP(stats, STATS_CHECKSUM, plain_checksum_started, n);
+        STATS_START(write_started);
+        if (fwrite(output_data, 1, (size_t)n, fout) != (size_t)n) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+        STATS_STOP(stats, STATS_WRITE, write_started, n);
+        total += (uint64_t)n;
+    }
+
+    buffer_pool_release(stored_data, header->chunk_size);
+    buffer_pool_release(output_data, header->chunk_size);
+    if (fclose(fout) != 0 && result == SUCCESS) {
+        result = ERROR_FILE_NOT_FOUND;
+    }
+
+    /* Verified on the fly: no second read of either file */
+    if (result == SUCCESS && (header->flags & CONTAINER_FLAG_CIPHER_CHECKSUM) &&
+        checksum_final(&cipher_state) != header->ciphertext_checksum) {
+        printf("Error: encrypted file has been modified or damaged.\n");
+        result = ERROR_CHECKSUM_MISMATCH;
+    } else if (result == SUCCESS &&
+               checksum_final(&plain_state) != header->plaintext_checksum) {
+        printf("Error: decrypted data does not match its checksum (wrong password?).\n");
+        result = ERROR_CHECKSUM_MISMATCH;
+    }
+    if (result != SUCCESS) {
+        remove(output_path);
+        return result;
+    }
+    STATS_FILE_END(stats, output_path,
+                   sizeof(*header) + header->payload_size +
+                   header->chunk_count * sizeof(chunk_header_t), total);
+    *output_size = (long)total;
+    return SUCCESS;
+}
+
+/*
+ * Decrypt a file encrypted in place into a separate output file
+ * fin Encrypted file
+ * trailer Trailer read from the end of fin
+ * output_path Path where the decrypted output should be written
+ * password Password used for decryption
+ * output_size Out parameter to receive the number of bytes written
+ * SUCCESS on success, or an error code on failure (output is removed)
+ * [Agam Grewal]
+ */
+static int decrypt_in_place_stream(FILE *fin, const container_header_t *trailer,
+                                   const char *output_path, const char *password,
+                                   long *output_size)
+{
+    if (trailer->version != CONTAINER_VERSION) return ERROR_CONTAINER_CORRUPT;
+
+    unsigned char *buffer = buffer_pool_acquire(CHUNK_SIZE);
+    if (!buffer) return ERROR_MEMORY_ALLOCATION;
+    FILE *fout = fopen(output_path, "wb");
+    if (!fout) {
+        printf("Error: could not create output file.\n");
+        buffer_pool_release(buffer, CHUNK_SIZE);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    checksum_state_t plain_state;
+    checksum_init(&plain_state);
+
+    int result = SUCCESS;
+    long total = (long)trailer->original_size;
+    long offset = 0;
+    fseek(fin, 0, SEEK_SET);
+    while (offset < total) {
+        size_t n = (size_t)(total - offset < CHUNK_SIZE ? total - offset : CHUNK_SIZE);
+        if (fread(buffer, 1, n, fin) != n) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        decrypt_data_at(buffer, (long)n, password, offset, buffer);
+        checksum_update(&plain_state, buffer, n);
+        if (fwrite(buffer, 1, n, fout) != n) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+        offset += (long)n;
+    }
+
+    buffer_pool_release(buffer, CHUNK_SIZE);   /* wipes the plaintext */
+    if (fclose(fout) != 0 && result == SUCCESS) result = ERROR_FILE_NOT_FOUND;
+    if (result == SUCCESS && checksum_final(&plain_state) != trailer->plaintext_checksum) {
+        printf("Error: decrypted data does not match its checksum (wrong password?).\n");
+        result = ERROR_CHECKSUM_MISMATCH;
+    }
+    if (result != SUCCESS) {
+        remove(output_path);
+        return result;
+    }
+    *output_size = offset;
+    return SUCCESS;
+}
+
 /*
  * Decrypt an encrypted file (placeholder implementation)
  * encrypted_path Path to the encrypted input file
@@ -298,6 +717,61 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
         return ERROR_FILE_NOT_FOUND;
     }
 
+    /* Chunked container written by encrypt_file: stream it chunk by chunk */
+    container_header_t header;
+    if (fread(&header, sizeof(header), 1, fin) == 1 &&
+        memcmp(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature)) == 0) {
+        long stream_size = 0;
+        int stream_result = decrypt_container_stream(fin, &header, output_path,
+                                                     password, &stream_size);
+        fclose(fin);
+        if (stream_result != SUCCESS) {
+            printf("Error: decryption failed.\n");
+            return stream_result;
+        }
+        printf("File decrypted successfully.\n");
+        printf("Input: %s\n", encrypted_path);
+        printf("Output: %s (%ld bytes)\n", output_path, stream_size);
+        if (header.flags & CONTAINER_FLAG_COMPRESSED)
+            printf("Decompression applied after decryption.\n");
+        return SUCCESS;
+    }
+
+    /* Recipe of chunks kept in the deduplicated chunk store */
+    if (memcmp(header.signature, RECIPE_SIGNATURE, sizeof(header.signature)) == 0) {
+        fclose(fin);
+        long stream_size = 0;
+        int store_result = decrypt_file_from_store(encrypted_path, output_path, password,
+                                                   &stream_size);
+        if (store_result != SUCCESS) {
+            printf("Error: decryption failed.\n");
+            return store_result;
+        }
+        printf("File decrypted successfully.\n");
+        printf("Input: %s\n", encrypted_path);
+        printf("Output: %s (%ld bytes)\n", output_path, stream_size);
+        return SUCCESS;
+    }
+
+    /* Encrypted in place: plain keystream followed by a trailer */
+    if (read_in_place_trailer(fin, &header) == SUCCESS) {
+        long stream_size = 0;
+        int stream_result = decrypt_in_place_stream(fin, &header, output_path,
+                                                    password, &stream_size);
+        fclose(fin);
+        if (stream_result != SUCCESS) {
+            printf("Error: decryption failed.\n");
+            return stream_result;
+        }
+        printf("File decrypted successfully.\n");
+        printf("Input: %s\n", encrypted_path);
+        printf("Output: %s (%ld bytes)\n", output_path, stream_size);
+        return SUCCESS;
+    }
+
+    /* Headerless file from an earlier version: whole-file XOR (+ RLE) */
+    fseek(fin, 0, SEEK_SET);
+
     /* Determine encrypted file size */
     fseek(fin, 0, SEEK_END);
     long enc_size = ftell(fin);
@@ -313,52 +787,57 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
     fread(enc_data, 1, enc_size, fin);
     fclose(fin);
 
-    /* Allocate memory for decrypted data */
-    unsigned char *dec_data = malloc(enc_size);
-    if (!dec_data) {
-        free(enc_data);
-        return ERROR_MEMORY_ALLOCATION;
-    }
-
-    /* Perform XOR decryption */
-    int dec_result = decrypt_data(enc_data, enc_size, password, dec_data);
+    /* Perform XOR decryption in place; no second buffer needed */
+    int dec_result = decrypt_data(enc_data, enc_size, password, enc_data);
     if (dec_result != SUCCESS) {
         printf("Error: decryption failed.\n");
         free(enc_data);
-        free(dec_data);
         return dec_result;
     }
 
     /* Handle decompression if metadata indicates compressed */
-    unsigned char *final_data = dec_data;
+    unsigned char *final_data = enc_data;
     long final_size = enc_size;
 
     if (metadata && metadata->is_compressed) {
-        unsigned char *decompressed = malloc(metadata->original_size * 2);
-        if (!decompressed) {
+        /* Expected size comes from metadata; fall back to scanning the runs */
+        long expected_size = metadata->original_size;
+        if (expected_size <= 0 &&
+            get_decompressed_size(enc_data, enc_size, &expected_size) != SUCCESS) {
+            printf("Error: decompression failed.\n");
             free(enc_data);
-            free(dec_data);
-            return ERROR_MEMORY_ALLOCATION;
+            return ERROR_COMPRESSION_FAILED;
         }
 
-        int decomp_result = decompress_data(dec_data, enc_size, decompressed, &final_size);
-        if (decomp_result != SUCCESS) {
-            printf("Error: decompression failed.\n");
+        /* compress_data stores the input unchanged when RLE does not shrink
+           it, so a payload of exactly the original size is already plain */
+        if (enc_size != expected_size) {
+            unsigned char *decompressed = malloc(expected_size > 0 ? expected_size : 1);
+            if (!decompressed) {
+                free(enc_data);
+                return ERROR_MEMORY_ALLOCATION;
+            }
+
+            int decomp_result = decompress_data(enc_data, enc_size, decompressed,
+                                                expected_size, &final_size);
+            if (decomp_result == SUCCESS && final_size != expected_size) {
+                decomp_result = ERROR_COMPRESSION_FAILED;
+            }
             free(enc_data);
-            free(dec_data);
-            free(decompressed);
-            return decomp_result;
-        }
+            if (decomp_result != SUCCESS) {
+                printf("Error: decompression failed.\n");
+                free(decompressed);
+                return decomp_result;
+            }
 
-        free(dec_data);
-        final_data = decompressed;
+            final_data = decompressed;
+        }
     }
 
     /* Write decrypted (and possibly decompressed) data to output */
     FILE *fout = fopen(output_path, "wb");
     if (!fout) {
         printf("Error: could not create output file.\n");
-        free(enc_data);
         free(final_data);
         return ERROR_FILE_NOT_FOUND;
     }
@@ -367,7 +846,6 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
     fclose(fout);
 
     /* Clean up */
-    free(enc_data);
     free(final_data);
 
     printf("File decrypted successfully.\n");
@@ -379,6 +857,797 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
     return SUCCESS;
 }
 
+/* ========================================================================
+ * PARTIAL DECRYPTION AND SCRUBBING
+ * ======================================================================== */
+
+/*
+ * Read a container header and its chunk index, checking the index against
+ * the Merkle root so individual chunk hashes can be trusted
+ * fin Open encrypted file
+ * header Out parameter to receive the container header
+ * index Out parameter to receive a malloc'd array of header->chunk_count entries
+ * SUCCESS on success, ERROR_CONTAINER_CORRUPT if there is no usable index,
+ * ERROR_CHECKSUM_MISMATCH if the index does not match the root
+ * [Chu-Cheng Yu]
+ */
+static int load_chunk_index(FILE *fin, container_header_t *header,
+                            chunk_index_entry_t **index)
+{
+    *index = NULL;
+    fseek(fin, 0, SEEK_SET);
+    if (fread(header, sizeof(*header), 1, fin) != 1 ||
+        memcmp(header->signature, CONTAINER_SIGNATURE, sizeof(header->signature)) != 0 ||
+        header->version != CONTAINER_VERSION || header->chunk_size == 0 ||
+        header->chunk_size > MAX_CHUNK_SIZE || header->index_offset == 0 ||
+        header->chunk_count != (header->original_size + header->chunk_size - 1) / header->chunk_size) {
+        return ERROR_CONTAINER_CORRUPT;
+    }
+
+    size_t count = (size_t)header->chunk_count;
+    chunk_index_entry_t *entries = malloc(sizeof(chunk_index_entry_t) * count);
+    uint64_t *leaves = malloc(sizeof(uint64_t) * count);
+    if (!entries || !leaves) {
+        free(entries);
+        free(leaves);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    if (platform_seek(fin, header->index_offset) != SUCCESS ||
+        fread(entries, sizeof(chunk_index_entry_t), count, fin) != count) {
+        free(entries);
+        free(leaves);
+        return ERROR_CONTAINER_CORRUPT;
+    }
+
+    for (size_t i = 0; i < count; ++i) leaves[i] = entries[i].hash;
+    uint64_t root = 0;
+    int result = merkle_root(leaves, header->chunk_count, &root);
+    free(leaves);
+    if (result == SUCCESS && root != header->merkle_root) {
+        result = ERROR_CHECKSUM_MISMATCH;
+    }
+    if (result != SUCCESS) {
+        free(entries);
+        return result;
+    }
+    *index = entries;
+    return SUCCESS;
+}
+
+/*
+ * Read one chunk's stored bytes through the index and check its leaf hash
+ * fin Open encrypted file
+ * entry Index entry of the chunk
+ * stored_data Buffer of at least entry->stored_size bytes
+ * SUCCESS if the chunk matches its hash, ERROR_CHECKSUM_MISMATCH otherwise
+ * [Chu-Cheng Yu]
+ */
+static int read_indexed_chunk(FILE *fin, const chunk_index_entry_t *entry,
+                              unsigned char *stored_data)
+{
+    chunk_header_t chunk;
+    if (platform_seek(fin, entry->offset) != SUCCESS ||
+        fread(&chunk, sizeof(chunk), 1, fin) != 1 ||
+        chunk.raw_size != entry->raw_size || chunk.stored_size != entry->stored_size ||
+        fread(stored_data, 1, chunk.stored_size, fin) != chunk.stored_size ||
+        checksum_buffer(stored_data, chunk.stored_size) != entry->hash) {
+        return ERROR_CHECKSUM_MISMATCH;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Decrypt a byte range of a container, reading only the chunks it covers
+ * [Chu-Cheng Yu]
+ */
+int decrypt_file_range(const char *encrypted_path, const char *output_path,
+                       const char *password, long offset, long length)
+{
+    if (offset < 0 || length <= 0) return ERROR_INVALID_PATH;
+
+    FILE *fin = fopen(encrypted_path, "rb");
+    if (!fin) {
+        printf("Error: could not open encrypted file.\n");
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    container_header_t header;
+    chunk_index_entry_t *index = NULL;
+    int result = load_chunk_index(fin, &header, &index);
+    if (result != SUCCESS) {
+        printf("Error: '%s' has no valid chunk index.\n", encrypted_path);
+        fclose(fin);
+        return result;
+    }
+    if ((uint64_t)offset >= header.original_size) {
+        free(index);
+        fclose(fin);
+        return ERROR_INVALID_PATH;
+    }
+    uint64_t end = (uint64_t)offset + (uint64_t)length;
+    if (end > header.original_size) end = header.original_size;
+
+    unsigned char *stored_data = malloc(header.chunk_size);
+    unsigned char *output_data = malloc(header.chunk_size);
+    FILE *fout = (stored_data && output_data) ? fopen(output_path, "wb") : NULL;
+    if (!fout) {
+        result = (stored_data && output_data) ? ERROR_FILE_NOT_FOUND : ERROR_MEMORY_ALLOCATION;
+        free(stored_data);
+        free(output_data);
+        free(index);
+        fclose(fin);
+        return result;
+    }
+
+    uint64_t first = (uint64_t)offset / header.chunk_size;
+    uint64_t last = (end - 1) / header.chunk_size;
+    long written = 0;
+    for (uint64_t i = first; i <= last && result == SUCCESS; ++i) {
+        const chunk_index_entry_t *entry = &index[i];
+        uint64_t chunk_start = i * header.chunk_size;
+        if (entry->raw_size == 0 || entry->raw_size > header.chunk_size ||
+            entry->stored_size > entry->raw_size) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        result = read_indexed_chunk(fin, entry, stored_data);
+        if (result != SUCCESS) {
+            printf("Error: chunk %llu is damaged.\n", (unsigned long long)i);
+            break;
+        }
+
+        long n = 0;
+        result = decrypt_decompress_chunk(stored_data, (long)entry->stored_size, password,
+                                          (long)chunk_start, output_data,
+                                          (long)entry->raw_size, &n);
+        if (result != SUCCESS) break;
+
+        /* Trim the first and last chunk to the requested range */
+        uint64_t from = (uint64_t)offset > chunk_start ? (uint64_t)offset - chunk_start : 0;
+        uint64_t to = end - chunk_start < (uint64_t)n ? end - chunk_start : (uint64_t)n;
+        size_t slice = (size_t)(to - from);
+        if (fwrite(output_data + from, 1, slice, fout) != slice) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+        written += (long)slice;
+    }
+
+    free(stored_data);
+    free(output_data);
+    free(index);
+    fclose(fin);
+    if (fclose(fout) != 0 && result == SUCCESS) {
+        result = ERROR_FILE_NOT_FOUND;
+    }
+    if (result != SUCCESS) {
+        remove(output_path);
+        return result;
+    }
+    printf("Decrypted bytes %ld-%ld of %s to %s (%ld bytes)\n",
+           offset, offset + written, encrypted_path, output_path, written);
+    return SUCCESS;
+}
+
+/*
+ * Check every chunk of a container against its Merkle leaf and report damage
+ * [Chu-Cheng Yu]
+ */
+int scrub_encrypted_file(const char *encrypted_path, long *damaged_chunks)
+{
+    if (damaged_chunks) *damaged_chunks = 0;
+
+    FILE *fin = fopen(encrypted_path, "rb");
+    if (!fin) {
+        printf("Error: could not open encrypted file '%s'\n", encrypted_path);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    container_header_t header;
+    chunk_index_entry_t *index = NULL;
+    int result = load_chunk_index(fin, &header, &index);
+    if (result != SUCCESS) {
+        if (result == ERROR_CHECKSUM_MISMATCH) {
+            printf("%s: chunk index does not match its Merkle root\n", encrypted_path);
+        } else {
+            printf("%s: no chunk index to scrub against\n", encrypted_path);
+        }
+        fclose(fin);
+        return result;
+    }
+
+    unsigned char *stored_data = malloc(header.chunk_size);
+    if (!stored_data) {
+        free(index);
+        fclose(fin);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    long damaged = 0;
+    for (uint64_t i = 0; i < header.chunk_count; ++i) {
+        if (index[i].stored_size > header.chunk_size ||
+            read_indexed_chunk(fin, &index[i], stored_data) != SUCCESS) {
+            uint64_t start = i * header.chunk_size;
+            printf("%s: chunk %llu damaged (plaintext bytes %llu-%llu)\n", encrypted_path,
+                   (unsigned long long)i, (unsigned long long)start,
+                   (unsigned long long)(start + index[i].raw_size));
+            damaged++;
+        }
+    }
+    free(stored_data);
+    free(index);
+    fclose(fin);
+
+    printf("%s: %llu chunks checked, %ld damaged\n", encrypted_path,
+           (unsigned long long)header.chunk_count, damaged);
+    if (damaged_chunks) *damaged_chunks = damaged;
+    return damaged ? ERROR_CHECKSUM_MISMATCH : SUCCESS;
+}
+
+/* ========================================================================
+ * INCREMENTAL UPDATES
+ * ======================================================================== */
+
+/*
+ * Bring an existing container up to date with its changed source,
+ * rewriting only the chunks whose contents differ
+ * [Chu-Cheng Yu]
+ */
+int update_container_chunks(const char *source_path, const char *encrypted_path,
+                            const char *password, long *chunks_rewritten,
+                            file_metadata_t *metadata)
+{
+    if (!source_path || !encrypted_path || !password || !metadata) return ERROR_INVALID_PATH;
+    if (chunks_rewritten) *chunks_rewritten = 0;
+
+    platform_file_id_t source_id;
+    if (platform_file_identity(source_path, &source_id) != SUCCESS) return ERROR_FILE_NOT_FOUND;
+
+    FILE *fenc = fopen(encrypted_path, "r+b");
+    if (!fenc) return ERROR_FILE_NOT_FOUND;
+    container_header_t header;
+    chunk_index_entry_t *index = NULL;
+    int result = load_chunk_index(fenc, &header, &index);
+
+    /* Chunks can only be patched where they are when none moves: no
+       compression and the same plaintext length */
+    if (result == SUCCESS && ((header.flags & CONTAINER_FLAG_COMPRESSED) ||
+                              header.original_size != source_id.size)) {
+        result = ERROR_CONTAINER_CORRUPT;
+    }
+    FILE *fin = NULL;
+    unsigned char *input_data = NULL;
+    unsigned char *output_data = NULL;
+    uint64_t *leaves = NULL;
+    if (result == SUCCESS) {
+        fin = fopen(source_path, "rb");
+        input_data = malloc(header.chunk_size);
+        output_data = malloc(header.chunk_size);
+        leaves = malloc(sizeof(uint64_t) * (size_t)header.chunk_count);
+        if (!fin) result = ERROR_FILE_NOT_FOUND;
+        else if (!input_data || !output_data || !leaves) result = ERROR_MEMORY_ALLOCATION;
+    }
+
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    checksum_init(&plain_state);
+    checksum_init(&cipher_state);
+    long rewritten = 0;
+    for (uint64_t i = 0; result == SUCCESS && i < header.chunk_count; ++i) {
+        chunk_index_entry_t *entry = &index[i];
+        if (entry->raw_size != entry->stored_size || entry->raw_size > header.chunk_size ||
+            fread(input_data, 1, entry->raw_size, fin) != entry->raw_size) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+
+        /* Encryption is deterministic, so an unchanged chunk reproduces
+           its recorded hash and needs no write */
+        result = encrypt_data_at(input_data, (long)entry->raw_size, password,
+                                 (long)(i * header.chunk_size), output_data);
+        if (result != SUCCESS) break;
+        uint64_t hash = checksum_buffer(output_data, entry->raw_size);
+        checksum_update(&plain_state, input_data, entry->raw_size);
+        checksum_update(&cipher_state, output_data, entry->raw_size);
+        leaves[i] = hash;
+        if (hash == entry->hash) continue;
+
+        if (platform_seek(fenc, entry->offset + sizeof(chunk_header_t)) != SUCCESS ||
+            fwrite(output_data, 1, entry->raw_size, fenc) != entry->raw_size) {
+            result = ERROR_ENCRYPTION_FAILED;
+            break;
+        }
+        entry->hash = hash;
+        rewritten++;
+    }
+
+    /* Index, root and checksums describe the new contents */
+    if (result == SUCCESS && rewritten > 0) {
+        result = merkle_root(leaves, header.chunk_count, &header.merkle_root);
+        header.plaintext_checksum = checksum_final(&plain_state);
+        header.ciphertext_checksum = checksum_final(&cipher_state);
+        size_t count = (size_t)header.chunk_count;
+        if (result == SUCCESS &&
+            (platform_seek(fenc, header.index_offset) != SUCCESS ||
+             fwrite(index, sizeof(chunk_index_entry_t), count, fenc) != count ||
+             platform_seek(fenc, 0) != SUCCESS ||
+             fwrite(&header, sizeof(header), 1, fenc) != 1)) {
+            result = ERROR_ENCRYPTION_FAILED;
+        }
+    }
+
+    if (fin) fclose(fin);
+    free(input_data);
+    free(output_data);
+    free(leaves);
+    free(index);
+    if (fclose(fenc) != 0 && result == SUCCESS) result = ERROR_ENCRYPTION_FAILED;
+    if (result != SUCCESS) return result;
+
+    format_checksum(header.plaintext_checksum, metadata->checksum, sizeof(metadata->checksum));
+    metadata->source_mtime_ns = source_id.mtime_ns;
+    if (chunks_rewritten) *chunks_rewritten = rewritten;
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * IN-PLACE FILE ENCRYPTION
+ * ======================================================================== */
+
+/*
+ * Read the in-place trailer from the end of an open file
+ * [Agam Grewal]
+ */
+int read_in_place_trailer(FILE *fp, container_header_t *trailer)
+{
+    if (fseek(fp, -(long)sizeof(*trailer), SEEK_END) != 0) return ERROR_FILE_NOT_FOUND;
+    if (fread(trailer, sizeof(*trailer), 1, fp) != 1) return ERROR_FILE_NOT_FOUND;
+    if (memcmp(trailer->signature, CONTAINER_SIGNATURE, sizeof(trailer->signature)) != 0 ||
+        !(trailer->flags & CONTAINER_FLAG_IN_PLACE)) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Check whether a file was encrypted in place
+ * [Agam Grewal]
+ */
+int is_in_place_encrypted(const char *file_path)
+{
+    if (!file_path) return 0;
+    FILE *fp = fopen(file_path, "rb");
+    if (!fp) return 0;
+    container_header_t trailer;
+    int found = read_in_place_trailer(fp, &trailer) == SUCCESS;
+    fclose(fp);
+    return found;
+}
+
+/*
+ * Password check kept in in-place trailers and journals; derived from the
+ * key fingerprint, so it reveals no more than the library already does
+ */
+static uint64_t in_place_key_check(const char *password)
+{
+    char fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+    compute_key_fingerprint(password, fingerprint, sizeof(fingerprint));
+    return checksum_buffer((const unsigned char *)fingerprint, strlen(fingerprint));
+}
+
+/*
+ * Make sure a password decrypts an in-place file before any of it changes
+ * file_path File encrypted in place
+ * trailer Trailer read from its end
+ * password Password about to be used
+ * SUCCESS if it is the right password, ERROR_INVALID_PASSWORD if not, or
+ * another error code if the file cannot be read
+ */
+static int check_in_place_password(const char *file_path, const container_header_t *trailer,
+                                   const char *password)
+{
+    if (trailer->flags & CONTAINER_FLAG_KEY_CHECK) {
+        return trailer->merkle_root == in_place_key_check(password)
+               ? SUCCESS : ERROR_INVALID_PASSWORD;
+    }
+
+    /* Older trailers have no key check: decrypt a copy in memory and
+       compare it with the plaintext checksum */
+    FILE *fp = fopen(file_path, "rb");
+    if (!fp) return ERROR_FILE_NOT_FOUND;
+    unsigned char *buffer = malloc(CHUNK_SIZE);
+    if (!buffer) {
+        fclose(fp);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    checksum_state_t state;
+    checksum_init(&state);
+    int result = SUCCESS;
+    long total = (long)trailer->original_size;
+    for (long offset = 0; offset < total; ) {
+        size_t n = (size_t)(total - offset < CHUNK_SIZE ? total - offset : CHUNK_SIZE);
+        if (fread(buffer, 1, n, fp) != n) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        decrypt_data_at(buffer, (long)n, password, offset, buffer);
+        checksum_update(&state, buffer, n);
+        offset += (long)n;
+    }
+    secure_memory_clear(buffer, CHUNK_SIZE);
+    free(buffer);
+    fclose(fp);
+    if (result == SUCCESS && checksum_final(&state) != trailer->plaintext_checksum) {
+        result = ERROR_INVALID_PASSWORD;
+    }
+    return result;
+}
+
+/*
+ * Undo a chunk left half-written by an interrupted in-place job
+ * file_path File being rewritten
+ * journal_path Journal next to it
+ * direction JOURNAL_DIRECTION_* the caller is about to run
+ * key_check in_place_key_check of the password the caller is about to use
+ * resume_offset Out parameter to receive the offset to resume from
+ * total_size Out parameter to receive the number of bytes to process
+ * expected_checksum Out parameter to receive the recorded plaintext checksum
+ * SUCCESS if a journal was replayed, ERROR_FILE_NOT_FOUND if there is none,
+ * ERROR_INVALID_PASSWORD if the job was started with another password, or
+ * another error code if it cannot be used
+ */
+static int recover_in_place_journal(const char *file_path, const char *journal_path,
+                                    uint32_t direction, uint64_t key_check,
+                                    long *resume_offset, long *total_size,
+                                    uint64_t *expected_checksum)
+{
+    FILE *jf = fopen(journal_path, "rb");
+    if (!jf) return ERROR_FILE_NOT_FOUND;
+
+    inplace_journal_t record;
+    if (fread(&record, sizeof(record), 1, jf) != 1 ||
+        memcmp(record.signature, JOURNAL_SIGNATURE, sizeof(record.signature)) != 0 ||
+        record.length > CHUNK_SIZE || record.offset > record.total_size) {
+        fclose(jf);
+        return ERROR_CONTAINER_CORRUPT;
+    }
+    if (record.direction != direction) {
+        printf("Error: an interrupted %s of this file must be finished first.\n",
+               record.direction == JOURNAL_DIRECTION_ENCRYPT ? "encryption" : "decryption");
+        fclose(jf);
+        return ERROR_CONTAINER_CORRUPT;
+    }
+    if (record.key_check != key_check) {
+        printf("Error: the interrupted job was started with a different password.\n");
+        fclose(jf);
+        return ERROR_INVALID_PASSWORD;
+    }
+
+    long resume = (long)record.offset;
+    if (record.length > 0) {
+        unsigned char *saved = malloc(record.length);
+        if (!saved) {
+            fclose(jf);
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        size_t n = fread(saved, 1, record.length, jf);
+        if (n == record.length && checksum_buffer(saved, n) == record.saved_hash) {
+            /* Chunk may be partly rewritten: put the original bytes back */
+            FILE *fp = fopen(file_path, "r+b");
+            int ok = fp && fseek(fp, resume, SEEK_SET) == 0 &&
+                     fwrite(saved, 1, n, fp) == n && platform_flush_to_disk(fp) == SUCCESS;
+            if (fp) fclose(fp);
+            if (!ok) {
+                free(saved);
+                fclose(jf);
+                return ERROR_PERMISSION_DENIED;
+            }
+        } else {
+            /* Saved area was being refilled, so the recorded chunk completed */
+            resume += (long)record.length;
+        }
+        free(saved);
+    }
+    fclose(jf);
+
+    *resume_offset = resume;
+    *total_size = (long)record.total_size;
+    *expected_checksum = record.expected_checksum;
+    return SUCCESS;
+}
+
+/*
+ * Write a journal record, with the saved chunk when data is non-NULL
+ */
+static int write_in_place_journal(FILE *jf, uint32_t direction, long offset, long total,
+                                  uint64_t expected_checksum, uint64_t key_check,
+                                  const unsigned char *data, size_t length)
+{
+    inplace_journal_t record;
+    memset(&record, 0, sizeof(record));
+    memcpy(record.signature, JOURNAL_SIGNATURE, sizeof(record.signature));
+    record.direction = direction;
+    record.offset = (uint64_t)offset;
+    record.total_size = (uint64_t)total;
+    record.expected_checksum = expected_checksum;
+    record.key_check = key_check;
+    if (data) {
+        /* Saved bytes first, on disk before the record that makes them
+           valid: a record must never name a chunk whose bytes are not saved */
+        if (fseek(jf, (long)sizeof(record), SEEK_SET) != 0 ||
+            fwrite(data, 1, length, jf) != length || platform_flush_to_disk(jf) != SUCCESS) {
+            return ERROR_PERMISSION_DENIED;
+        }
+        record.length = (uint32_t)length;
+        record.saved_hash = checksum_buffer(data, length);
+    }
+    if (fseek(jf, 0, SEEK_SET) != 0 || fwrite(&record, sizeof(record), 1, jf) != 1) {
+        return ERROR_PERMISSION_DENIED;
+    }
+    return platform_flush_to_disk(jf);
+}
+
+/*
+ * XOR a file with the keystream in place, one journaled chunk at a time
+ * file_path File to rewrite
+ * journal_path Journal to keep next to it
+ * password Password for the keystream
+ * direction JOURNAL_DIRECTION_* recorded in the journal
+ * start Offset to begin at (non-zero when resuming)
+ * total Number of bytes to process from offset 0
+ * expected_checksum Value recorded in the journal (see inplace_journal_t)
+ * key_check Password check recorded in the journal
+ * plain_state Checksum state fed with the plaintext of the whole file
+ * cipher_state Optional checksum state fed with the ciphertext (encrypting only)
+ * SUCCESS on success, or an error code (the journal is kept for resuming)
+ */
+static int xor_file_in_place(const char *file_path, const char *journal_path,
+                             const char *password, uint32_t direction, long start, long total,
+                             uint64_t expected_checksum, uint64_t key_check,
+                             checksum_state_t *plain_state, checksum_state_t *cipher_state)
+{
+    FILE *fp = fopen(file_path, "r+b");
+    if (!fp) return ERROR_FILE_NOT_FOUND;
+
+    FILE *jf = fopen(journal_path, "r+b");
+    if (!jf) jf = fopen(journal_path, "w+b");
+    unsigned char *buffer = malloc(CHUNK_SIZE);
+    if (!jf || !buffer) {
+        if (jf) fclose(jf);
+        free(buffer);
+        fclose(fp);
+        return jf ? ERROR_MEMORY_ALLOCATION : ERROR_PERMISSION_DENIED;
+    }
+
+    int result = SUCCESS;
+
+    /* A resumed run only rereads the finished part to bring the checksum
+       up to date; chunks already converted are encrypted when encrypting
+       and plain when decrypting */
+    for (long offset = 0; offset < start; ) {
+        size_t n = (size_t)(start - offset < CHUNK_SIZE ? start - offset : CHUNK_SIZE);
+        if (fseek(fp, offset, SEEK_SET) != 0 || fread(buffer, 1, n, fp) != n) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+        if (direction == JOURNAL_DIRECTION_ENCRYPT) {
+            checksum_update(cipher_state, buffer, n);
+            decrypt_data_at(buffer, (long)n, password, offset, buffer);
+        }
+        checksum_update(plain_state, buffer, n);
+        offset += (long)n;
+    }
+
+    for (long offset = start; offset < total && result == SUCCESS; ) {
+        size_t n = (size_t)(total - offset < CHUNK_SIZE ? total - offset : CHUNK_SIZE);
+        if (fseek(fp, offset, SEEK_SET) != 0 || fread(buffer, 1, n, fp) != n) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+
+        /* Original bytes must be durable before the chunk is overwritten */
+        result = write_in_place_journal(jf, direction, offset, total, expected_checksum,
+                                        key_check, buffer, n);
+        if (result != SUCCESS) break;
+
+        if (direction == JOURNAL_DIRECTION_ENCRYPT) checksum_update(plain_state, buffer, n);
+        encrypt_data_at(buffer, (long)n, password, offset, buffer);
+        if (direction == JOURNAL_DIRECTION_ENCRYPT) checksum_update(cipher_state, buffer, n);
+        if (direction == JOURNAL_DIRECTION_DECRYPT) checksum_update(plain_state, buffer, n);
+        if (fseek(fp, offset, SEEK_SET) != 0 || fwrite(buffer, 1, n, fp) != n ||
+            platform_flush_to_disk(fp) != SUCCESS) {
+            result = ERROR_PERMISSION_DENIED;
+            break;
+        }
+        offset += (long)n;
+    }
+
+    secure_memory_clear(buffer, CHUNK_SIZE);
+    free(buffer);
+    fclose(jf);
+    if (fclose(fp) != 0 && result == SUCCESS) result = ERROR_PERMISSION_DENIED;
+    return result;
+}
+
+/*
+ * Encrypt a file in place without writing a second copy
+ * [Agam Grewal]
+ */
+int encrypt_file_in_place(const char *input_path, const char *output_path,
+                          const char *password, encryption_method_t method,
+                          file_metadata_t *metadata)
+{
+    if (!input_path || !output_path || !password || !metadata) return ERROR_INVALID_PATH;
+    if (strlen(password) == 0) return ERROR_INVALID_PASSWORD;
+
+    char journal_path[MAX_PATH_LENGTH + sizeof(JOURNAL_SUFFIX)];
+    snprintf(journal_path, sizeof(journal_path), "%s%s", input_path, JOURNAL_SUFFIX);
+
+    long start = 0;
+    long total = 0;
+    uint64_t unused_checksum = 0;
+    uint64_t key_check = in_place_key_check(password);
+    int result = recover_in_place_journal(input_path, journal_path,
+                                          JOURNAL_DIRECTION_ENCRYPT, key_check,
+                                          &start, &total, &unused_checksum);
+    if (result == SUCCESS) {
+        printf("Resuming interrupted in-place encryption at byte %ld\n", start);
+    } else if (result == ERROR_FILE_NOT_FOUND) {
+        if (is_in_place_encrypted(input_path)) {
+            printf("Error: file is already encrypted in place.\n");
+            return ERROR_ENCRYPTION_FAILED;
+        }
+        FILE *fp = fopen(input_path, "rb");
+        if (!fp) return ERROR_FILE_NOT_FOUND;
+        fseek(fp, 0, SEEK_END);
+        total = ftell(fp);
+        fclose(fp);
+        if (total <= 0) return ERROR_FILE_NOT_FOUND;
+    } else {
+        return result;
+    }
+
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    checksum_init(&plain_state);
+    checksum_init(&cipher_state);
+    result = xor_file_in_place(input_path, journal_path, password,
+                               JOURNAL_DIRECTION_ENCRYPT, start, total, 0, key_check,
+                               &plain_state, &cipher_state);
+    if (result != SUCCESS) {
+        printf("Error: in-place encryption stopped; run it again to resume.\n");
+        return result;
+    }
+
+    /* Trailer marks the file as encrypted; it may already be there if the
+       previous run stopped after appending it */
+    FILE *fp = fopen(input_path, "r+b");
+    if (!fp) return ERROR_FILE_NOT_FOUND;
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == total) {
+        container_header_t trailer;
+        memset(&trailer, 0, sizeof(trailer));
+        memcpy(trailer.signature, CONTAINER_SIGNATURE, sizeof(trailer.signature));
+        trailer.version = CONTAINER_VERSION;
+        trailer.flags = CONTAINER_FLAG_IN_PLACE | CONTAINER_FLAG_CIPHER_CHECKSUM |
+                        CONTAINER_FLAG_KEY_CHECK;
+        trailer.chunk_size = CHUNK_SIZE;
+        trailer.original_size = (uint64_t)total;
+        trailer.payload_size = (uint64_t)total;
+        trailer.plaintext_checksum = checksum_final(&plain_state);
+        trailer.ciphertext_checksum = checksum_final(&cipher_state);
+        trailer.merkle_root = key_check;
+        if (fwrite(&trailer, sizeof(trailer), 1, fp) != 1) result = ERROR_PERMISSION_DENIED;
+    }
+    if (platform_flush_to_disk(fp) != SUCCESS) result = ERROR_PERMISSION_DENIED;
+    fclose(fp);
+    if (result != SUCCESS) return result;
+    remove(journal_path);
+
+    if (strcmp(input_path, output_path) != 0 && rename(input_path, output_path) != 0) {
+        return ERROR_RENAME_FAILED;
+    }
+
+    /* Populate metadata */
+    memset(metadata, 0, sizeof(file_metadata_t));
+    safe_string_copy(metadata->original_filename, input_path, sizeof(metadata->original_filename));
+    safe_string_copy(metadata->encrypted_filename, output_path, sizeof(metadata->encrypted_filename));
+    metadata->is_compressed = 0;
+    metadata->original_size = total;
+    metadata->encrypted_size = total + (long)sizeof(container_header_t);
+    metadata->encryption_method = (int)method;
+    format_checksum(checksum_final(&plain_state), metadata->checksum, sizeof(metadata->checksum));
+
+    printf("Encrypted in place: %s → %s (%ld bytes)\n", input_path, output_path, total);
+    return SUCCESS;
+}
+
+/*
+ * Decrypt a file produced by encrypt_file_in_place without a second copy
+ * [Agam Grewal]
+ */
+int decrypt_file_in_place(const char *encrypted_path, const char *output_path,
+                          const char *password)
+{
+    if (!encrypted_path || !output_path || !password) return ERROR_INVALID_PATH;
+    if (strlen(password) == 0) return ERROR_INVALID_PASSWORD;
+
+    char journal_path[MAX_PATH_LENGTH + sizeof(JOURNAL_SUFFIX)];
+    snprintf(journal_path, sizeof(journal_path), "%s%s", encrypted_path, JOURNAL_SUFFIX);
+
+    long start = 0;
+    long total = 0;
+    uint64_t expected_checksum = 0;
+    uint64_t key_check = in_place_key_check(password);
+    int result = recover_in_place_journal(encrypted_path, journal_path,
+                                          JOURNAL_DIRECTION_DECRYPT, key_check,
+                                          &start, &total, &expected_checksum);
+    if (result == SUCCESS) {
+        printf("Resuming interrupted in-place decryption at byte %ld\n", start);
+    } else if (result == ERROR_FILE_NOT_FOUND) {
+        FILE *fp = fopen(encrypted_path, "rb");
+        if (!fp) return ERROR_FILE_NOT_FOUND;
+        container_header_t trailer;
+        result = read_in_place_trailer(fp, &trailer);
+        fclose(fp);
+        if (result != SUCCESS) {
+            printf("Error: file was not encrypted in place.\n");
+            return ERROR_CONTAINER_CORRUPT;
+        }
+        total = (long)trailer.original_size;
+        expected_checksum = trailer.plaintext_checksum;
+
+        /* This is the only copy: a wrong password must not touch it */
+        result = check_in_place_password(encrypted_path, &trailer, password);
+        if (result == ERROR_INVALID_PASSWORD) {
+            printf("Error: wrong password; the file was not changed.\n");
+        }
+        if (result != SUCCESS) return result;
+
+        /* Journal must exist before the trailer goes, or a crash would
+           leave nothing identifying the file as encrypted */
+        FILE *jf = fopen(journal_path, "w+b");
+        if (!jf) return ERROR_PERMISSION_DENIED;
+        result = write_in_place_journal(jf, JOURNAL_DIRECTION_DECRYPT, 0, total,
+                                        expected_checksum, key_check, NULL, 0);
+        fclose(jf);
+        if (result != SUCCESS) return result;
+    } else {
+        return result;
+    }
+
+    /* Drop the trailer (idempotent when resuming) */
+    checksum_state_t plain_state;
+    checksum_init(&plain_state);
+    result = platform_truncate_file(encrypted_path, total);
+    if (result == SUCCESS) {
+        result = xor_file_in_place(encrypted_path, journal_path, password,
+                                   JOURNAL_DIRECTION_DECRYPT, start, total,
+                                   expected_checksum, key_check, &plain_state, NULL);
+    }
+    if (result != SUCCESS) {
+        printf("Error: in-place decryption stopped; run it again to resume.\n");
+        return result;
+    }
+    remove(journal_path);
+
+    /* The password was checked first, so a mismatch means damaged data;
+       it keeps its old name so it is not taken for a good decryption */
+    if (checksum_final(&plain_state) != expected_checksum) {
+        printf("Warning: decrypted data does not match its checksum; "
+               "it was left in %s.\n", encrypted_path);
+        return ERROR_CHECKSUM_MISMATCH;
+    }
+
+    if (strcmp(encrypted_path, output_path) != 0 && rename(encrypted_path, output_path) != 0) {
+        return ERROR_RENAME_FAILED;
+    }
+
+    printf("File decrypted in place.\n");
+    printf("Output: %s (%ld bytes)\n", output_path, total);
+    return SUCCESS;
+}
+
 /* ========================================================================
  * ENCRYPTION/COMPRESSION ALGORITHMS
  * ======================================================================== */
@@ -437,77 +1706,262 @@ int compress_data(const unsigned char *input_data, long input_size,
 }
 
 /*
- * Apply encryption cipher to file data
+ * Compress and encrypt one chunk in a single pass
+ * [Gordon Huang, Agam Grewal]
+ */
+int compress_encrypt_chunk(const unsigned char *input_data, long input_size,
+                           const char *password, long stream_offset,
+                           unsigned char *output_data, long *output_size)
+{
+    if (!input_data || input_size <= 0 || !password || stream_offset < 0 ||
+        !output_data || !output_size) {
+        return ERROR_INVALID_PATH;
+    }
+
+    size_t pwlen = strlen(password);
+    if (pwlen == 0) return ERROR_INVALID_PASSWORD;
+    const unsigned char *key = (const unsigned char *)password;
+    size_t k = (size_t)(stream_offset % (long)pwlen);
+
+    /* RLE pairs are XORed as they are emitted; no intermediate buffer */
+    long out_index = 0;
+    long i = 0;
+    while (i < input_size) {
+        unsigned char current = input_data[i];
+        long count = 1;
+        while (i + count < input_size && input_data[i + count] == current && count < 255) {
+            count++;
+        }
+
+        /* Output can no longer end up smaller than the input: store it plain */
+        if (out_index + 2 >= input_size) {
+            *output_size = input_size;
+            return encrypt_data_at(input_data, input_size, password, stream_offset, output_data);
+        }
+
+        output_data[out_index++] = (unsigned char)count ^ key[k];
+        if (++k == pwlen) k = 0;
+        output_data[out_index++] = current ^ key[k];
+        if (++k == pwlen) k = 0;
+        i += count;
+    }
+
+    *output_size = out_index;
+    return SUCCESS;
+}
+
+/*
+ * Decrypt and decompress one chunk in a single pass
+ * [Gordon Huang, Agam Grewal]
+ */
+int decrypt_decompress_chunk(const unsigned char *stored_data, long stored_size,
+                             const char *password, long stream_offset,
+                             unsigned char *output_data, long raw_size, long *output_size)
+{
+    if (!stored_data || stored_size <= 0 || !password || stream_offset < 0 ||
+        !output_data || raw_size <= 0 || !output_size) {
+        return ERROR_INVALID_PATH;
+    }
+
+    /* Stored plain (compression was ineffective or disabled) */
+    if (stored_size == raw_size) {
+        *output_size = raw_size;
+        return decrypt_data_at(stored_data, stored_size, password, stream_offset, output_data);
+    }
+    if (stored_size > raw_size || stored_size % 2 != 0) return ERROR_COMPRESSION_FAILED;
+
+    size_t pwlen = strlen(password);
+    if (pwlen == 0) return ERROR_INVALID_PASSWORD;
+    const unsigned char *key = (const unsigned char *)password;
+    size_t k = (size_t)(stream_offset % (long)pwlen);
+
+    long out_index = 0;
+    long i = 0;
+
+    /* Same block-wise bounds checking as decompress_data */
+    const long block_bytes = DECOMPRESS_BLOCK_PAIRS * 2;
+    const long block_max_out = DECOMPRESS_BLOCK_PAIRS * 255;
+    while (stored_size - i >= block_bytes && raw_size - out_index >= block_max_out) {
+        for (int b = 0; b < DECOMPRESS_BLOCK_PAIRS; ++b, i += 2) {
+            unsigned char count = stored_data[i] ^ key[k];
+            if (++k == pwlen) k = 0;
+            unsigned char value = stored_data[i + 1] ^ key[k];
+            if (++k == pwlen) k = 0;
+            memset(output_data + out_index, value, count);
+            out_index += count;
+        }
+    }
+
+    for (; i < stored_size; i += 2) {
+        unsigned char count = stored_data[i] ^ key[k];
+        if (++k == pwlen) k = 0;
+        unsigned char value = stored_data[i + 1] ^ key[k];
+        if (++k == pwlen) k = 0;
+        if (count > raw_size - out_index) return ERROR_COMPRESSION_FAILED;
+        memset(output_data + out_index, value, count);
+        out_index += count;
+    }
+
+    if (out_index != raw_size) return ERROR_COMPRESSION_FAILED;
+    *output_size = out_index;
+    return SUCCESS;
+}
+
+/*
+ * Apply encryption cipher to data starting at an absolute keystream offset
  * [Agam Grewal]
  */
-int encrypt_data(const unsigned char *input_data, long data_size,
-                 const char *password, unsigned char *output_data)
+int encrypt_data_at(const unsigned char *input_data, long data_size,
+                    const char *password, long stream_offset,
+                    unsigned char *output_data)
 {
-    if (!input_data || !output_data || !password) return ERROR_INVALID_PATH;
+    if (!input_data || !output_data || !password || stream_offset < 0) return ERROR_INVALID_PATH;
 
     size_t pwlen = strlen(password);
     if (pwlen == 0) return ERROR_INVALID_PASSWORD;
+    const unsigned char *key = (const unsigned char *)password;
+    size_t phase = (size_t)(stream_offset % (long)pwlen);
+    long i = 0;
+
+    /* Unroll the key into a block that is a whole number of key periods so
+       the inner loop is a plain element-wise XOR the compiler can vectorise */
+    if (pwlen <= KEYSTREAM_BLOCK_SIZE / 2) {
+        unsigned char block[KEYSTREAM_BLOCK_SIZE];
+        size_t block_len = (KEYSTREAM_BLOCK_SIZE / pwlen) * pwlen;
+        for (size_t j = 0; j < block_len; ++j) {
+            block[j] = key[(phase + j) % pwlen];
+        }
+        for (; data_size - i >= (long)block_len; i += (long)block_len) {
+            const unsigned char *in = input_data + i;
+            unsigned char *out = output_data + i;
+            for (size_t j = 0; j < block_len; ++j) {
+                out[j] = in[j] ^ block[j];
+            }
+        }
+    }
 
-    /* XOR */
-    for (long i = 0; i < data_size; ++i) {
-        output_data[i] = input_data[i] ^ password[i % pwlen];
+    /* Tail (and very long passwords): one byte at a time */
+    size_t k = (size_t)(((long)phase + i) % (long)pwlen);
+    for (; i < data_size; ++i) {
+        output_data[i] = input_data[i] ^ key[k];
+        if (++k == pwlen) k = 0;
     }
 
     return SUCCESS;
 }
 
 /*
- * Decrypt a buffer of data using the supplied password (stub)
+ * Decrypt data starting at an absolute keystream offset
+ * [Agam Grewal]
+ */
+int decrypt_data_at(const unsigned char *encrypted_data, long data_size,
+                    const char *password, long stream_offset,
+                    unsigned char *output_data)
+{
+    /* XOR is its own inverse */
+    return encrypt_data_at(encrypted_data, data_size, password, stream_offset, output_data);
+}
+
+/*
+ * Apply encryption cipher to file data
+ * [Agam Grewal]
+ */
+int encrypt_data(const unsigned char *input_data, long data_size,
+                 const char *password, unsigned char *output_data)
+{
+    return encrypt_data_at(input_data, data_size, password, 0, output_data);
+}
+
+/*
+ * Decrypt a buffer of data using the supplied password
  * encrypted_data Pointer to input encrypted bytes
  * data_size Size of input buffer in bytes
  * password Password used to derive the decryption key
- * output_data Output buffer to receive decrypted bytes (must be allocated)
+ * output_data Output buffer to receive decrypted bytes; may equal encrypted_data
  * SUCCESS on success, error code on invalid input
- * [Empty]
+ * [Agam Grewal]
  */
 int decrypt_data(const unsigned char *encrypted_data, long data_size,
                  const char *password, unsigned char *output_data)
 {
-    if (!encrypted_data || !output_data || !password) return ERROR_INVALID_PATH;
-
-    size_t pwlen = strlen(password);
-    if (pwlen == 0) return ERROR_INVALID_PASSWORD;
+    return decrypt_data_at(encrypted_data, data_size, password, 0, output_data);
+}
 
-    for (long i = 0; i < data_size; ++i) {
-        output_data[i] = encrypted_data[i] ^ password[i % pwlen];
+/*
+ * Compute the decompressed size of a compress_data stream without decoding it
+ * compressed_data Pointer to compressed input bytes
+ * compressed_size Size of compressed input in bytes
+ * decompressed_size Out parameter to receive the total run length
+ * SUCCESS on success, ERROR_COMPRESSION_FAILED on a malformed stream
+ * [Gordon Huang]
+ */
+int get_decompressed_size(const unsigned char *compressed_data, long compressed_size,
+                          long *decompressed_size)
+{
+    if (!compressed_data || compressed_size <= 0 || !decompressed_size) {
+        return ERROR_INVALID_PATH;
     }
+    /* Stream is a sequence of (count, value) pairs */
+    if (compressed_size % 2 != 0) return ERROR_COMPRESSION_FAILED;
 
+    long total = 0;
+    for (long i = 0; i < compressed_size; i += 2) {
+        total += compressed_data[i];
+    }
+    *decompressed_size = total;
     return SUCCESS;
 }
 
 /*
- * Decompress a buffer produced by compress_data (stub)
+ * Decompress a buffer produced by compress_data into a bounded output buffer
  * compressed_data Pointer to compressed input bytes
  * compressed_size Size of compressed input in bytes
  * output_data Output buffer to receive decompressed bytes (must be allocated)
+ * output_capacity Size of output_data in bytes
  * output_size Out parameter to receive number of decompressed bytes
- * SUCCESS on success, error code on invalid input
+ * SUCCESS on success, ERROR_COMPRESSION_FAILED if the stream is malformed or
+ * would overflow output_data
  * [Gordon Huang]
  */
 int decompress_data(const unsigned char *compressed_data, long compressed_size,
-                    unsigned char *output_data, long *output_size)
+                    unsigned char *output_data, long output_capacity, long *output_size)
 {
     
     #ifdef DEBUG
     DEBUG_PRINT("decompress_data() compressed_size=%ld", compressed_size);
 #endif
 
-    if (!compressed_data || compressed_size <= 0 || !output_data || !output_size) {
+    if (!compressed_data || compressed_size <= 0 || !output_data ||
+        output_capacity < 0 || !output_size) {
         return ERROR_INVALID_PATH;
     }
+    if (compressed_size % 2 != 0) return ERROR_COMPRESSION_FAILED;
     
     long out_index = 0;
-    for (long i = 0; i < compressed_size; i += 2) {
+    long i = 0;
+
+    /* Fast path: a block of pairs can expand to at most
+       DECOMPRESS_BLOCK_PAIRS * 255 bytes, so check capacity once per block */
+    const long block_bytes = DECOMPRESS_BLOCK_PAIRS * 2;
+    const long block_max_out = DECOMPRESS_BLOCK_PAIRS * 255;
+    while (compressed_size - i >= block_bytes &&
+           output_capacity - out_index >= block_max_out) {
+        const unsigned char *p = compressed_data + i;
+        for (int k = 0; k < DECOMPRESS_BLOCK_PAIRS; ++k, p += 2) {
+            memset(output_data + out_index, p[1], p[0]);
+            out_index += p[0];
+        }
+        i += block_bytes;
+    }
+
+    /* Tail: check capacity per pair */
+    for (; i < compressed_size; i += 2) {
         unsigned char count = compressed_data[i];
-        unsigned char value = compressed_data[i + 1];
-        for (unsigned char j = 0; j < count; j++) {
-            output_data[out_index++] = value;
+        if (count > output_capacity - out_index) {
+            return ERROR_COMPRESSION_FAILED;
         }
+        memset(output_data + out_index, compressed_data[i + 1], count);
+        out_index += count;
     }
 
     *output_size = out_index;
@@ -518,5 +1972,4 @@ int decompress_data(const unsigned char *compressed_data, long compressed_size,
 
 
     return SUCCESS;
-}
-
+}
\ No newline at end of file
@@ -65,6 +65,114 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
                  const char *password, encryption_method_t method, 
                  const file_metadata_t *metadata);
 
+/*
+ * Encrypt a file in place, chunk by chunk, without writing a second copy.
+ * Each chunk's original bytes are journaled to <input_path>.ccjournal first,
+ * so an interrupted run resumes where it stopped when called again with the
+ * same password. The file is renamed to output_path when done.
+ * input_path Path to the file to encrypt
+ * output_path Name the encrypted file is given afterwards
+ * password Encryption password
+ * method Encryption method to use
+ * metadata Pointer to metadata structure to populate
+ * SUCCESS on success, error code on failure
+ */
+int encrypt_file_in_place(const char *input_path, const char *output_path,
+                          const char *password, encryption_method_t method,
+                          file_metadata_t *metadata);
+
+/*
+ * Decrypt a file produced by encrypt_file_in_place without a second copy
+ * encrypted_path Path to the encrypted file
+ * output_path Name the decrypted file is given afterwards
+ * password Password used for decryption
+ * SUCCESS on success, ERROR_CHECKSUM_MISMATCH if the decrypted data is
+ * damaged (it is left under encrypted_path), or another error code
+ */
+int decrypt_file_in_place(const char *encrypted_path, const char *output_path,
+                          const char *password);
+
+/*
+ * Derive the key fingerprint stored with library entries, used to tell
+ * whether two entries were encrypted with the same password. It is a
+ * stretched one-way hash of the password, not the password itself.
+ * password Password to fingerprint
+ * fingerprint Buffer to receive KEY_FINGERPRINT_LENGTH hex digits
+ * buffer_size Size of the fingerprint buffer (more than KEY_FINGERPRINT_LENGTH)
+ * SUCCESS on success, ERROR_INVALID_PATH on bad arguments
+ */
+int compute_key_fingerprint(const char *password, char *fingerprint, size_t buffer_size);
+
+/*
+ * Decrypt a byte range of a container file. Only the chunks overlapping the
+ * range are read; each is checked against its Merkle leaf, and the chunk
+ * index against the root in the header, before it is decrypted.
+ * encrypted_path Path to the encrypted container
+ * output_path Path where the decrypted bytes should be written
+ * password Password used for decryption
+ * offset First plaintext byte to decrypt
+ * length Number of bytes to decrypt (clipped to the end of the file)
+ * SUCCESS on success, ERROR_CHECKSUM_MISMATCH if a touched chunk is damaged,
+ * or another error code on failure (output is removed)
+ */
+int decrypt_file_range(const char *encrypted_path, const char *output_path,
+                       const char *password, long offset, long length);
+
+/*
+ * Check every chunk of a container against the Merkle tree in its index
+ * and print the chunks that are damaged. No password is needed.
+ * encrypted_path Path to the encrypted container
+ * damaged_chunks Optional out parameter to receive the number of damaged chunks
+ * SUCCESS if every chunk is intact, ERROR_CHECKSUM_MISMATCH if any is damaged,
+ * or another error code if the file cannot be scrubbed
+ */
+int scrub_encrypted_file(const char *encrypted_path, long *damaged_chunks);
+
+/*
+ * Bring a container up to date with its changed source by re-encrypting
+ * only the chunks that differ. Works for uncompressed containers whose
+ * source still has the same length; anything else needs a full re-encrypt.
+ * source_path Path to the changed source file
+ * encrypted_path Path to the container encrypted from an earlier version
+ * password Password the container was encrypted with
+ * chunks_rewritten Optional out parameter to receive the chunks written
+ * metadata Library entry to update (checksum and source time)
+ * SUCCESS on success, ERROR_CONTAINER_CORRUPT if the container cannot be
+ * patched in place, or another error code on failure
+ */
+int update_container_chunks(const char *source_path, const char *encrypted_path,
+                            const char *password, long *chunks_rewritten,
+                            file_metadata_t *metadata);
+
+/*
+ * Complete a container whose chunks have all been written: append the
+ * chunk index, compute the Merkle root and rewrite the header in place
+ * fout Container open for writing, positioned just after the last chunk
+ * header Header of the container with both checksums already set
+ * index Chunk index entries, in chunk order
+ * leaves Hash of each chunk's stored bytes (the Merkle leaves)
+ * chunk_count Number of chunks written
+ * payload_size Sum of the stored chunk sizes
+ * SUCCESS on success, or an error code on failure
+ */
+int finish_container(FILE *fout, container_header_t *header, const chunk_index_entry_t *index,
+                     const uint64_t *leaves, uint64_t chunk_count, uint64_t payload_size);
+
+/*
+ * Read the in-place trailer from the end of an open file
+ * fp Open stream (position is not preserved)
+ * trailer Out parameter to receive the trailer
+ * SUCCESS if the file ends with an in-place trailer, ERROR_FILE_NOT_FOUND otherwise
+ */
+int read_in_place_trailer(FILE *fp, container_header_t *trailer);
+
+/*
+ * Check whether a file was produced by encrypt_file_in_place
+ * file_path Path to the file
+ * 1 if it ends with an in-place trailer, 0 otherwise
+ */
+int is_in_place_encrypted(const char *file_path);
+
 /* ========================================================================
  * LOW-LEVEL ENCRYPTION/COMPRESSION FUNCTIONS
  * ======================================================================== */
@@ -80,12 +188,44 @@ int decrypt_file(const char *encrypted_path, const char *output_path,
 int compress_data(const unsigned char *input_data, long input_size,
                   unsigned char *output_data, long *output_size);
 
+/*
+ * Compress and encrypt one chunk in a single pass: RLE pairs are XORed with
+ * the keystream as they are emitted. If RLE would not shrink the chunk it is
+ * stored plain (XOR only) and output_size equals input_size.
+ * input_data Pointer to input data
+ * input_size Size of input data in bytes
+ * password Password for encryption
+ * stream_offset Keystream position of the first output byte
+ * output_data Output buffer of at least input_size bytes
+ * output_size Pointer to variable to receive output size
+ * SUCCESS on success, error code on failure
+ */
+int compress_encrypt_chunk(const unsigned char *input_data, long input_size,
+                           const char *password, long stream_offset,
+                           unsigned char *output_data, long *output_size);
+
+/*
+ * Decrypt and decompress one chunk produced by compress_encrypt_chunk
+ * stored_data Pointer to stored (encrypted) chunk bytes
+ * stored_size Size of stored chunk; equal to raw_size if stored plain
+ * password Password used for decryption
+ * stream_offset Keystream position of the first stored byte
+ * output_data Output buffer of at least raw_size bytes
+ * raw_size Expected decompressed size of the chunk
+ * output_size Out parameter to receive number of decompressed bytes
+ * SUCCESS on success, ERROR_COMPRESSION_FAILED if the chunk does not decode
+ * to exactly raw_size bytes
+ */
+int decrypt_decompress_chunk(const unsigned char *stored_data, long stored_size,
+                             const char *password, long stream_offset,
+                             unsigned char *output_data, long raw_size, long *output_size);
+
 /*
  * Apply encryption cipher to file data
  * input_data Pointer to input data
  * data_size Size of input data in bytes
  * password Password for encryption
- * output_data Pointer to output buffer
+ * output_data Pointer to output buffer; may equal input_data to encrypt in place
  * SUCCESS on success, error code on failure
  */
 int encrypt_data(const unsigned char *input_data, long data_size,
@@ -96,21 +236,61 @@ int encrypt_data(const unsigned char *input_data, long data_size,
  * encrypted_data Pointer to input encrypted bytes
  * data_size Size of input buffer in bytes
  * password Password used to derive the decryption key
- * output_data Output buffer to receive decrypted bytes (must be allocated)
+ * output_data Output buffer to receive decrypted bytes; may equal encrypted_data
  * SUCCESS on success, error code on invalid input
  */
 int decrypt_data(const unsigned char *encrypted_data, long data_size,
                  const char *password, unsigned char *output_data);
 
+/*
+ * Apply encryption cipher starting at an absolute keystream offset, so any
+ * slice of a stream can be processed independently (parallel workers,
+ * resuming an interrupted job). encrypt_data is the stream_offset 0 case.
+ * input_data Pointer to input data
+ * data_size Size of input data in bytes
+ * password Password for encryption
+ * stream_offset Position of input_data[0] within the whole stream
+ * output_data Pointer to output buffer; may equal input_data
+ * SUCCESS on success, error code on failure
+ */
+int encrypt_data_at(const unsigned char *input_data, long data_size,
+                    const char *password, long stream_offset,
+                    unsigned char *output_data);
+
+/*
+ * Decrypt a slice of a stream starting at an absolute keystream offset
+ * encrypted_data Pointer to input encrypted bytes
+ * data_size Size of input buffer in bytes
+ * password Password used to derive the decryption key
+ * stream_offset Position of encrypted_data[0] within the whole stream
+ * output_data Output buffer to receive decrypted bytes; may equal encrypted_data
+ * SUCCESS on success, error code on invalid input
+ */
+int decrypt_data_at(const unsigned char *encrypted_data, long data_size,
+                    const char *password, long stream_offset,
+                    unsigned char *output_data);
+
+/*
+ * Compute the decompressed size of a compress_data stream without decoding it
+ * compressed_data Pointer to compressed input bytes
+ * compressed_size Size of compressed input in bytes
+ * decompressed_size Out parameter to receive the total run length
+ * SUCCESS on success, ERROR_COMPRESSION_FAILED on a malformed stream
+ */
+int get_decompressed_size(const unsigned char *compressed_data, long compressed_size,
+                          long *decompressed_size);
+
 /*
  * Decompress a buffer produced by compress_data
  * compressed_data Pointer to compressed input bytes
  * compressed_size Size of compressed input in bytes
  * output_data Output buffer to receive decompressed bytes (must be allocated)
+ * output_capacity Size of output_data in bytes; decoding never writes past it
  * output_size Out parameter to receive number of decompressed bytes
- * SUCCESS on success, error code on invalid input
+ * SUCCESS on success, ERROR_COMPRESSION_FAILED if the stream is malformed or
+ * does not fit in output_capacity
  */
 int decompress_data(const unsigned char *compressed_data, long compressed_size,
-                    unsigned char *output_data, long *output_size);
+                    unsigned char *output_data, long output_capacity, long *output_size);
 
 #endif /* ENCRYPTION_H */
\ No newline at end of file
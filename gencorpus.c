@@ -0,0 +1,260 @@
+/*
+ * gencorpus.c
+ * Benchmark corpus generator for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file writes a reproducible set of data files, and optionally a
+ * library fixture, into a directory. The same options and seed give the
+ * same bytes on every machine; corpus_manifest.csv lists each file with its
+ * shape, size and checksum so two corpora can be compared at a glance.
+ * Built with `make corpus`.
+ * Usage: ./ccrypt_corpus <output_dir> [--seed 1] [--files 16]
+ *                        [--size 1M | --size-range 4K:16M]
+ *                        [--mix random:1,runs:1,text:1,sparse:1] [--library 0]
+ */
+
+#include "ccrypt.h"
+#include "corpus.h"
+#include "library.h"
+#include "checksum.h"
+#include "platform.h"
+
+#define CORPUS_MANIFEST_FILENAME "corpus_manifest.csv"
+
+/* Command-line settings */
+typedef struct {
+    const char *output_directory;
+    uint64_t seed;
+    long files;
+    uint64_t min_size;
+    uint64_t max_size;
+    unsigned int weights[CORPUS_SHAPE_COUNT];
+    unsigned int total_weight;
+    long library_entries;
+} corpus_options_t;
+
+/* forward declarations for internal helpers */
+static int parse_options(int argc, char *argv[], corpus_options_t *options);
+static int parse_size(const char *text, uint64_t *size);
+static int parse_mix(const char *text, corpus_options_t *options);
+static int bit_length(uint64_t value);
+static uint64_t pick_size(const corpus_options_t *options, uint64_t *state);
+static corpus_shape_t pick_shape(const corpus_options_t *options, uint64_t *state);
+static int write_files(const corpus_options_t *options);
+static int write_library(const corpus_options_t *options);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Parse the command line; returns SUCCESS, or an error after printing usage */
+static int parse_options(int argc, char *argv[], corpus_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->seed = 1;
+    options->files = 16;
+    options->min_size = options->max_size = 1024 * 1024;
+    for (int i = 0; i < CORPUS_SHAPE_COUNT; ++i) options->weights[i] = 1;
+    options->total_weight = CORPUS_SHAPE_COUNT;
+
+    int ok = argc >= 2 && argv[1][0] != '-';
+    if (ok) options->output_directory = argv[1];
+    for (int i = 2; ok && i < argc; ++i) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            options->files = strtol(argv[++i], NULL, 10);
+            ok = options->files >= 0;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = parse_size(argv[++i], &options->min_size) == SUCCESS;
+            options->max_size = options->min_size;
+        } else if (strcmp(argv[i], "--size-range") == 0 && i + 1 < argc) {
+            char *colon = strchr(argv[++i], ':');
+            ok = colon && parse_size(colon + 1, &options->max_size) == SUCCESS;
+            if (ok) {
+                *colon = '\0';
+                ok = parse_size(argv[i], &options->min_size) == SUCCESS &&
+                     options->min_size <= options->max_size;
+            }
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            ok = parse_mix(argv[++i], options) == SUCCESS;
+        } else if (strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+            options->library_entries = strtol(argv[++i], NULL, 10);
+            ok = options->library_entries >= 0;
+        } else {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        printf("Usage: %s <output_dir> [--seed <n>] [--files <n>]\n"
+               "          [--size <bytes> | --size-range <min>:<max>]\n"
+               "          [--mix random:<w>,runs:<w>,text:<w>,sparse:<w>] [--library <entries>]\n",
+               argv[0]);
+        return ERROR_INVALID_PATH;
+    }
+    return SUCCESS;
+}
+
+/* "64M" and friends; K, M and G are powers of 1024 */
+static int parse_size(const char *text, uint64_t *size)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024; end++; break;
+        case 'm': case 'M': value *= 1024 * 1024; end++; break;
+        case 'g': case 'G': value *= 1024ULL * 1024 * 1024; end++; break;
+        default: break;
+    }
+    if (end == text || *end != '\0') return ERROR_INVALID_PATH;
+    *size = value;
+    return SUCCESS;
+}
+
+/* "text:3,random:1": shapes left out get no files */
+static int parse_mix(const char *text, corpus_options_t *options)
+{
+    char mix[128];
+    if (strlen(text) >= sizeof(mix)) return ERROR_INVALID_PATH;
+    strcpy(mix, text);
+    memset(options->weights, 0, sizeof(options->weights));
+    options->total_weight = 0;
+
+    for (char *item = strtok(mix, ","); item; item = strtok(NULL, ",")) {
+        char *colon = strchr(item, ':');
+        unsigned int weight = 1;
+        if (colon) {
+            *colon = '\0';
+            weight = (unsigned int)strtoul(colon + 1, NULL, 10);
+        }
+        corpus_shape_t shape;
+        if (corpus_shape_from_name(item, &shape) != SUCCESS) {
+            printf("Error: unknown shape '%s'\n", item);
+            return ERROR_INVALID_PATH;
+        }
+        options->weights[shape] = weight;
+    }
+    for (int i = 0; i < CORPUS_SHAPE_COUNT; ++i) options->total_weight += options->weights[i];
+    return options->total_weight > 0 ? SUCCESS : ERROR_INVALID_PATH;
+}
+
+static int bit_length(uint64_t value)
+{
+    int bits = 0;
+    while (value) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+/* Sizes spread evenly over the powers of two in the range, then uniformly
+   within one; integer only, so every machine picks the same sizes */
+static uint64_t pick_size(const corpus_options_t *options, uint64_t *state)
+{
+    if (options->min_size == options->max_size) return options->min_size;
+    int low = bit_length(options->min_size);
+    int high = bit_length(options->max_size);
+    int bits = low + (int)(corpus_random(state) % (uint64_t)(high - low + 1));
+    uint64_t from = bits > 0 ? 1ULL << (bits - 1) : 0;
+    uint64_t to = bits > 0 ? (bits < 64 ? (1ULL << bits) - 1 : UINT64_MAX) : 0;
+    if (from < options->min_size) from = options->min_size;
+    if (to > options->max_size) to = options->max_size;
+    return from + corpus_random(state) % (to - from + 1);
+}
+
+static corpus_shape_t pick_shape(const corpus_options_t *options, uint64_t *state)
+{
+    unsigned int ticket = (unsigned int)(corpus_random(state) % options->total_weight);
+    for (int i = 0; i < CORPUS_SHAPE_COUNT; ++i) {
+        if (ticket < options->weights[i]) return (corpus_shape_t)i;
+        ticket -= options->weights[i];
+    }
+    return CORPUS_RANDOM;
+}
+
+/* Write the data files and their manifest; file i depends only on the
+   seed and i, so corpora of different lengths share their first files */
+static int write_files(const corpus_options_t *options)
+{
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", options->output_directory, CORPUS_MANIFEST_FILENAME);
+    FILE *manifest = fopen(path, "w");
+    if (!manifest) return ERROR_PERMISSION_DENIED;
+    fprintf(manifest, "file,shape,size,checksum\n");
+
+    int result = SUCCESS;
+    uint64_t total = 0;
+    for (long i = 0; result == SUCCESS && i < options->files; ++i) {
+        uint64_t state = corpus_derive_seed(options->seed, (uint64_t)i);
+        corpus_shape_t shape = pick_shape(options, &state);
+        uint64_t size = pick_size(options, &state);
+        char name[MAX_FILENAME_LENGTH];
+        snprintf(name, sizeof(name), "%s_%06ld.dat", corpus_shape_name(shape), i);
+        snprintf(path, sizeof(path), "%s/%s", options->output_directory, name);
+
+        uint64_t checksum;
+        result = corpus_write_file(path, shape, corpus_random(&state), size, &checksum);
+        if (result != SUCCESS) {
+            printf("Error: could not write '%s'\n", path);
+            break;
+        }
+        char hex[CHECKSUM_HEX_LENGTH + 1];
+        format_checksum(checksum, hex, sizeof(hex));
+        fprintf(manifest, "%s,%s,%llu,%s\n", name, corpus_shape_name(shape),
+                (unsigned long long)size, hex);
+        total += size;
+    }
+    if (fclose(manifest) != 0 && result == SUCCESS) result = ERROR_PERMISSION_DENIED;
+    if (result == SUCCESS) {
+        printf("Wrote %ld files (%llu bytes) to %s\n", options->files,
+               (unsigned long long)total, options->output_directory);
+    }
+    return result;
+}
+
+/* Save a library fixture of generated entries as the directory's library */
+static int write_library(const corpus_options_t *options)
+{
+    encryption_library_t library;
+    int result = corpus_build_library(&library, options->library_entries,
+                                      corpus_derive_seed(options->seed, UINT64_MAX));
+    if (result == SUCCESS && platform_change_directory(options->output_directory) != SUCCESS) {
+        result = ERROR_FILE_NOT_FOUND;
+    }
+    if (result == SUCCESS) {
+        library.is_modified = 1;
+        result = save_encryption_library(&library);
+    }
+    free_library(&library);
+    if (result == SUCCESS) {
+        printf("Wrote library fixture with %ld entries to %s/%s\n", options->library_entries,
+               options->output_directory, LIBRARY_FILENAME);
+    } else {
+        printf("Error: could not write library fixture (error %d)\n", result);
+    }
+    return result;
+}
+
+/* ========================================================================
+ * MAIN PROGRAM
+ * ======================================================================== */
+
+/*
+ * Corpus generator entry point
+ * [Chu-Cheng Yu]
+ */
+int main(int argc, char *argv[])
+{
+    corpus_options_t options;
+    if (parse_options(argc, argv, &options) != SUCCESS) return EXIT_FAILURE;
+
+    if (platform_make_directory(options.output_directory) != SUCCESS) {
+        printf("Error: could not create directory '%s'\n", options.output_directory);
+        return EXIT_FAILURE;
+    }
+    int result = write_files(&options);
+    /* Last, since it changes into the output directory */
+    if (result == SUCCESS && options.library_entries > 0) result = write_library(&options);
+    return result == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,15 +12,118 @@
  * ======================================================================== */
 #define DEBUG
 
+#include <stddef.h>
+#include <limits.h>
+
 #include "ccrypt.h"
 #include "library.h"
 #include "ui.h"
 #include "utils.h"
-
-/* forward declarations for comparators used by qsort */
-static int cmp_name(const void *a, const void *b);
-static int cmp_date(const void *a, const void *b);
-static int cmp_size(const void *a, const void *b);
+#include "pack.h"
+#include "stats.h"
+#include "checksum.h"
+#include "sort.h"
+
+/* Entry layout of libraries saved with LEGACY_LIBRARY_SIGNATURE */
+typedef struct {
+    char original_filename[MAX_FILENAME_LENGTH];
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    char file_path[MAX_PATH_LENGTH];
+    long original_size;
+    long encrypted_size;
+    unsigned long encryption_id;
+    int encryption_method;
+    int is_compressed;
+    char file_type[10];
+    char checksum[33];
+} legacy_file_metadata_t;
+
+/* Entry layout of libraries saved with LEGACY_LIBRARY_SIGNATURE_V11 */
+typedef struct {
+    char original_filename[MAX_FILENAME_LENGTH];
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    char file_path[MAX_PATH_LENGTH];
+    long original_size;
+    long encrypted_size;
+    unsigned long encryption_id;
+    int encryption_method;
+    int is_compressed;
+    char file_type[10];
+    char checksum[33];
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+} legacy_file_metadata_v11_t;
+
+/* Entry layout of libraries saved with LEGACY_LIBRARY_SIGNATURE_V12 */
+typedef struct {
+    char original_filename[MAX_FILENAME_LENGTH];
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    char file_path[MAX_PATH_LENGTH];
+    long original_size;
+    long encrypted_size;
+    unsigned long encryption_id;
+    int encryption_method;
+    int is_compressed;
+    char file_type[10];
+    char checksum[33];
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+    uint64_t source_mtime_ns;
+} legacy_file_metadata_v12_t;
+
+/* How entries of one library version are read: fields are only ever
+   appended, so an old record is a prefix of file_metadata_t */
+typedef struct {
+    const char *signature;
+    size_t record_size;      /* bytes per entry on disk */
+    size_t prefix_size;      /* leading bytes shared with file_metadata_t */
+} library_layout_t;
+
+static const library_layout_t library_layouts[] = {
+    { ENCRYPTION_SIGNATURE, sizeof(file_metadata_t), sizeof(file_metadata_t) },
+    { LEGACY_LIBRARY_SIGNATURE_V12, sizeof(legacy_file_metadata_v12_t),
+      offsetof(file_metadata_t, pack_id) },
+    { LEGACY_LIBRARY_SIGNATURE_V11, sizeof(legacy_file_metadata_v11_t),
+      offsetof(file_metadata_t, source_mtime_ns) },
+    { LEGACY_LIBRARY_SIGNATURE, sizeof(legacy_file_metadata_t),
+      offsetof(file_metadata_t, key_fingerprint) },
+};
+
+/* forward declarations for internal helpers */
+static int read_metadata_entry(FILE *fp, const library_layout_t *layout, file_metadata_t *metadata);
+static file_node_t *take_node(encryption_library_t *library, int expected);
+static void release_node(encryption_library_t *library, file_node_t *node);
+static int reserve_hot(encryption_library_t *library, int count);
+static void fill_hot(library_hot_t *hot, file_node_t *node);
+static void refresh_hot_index(encryption_library_t *library);
+static file_metadata_t *hand_out(encryption_library_t *library, int index);
+static sort_pair_t *sorted_view(encryption_library_t *library, sort_option_t sort_option);
+static void sort_hot_index(encryption_library_t *library, sort_option_t sort_option);
+static uint32_t name_hash(const char *name);
+
+/* Nodes are carved from slabs instead of one malloc each, so a large
+   library loads in a few allocations and is torn down one slab at a time */
+struct library_slab {
+    struct library_slab *next;
+    int used;
+    int capacity;
+    file_node_t nodes[];
+};
+
+/* The fields sorts and lookups compare, packed into 48 bytes; the full
+   entry stays in its node and is read only to confirm a match. Entry i
+   describes the i-th node of the list. */
+struct library_hot {
+    file_node_t *node;
+    unsigned long encryption_id;
+    long original_size;
+    uint64_t name_key;          /* sort_string_key of original_filename */
+    uint32_t name_hash;         /* of original_filename */
+    uint32_t encrypted_hash;    /* of encrypted_filename */
+    uint32_t flags;             /* HOT_* */
+};
+
+#define HOT_COMPRESSED 0x1
+#define HOT_LOOSE 0x2   /* handed out since the record was last filled: the
+                           next scan re-fills it before trusting it */
 
 /* ========================================================================
  * LIBRARY MANAGEMENT FUNCTIONS
@@ -35,6 +138,7 @@ int load_encryption_library(encryption_library_t *library)
    if (!library) return ERROR_INVALID_PATH;
 
     free_library(library); 
+    STATS_START(load_started);
     FILE *fp = fopen(LIBRARY_FILENAME, "rb");
     if (!fp) {
         
@@ -47,7 +151,14 @@ int load_encryption_library(encryption_library_t *library)
 
       char signature[16] = {0};
     fread(signature, sizeof(char), strlen(ENCRYPTION_SIGNATURE), fp);
-    if (strncmp(signature, ENCRYPTION_SIGNATURE, strlen(ENCRYPTION_SIGNATURE)) != 0) {
+    /* Older libraries are read and rewritten in the current layout */
+    const library_layout_t *layout = NULL;
+    for (size_t i = 0; i < sizeof(library_layouts) / sizeof(library_layouts[0]); ++i) {
+        if (strncmp(signature, library_layouts[i].signature, strlen(ENCRYPTION_SIGNATURE)) == 0) {
+            layout = &library_layouts[i];
+        }
+    }
+    if (!layout) {
         fclose(fp);
         return ERROR_LIBRARY_CORRUPT;
     }
@@ -60,14 +171,14 @@ int load_encryption_library(encryption_library_t *library)
 
     for (int i = 0; i < library->count; ++i) {
         file_metadata_t metadata;
-        if (fread(&metadata, sizeof(file_metadata_t), 1, fp) != 1) {
+        if (read_metadata_entry(fp, layout, &metadata) != SUCCESS) {
             fclose(fp);
             free_library(library);
             return ERROR_LIBRARY_CORRUPT;
         }
 
-        file_node_t *node = malloc(sizeof(file_node_t));
-        if (!node) {
+        file_node_t *node = take_node(library, library->count - i);
+        if (!node || reserve_hot(library, i + 1) != SUCCESS) {
             fclose(fp);
             free_library(library);
             return ERROR_MEMORY_ALLOCATION;
@@ -75,6 +186,7 @@ int load_encryption_library(encryption_library_t *library)
 
         node->data = metadata;
         node->next = NULL;
+        fill_hot(&library->hot[i], node);
 
         if (!library->head)
             library->head = node;
@@ -84,8 +196,9 @@ int load_encryption_library(encryption_library_t *library)
         prev = node;
     }
 
+    STATS_STOP_RUN(STATS_LIBRARY_LOAD, load_started, ftell(fp));
     fclose(fp);
-    library->is_modified = 0;
+    library->is_modified = layout != &library_layouts[0];
     return SUCCESS;
 }
 
@@ -98,6 +211,7 @@ int save_encryption_library(encryption_library_t *library)
      if (!library) return ERROR_INVALID_PATH;
     if (!library->is_modified) return SUCCESS; 
 
+    STATS_START(save_started);
     FILE *fp = fopen(LIBRARY_FILENAME, "wb");
     if (!fp) return ERROR_FILE_NOT_FOUND;
 
@@ -117,6 +231,9 @@ int save_encryption_library(encryption_library_t *library)
 
     fclose(fp);
     library->is_modified = 0;
+    STATS_STOP_RUN(STATS_LIBRARY_SAVE, save_started,
+                   strlen(ENCRYPTION_SIGNATURE) + sizeof(int) + sizeof(unsigned long) +
+                   (size_t)library->count * sizeof(file_metadata_t));
     return SUCCESS;
 }
 
@@ -128,10 +245,12 @@ int add_file_to_library(encryption_library_t *library, const file_metadata_t *me
 {
     if (!library || !metadata) return ERROR_INVALID_PATH;
 
-    file_node_t *node = (file_node_t *)malloc(sizeof(file_node_t));
+    if (reserve_hot(library, library->count + 1) != SUCCESS) return ERROR_MEMORY_ALLOCATION;
+    file_node_t *node = take_node(library, 1);
     if (!node) return ERROR_MEMORY_ALLOCATION;
     node->data = *metadata;
     node->next = NULL;
+    fill_hot(&library->hot[library->count], node);
 
     /* append to end */
     if (!library->head) {
@@ -152,6 +271,49 @@ int add_file_to_library(encryption_library_t *library, const file_metadata_t *me
     return SUCCESS;
 }
 
+/*
+ * Append a batch of entries to the library in one pass
+ * [Chu-Cheng Yu]
+ */
+int add_files_to_library(encryption_library_t *library, const file_metadata_t *entries, int count)
+{
+    if (!library || (count > 0 && !entries)) return ERROR_INVALID_PATH;
+    if (count <= 0) return SUCCESS;
+    if (count > INT_MAX - library->count ||
+        reserve_hot(library, library->count + count) != SUCCESS) {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    /* Build the new run of nodes first so a failed allocation adds nothing */
+    file_node_t *first = NULL;
+    file_node_t **link = &first;
+    for (int i = 0; i < count; ++i) {
+        file_node_t *node = take_node(library, count - i);
+        if (!node) {
+            while (first) {
+                file_node_t *next = first->next;
+                release_node(library, first);
+                first = next;
+            }
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        node->data = entries[i];
+        node->next = NULL;
+        *link = node;
+        link = &node->next;
+    }
+
+    file_node_t **tail = &library->head;
+    while (*tail) tail = &(*tail)->next;
+    *tail = first;
+    for (int i = 0; first; ++i, first = first->next) {
+        fill_hot(&library->hot[library->count + i], first);
+    }
+    library->count += count;
+    library->is_modified = 1;
+    return SUCCESS;
+}
+
 /*
  * Remove a library entry at the specified index
  * library Pointer to the encryption library
@@ -175,7 +337,9 @@ int remove_file_from_library(encryption_library_t *library, int index)
     if (!cur) return ERROR_INVALID_PATH;
     if (prev) prev->next = cur->next;
     else library->head = cur->next;
-    free(cur);
+    release_node(library, cur);
+    memmove(&library->hot[index], &library->hot[index + 1],
+            (size_t)(library->count - index - 1) * sizeof(library_hot_t));
     library->count--;
     library->is_modified = 1;
     return SUCCESS;
@@ -192,44 +356,28 @@ void display_library_contents(encryption_library_t *library, sort_option_t sort_
         return;
     }
 
-    /* Build a temporary array for sorting/display */
+    /* Sort a view of the entries; the list keeps its order */
     int n = library->count;
-    file_metadata_t *arr = (file_metadata_t *)malloc(sizeof(file_metadata_t) * n);
-    if (!arr) {
+    sort_pair_t *view = sorted_view(library, sort_option);
+    if (!view) {
         printf("Memory error\n");
         return;
     }
-    file_node_t *cur = library->head;
-    for (int i = 0; i < n && cur; ++i, cur = cur->next) arr[i] = cur->data;
-
-    /* Sort array based on option */
-    switch (sort_option) {
-        case SORT_BY_NAME:
-            qsort(arr, n, sizeof(file_metadata_t), cmp_name);
-            break;
-        case SORT_BY_DATE:
-            qsort(arr, n, sizeof(file_metadata_t), cmp_date);
-            break;
-        case SORT_BY_SIZE:
-            qsort(arr, n, sizeof(file_metadata_t), cmp_size);
-            break;
-        default:
-            break;
-    }
 
     printf("\nEncrypted Files Library (%d entries):\n", n);
     printf("=====================================\n");
     printf("%-3s %-20s %-10s %-12s %-10s\n", "No.", "Filename", "Size", "Date", "Compressed");
     printf("-------------------------------------------------------------\n");
     for (int i = 0; i < n; ++i) {
+        const library_hot_t *hot = &library->hot[view[i].index];
         printf("%-3d %-20s %-10ld %-12lu %-10s\n",
                i + 1,
-               arr[i].original_filename,
-               arr[i].original_size,
-               arr[i].encryption_id,
-               arr[i].is_compressed ? "Yes" : "No");
+               hot->node->data.original_filename,
+               hot->original_size,
+               hot->encryption_id,
+               (hot->flags & HOT_COMPRESSED) ? "Yes" : "No");
     }
-    free(arr);
+    free(view);
 }
 
 /*
@@ -251,10 +399,17 @@ void display_file_information(encryption_library_t *library, int index)
     printf("File information for entry %d:\n", index + 1);
     printf(" Original: %s\n", m->original_filename);
     printf(" Encrypted: %s\n", m->encrypted_filename);
+    if (m->file_path[0]) printf(" Location: %s\n", m->file_path);
     printf(" Original size: %ld\n", m->original_size);
     printf(" Encrypted size: %ld\n", m->encrypted_size);
     printf(" Compressed: %s\n", m->is_compressed ? "Yes" : "No");
     printf(" Method: %d\n", m->encryption_method);
+    printf(" Checksum: %s\n", m->checksum[0] ? m->checksum : "(none)");
+    if (m->pack_id != 0) {
+        char pack_name[MAX_FILENAME_LENGTH];
+        pack_filename(m->pack_id, pack_name, sizeof(pack_name));
+        printf(" Stored in: %s at offset %llu\n", pack_name, (unsigned long long)m->pack_offset);
+    }
 }
 
 /*
@@ -297,8 +452,30 @@ int delete_encrypted_file(encryption_library_t *library, int index)
         return ERROR_INVALID_PATH;
     }
 
-    int ret = remove(cur_file->original_filename);
-    if (ret != SUCCESS) {
+    /* A packed object is only dropped from the index; its bytes are
+       reclaimed when enough of the pack is garbage to be worth rewriting,
+       or with the pack once nothing else is in it */
+    if (cur_file->pack_id != 0) {
+        uint64_t pack_id = cur_file->pack_id;
+        int result = remove_file_from_library(library, index);
+        if (result != SUCCESS) return result;
+        int pack_in_use = 0;
+        for (file_node_t *cur = library->head; cur && !pack_in_use; cur = cur->next) {
+            pack_in_use = cur->data.pack_id == pack_id;
+        }
+        if (pack_in_use) {
+            repack_library(library, 0, NULL);
+        } else {
+            char pack_name[MAX_FILENAME_LENGTH];
+            pack_filename(pack_id, pack_name, sizeof(pack_name));
+            remove(pack_name);
+        }
+        return SUCCESS;
+    }
+
+    /* Deduplicated entries share one encrypted file; keep it for the others */
+    int references = count_location_references(library, encrypted_file_location(cur_file));
+    if (references == 1 && remove(encrypted_file_location(cur_file)) != SUCCESS) {
         return ERROR_DELETE_FAILED;
     }
 
@@ -360,23 +537,202 @@ int get_library_count(encryption_library_t *library)
 file_metadata_t *get_library_entry(encryption_library_t *library, int index)
 {
     if (!library || index < 0 || index >= library->count) return NULL;
-    int i = 0;
-    file_node_t *cur = library->head;
-    while (cur && i < index) { cur = cur->next; i++; }
-    if (!cur) return NULL;
-    return &cur->data;
+    return hand_out(library, index);
+}
+
+/* Helper: return metadata whose encrypted filename matches (NULL if none) */
+file_metadata_t *find_library_entry_by_encrypted_name(encryption_library_t *library,
+                                                      const char *encrypted_filename)
+{
+    if (!library || !encrypted_filename) return NULL;
+    uint32_t hash = name_hash(encrypted_filename);
+    for (int i = 0; i < library->count; ++i) {
+        library_hot_t *hot = &library->hot[i];
+        if (hot->flags & HOT_LOOSE) fill_hot(hot, hot->node);
+        if (hot->encrypted_hash != hash) continue;
+        if (strncmp(hot->node->data.encrypted_filename, encrypted_filename,
+                    MAX_FILENAME_LENGTH) == 0) {
+            return hand_out(library, i);
+        }
+    }
+    return NULL;
+}
+
+/* Helper: index of an entry handed out by a lookup */
+int get_library_index(encryption_library_t *library, const file_metadata_t *entry)
+{
+    if (!library || !entry) return -1;
+    for (int i = 0; i < library->count; ++i) {
+        if (&library->hot[i].node->data == entry) return i;
+    }
+    return -1;
+}
+
+/* Helper: re-sync the record of an entry changed through its pointer */
+void library_entry_updated(encryption_library_t *library, const file_metadata_t *entry)
+{
+    int index = get_library_index(library, entry);
+    if (index >= 0) fill_hot(&library->hot[index], library->hot[index].node);
+}
+
+/* Helper: re-sync every record after many entries were changed */
+void library_entries_updated(encryption_library_t *library)
+{
+    if (!library) return;
+    for (int i = 0; i < library->count; ++i) fill_hot(&library->hot[i], library->hot[i].node);
+}
+
+/* Helper: path of an entry's encrypted file on disk */
+const char *encrypted_file_location(const file_metadata_t *metadata)
+{
+    return metadata->file_path[0] ? metadata->file_path : metadata->encrypted_filename;
+}
+
+/* Helper: number of unpacked entries whose encrypted file is at location */
+int count_location_references(encryption_library_t *library, const char *location)
+{
+    if (!library || !location) return 0;
+    int references = 0;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if (cur->data.pack_id == 0 &&
+            strncmp(encrypted_file_location(&cur->data), location, MAX_PATH_LENGTH) == 0) {
+            references++;
+        }
+    }
+    return references;
+}
+
+/* Helper: record the name and location of a newly written encrypted file */
+void set_encrypted_location(file_metadata_t *metadata, const char *encrypted_filename,
+                            const char *file_path)
+{
+    safe_string_copy(metadata->encrypted_filename, encrypted_filename,
+                     sizeof(metadata->encrypted_filename));
+    safe_string_copy(metadata->file_path, file_path, sizeof(metadata->file_path));
+}
+
+/* Helper: return metadata whose original filename matches (NULL if none) */
+file_metadata_t *find_library_entry_by_original_name(encryption_library_t *library,
+                                                     const char *original_filename)
+{
+    if (!library || !original_filename) return NULL;
+    uint32_t hash = name_hash(original_filename);
+    for (int i = 0; i < library->count; ++i) {
+        library_hot_t *hot = &library->hot[i];
+        if (hot->flags & HOT_LOOSE) fill_hot(hot, hot->node);
+        if (hot->name_hash != hash) continue;
+        if (strncmp(hot->node->data.original_filename, original_filename,
+                    MAX_FILENAME_LENGTH) == 0) {
+            return hand_out(library, i);
+        }
+    }
+    return NULL;
+}
+
+/* Helper: return an entry holding the same plaintext under the same key (NULL if none) */
+file_metadata_t *find_library_entry_by_content(encryption_library_t *library, long original_size,
+                                               const char *checksum, const char *key_fingerprint)
+{
+    if (!library || !checksum || !key_fingerprint) return NULL;
+    for (int i = 0; i < library->count; ++i) {
+        library_hot_t *hot = &library->hot[i];
+        if (hot->flags & HOT_LOOSE) fill_hot(hot, hot->node);
+        if (hot->original_size != original_size) continue;
+        const file_metadata_t *m = &hot->node->data;
+        if (m->original_size == original_size &&
+            strncmp(m->checksum, checksum, sizeof(m->checksum)) == 0 &&
+            strncmp(m->key_fingerprint, key_fingerprint, sizeof(m->key_fingerprint)) == 0) {
+            return hand_out(library, i);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Report how much space deduplication is saving
+ * [Chu-Cheng Yu]
+ */
+void display_dedup_savings(encryption_library_t *library)
+{
+    if (!library || library->count == 0) {
+        printf("No encrypted files in library.\n");
+        return;
+    }
+
+    /* Entries sharing an encrypted file end up next to each other */
+    int n = library->count;
+    const file_metadata_t **arr = (const file_metadata_t **)malloc(sizeof(*arr) * n);
+    const char **names = (const char **)calloc((size_t)n, sizeof(*names));
+    sort_pair_t *view = (sort_pair_t *)malloc(sizeof(*view) * n);
+    if (!arr || !names || !view) {
+        free(arr);
+        free(names);
+        free(view);
+        printf("Memory error\n");
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        names[i] = library->hot[i].node->data.encrypted_filename;
+        view[i].key = sort_string_key(names[i]);
+        view[i].index = (uint32_t)i;
+    }
+    if (sort_pairs_by_string(view, (size_t)n, names, MAX_FILENAME_LENGTH) != SUCCESS) {
+        free(arr);
+        free(names);
+        free(view);
+        printf("Memory error\n");
+        return;
+    }
+    for (int i = 0; i < n; ++i) arr[i] = &library->hot[view[i].index].node->data;
+    free(names);
+    free(view);
+
+    int shared_objects = 0;
+    int linked_entries = 0;
+    long long saved_storage = 0;
+    long long saved_plaintext = 0;
+    for (int i = 0; i < n; ) {
+        int j = i + 1;
+        while (j < n && strncmp(arr[j]->encrypted_filename, arr[i]->encrypted_filename,
+                                MAX_FILENAME_LENGTH) == 0) {
+            j++;
+        }
+        if (j - i > 1) {
+            shared_objects++;
+            linked_entries += j - i - 1;
+            saved_storage += (long long)(j - i - 1) * arr[i]->encrypted_size;
+            saved_plaintext += (long long)(j - i - 1) * arr[i]->original_size;
+            printf("  %s shared by %d entries\n", arr[i]->encrypted_filename, j - i);
+        }
+        i = j;
+    }
+    free(arr);
+
+    char storage[32];
+    char plaintext[32];
+    format_file_size((long)saved_storage, storage, sizeof(storage));
+    format_file_size((long)saved_plaintext, plaintext, sizeof(plaintext));
+    printf("Deduplication: %d entries linked to %d shared encrypted files\n",
+           linked_entries, shared_objects);
+    printf("Saved %s of encrypted storage (%s of plaintext not re-encrypted)\n",
+           storage, plaintext);
 }
 
 /* Helper: free entire library list */
 void free_library(encryption_library_t *library)
 {
     if (!library) return;
-    file_node_t *cur = library->head;
-    while (cur) {
-        file_node_t *next = cur->next;
-        free(cur);
-        cur = next;
+    library_slab_t *slab = library->slabs;
+    while (slab) {
+        library_slab_t *next = slab->next;
+        free(slab);
+        slab = next;
     }
+    free(library->hot);
+    library->slabs = NULL;
+    library->free_nodes = NULL;
+    library->hot = NULL;
+    library->hot_capacity = 0;
     library->head = NULL;
     library->count = 0;
     library->is_modified = 0;
@@ -387,30 +743,163 @@ void free_library(encryption_library_t *library)
  * Author Chu-Cheng Yu
  * ======================================================================== */
 
-/* Simple sort helpers: use qsort with wrappers */
-static int cmp_name(const void *a, const void *b)
+/* Read one entry written in the given layout */
+static int read_metadata_entry(FILE *fp, const library_layout_t *layout, file_metadata_t *metadata)
+{
+    if (layout == &library_layouts[0]) {
+        return fread(metadata, sizeof(file_metadata_t), 1, fp) == 1 ? SUCCESS : ERROR_LIBRARY_CORRUPT;
+    }
+    unsigned char record[sizeof(file_metadata_t)];
+    if (fread(record, layout->record_size, 1, fp) != 1) return ERROR_LIBRARY_CORRUPT;
+    memset(metadata, 0, sizeof(*metadata));
+    memcpy(metadata, record, layout->prefix_size);
+    return SUCCESS;
+}
+
+/* Next unused node, from the free list or the newest slab. A new slab
+   holds expected nodes, within LIBRARY_SLAB_NODES..LIBRARY_SLAB_MAX_NODES. */
+static file_node_t *take_node(encryption_library_t *library, int expected)
+{
+    if (library->free_nodes) {
+        file_node_t *node = library->free_nodes;
+        library->free_nodes = node->next;
+        return node;
+    }
+    library_slab_t *slab = library->slabs;
+    if (!slab || slab->used == slab->capacity) {
+        int capacity = expected;
+        if (capacity < LIBRARY_SLAB_NODES) capacity = LIBRARY_SLAB_NODES;
+        if (capacity > LIBRARY_SLAB_MAX_NODES) capacity = LIBRARY_SLAB_MAX_NODES;
+        slab = (library_slab_t *)malloc(sizeof(library_slab_t) +
+                                        (size_t)capacity * sizeof(file_node_t));
+        if (!slab) return NULL;
+        slab->used = 0;
+        slab->capacity = capacity;
+        slab->next = library->slabs;
+        library->slabs = slab;
+    }
+    return &slab->nodes[slab->used++];
+}
+
+/* Keep a node that left the list for the next take_node */
+static void release_node(encryption_library_t *library, file_node_t *node)
+{
+    node->next = library->free_nodes;
+    library->free_nodes = node;
+}
+
+/* Make room for count hot records */
+static int reserve_hot(encryption_library_t *library, int count)
+{
+    if (count <= library->hot_capacity) return SUCCESS;
+    int capacity = library->hot_capacity ? library->hot_capacity : LIBRARY_SLAB_NODES;
+    while (capacity < count) capacity = capacity > INT_MAX / 2 ? count : capacity * 2;
+    library_hot_t *hot = (library_hot_t *)realloc(library->hot,
+                                                  (size_t)capacity * sizeof(library_hot_t));
+    if (!hot) return ERROR_MEMORY_ALLOCATION;
+    library->hot = hot;
+    library->hot_capacity = capacity;
+    return SUCCESS;
+}
+
+/* Describe a node in its hot record */
+static void fill_hot(library_hot_t *hot, file_node_t *node)
 {
-    const file_metadata_t *x = (const file_metadata_t *)a;
-    const file_metadata_t *y = (const file_metadata_t *)b;
-    return strncmp(x->original_filename, y->original_filename, MAX_FILENAME_LENGTH);
+    const file_metadata_t *m = &node->data;
+    hot->node = node;
+    hot->encryption_id = m->encryption_id;
+    hot->original_size = m->original_size;
+    hot->name_key = sort_string_key(m->original_filename);
+    hot->name_hash = name_hash(m->original_filename);
+    hot->encrypted_hash = name_hash(m->encrypted_filename);
+    hot->flags = m->is_compressed ? HOT_COMPRESSED : 0;
+}
+
+/* Re-fill the records of entries that callers may have changed */
+static void refresh_hot_index(encryption_library_t *library)
+{
+    for (int i = 0; i < library->count; ++i) {
+        library_hot_t *hot = &library->hot[i];
+        if (hot->flags & HOT_LOOSE) fill_hot(hot, hot->node);
+    }
+}
+
+/* Give a caller a writable entry; its hot record is not trusted from now on */
+static file_metadata_t *hand_out(encryption_library_t *library, int index)
+{
+    library->hot[index].flags |= HOT_LOOSE;
+    return &library->hot[index].node->data;
+}
+
+/* Order of the entries under a sort option, as pairs indexing the hot
+   records; NULL if memory is exhausted */
+static sort_pair_t *sorted_view(encryption_library_t *library, sort_option_t sort_option)
+{
+    int n = library->count;
+    sort_pair_t *view = (sort_pair_t *)malloc(sizeof(sort_pair_t) * (n > 0 ? n : 1));
+    if (!view) return NULL;
+    refresh_hot_index(library);
+    for (int i = 0; i < n; ++i) {
+        const library_hot_t *hot = &library->hot[i];
+        view[i].index = (uint32_t)i;
+        switch (sort_option) {
+            case SORT_BY_NAME: view[i].key = hot->name_key; break;
+            /* most recent and largest first */
+            case SORT_BY_DATE: view[i].key = ~(uint64_t)hot->encryption_id; break;
+            case SORT_BY_SIZE: view[i].key = ~sort_signed_key(hot->original_size); break;
+            default: view[i].key = (uint64_t)i; break;
+        }
+    }
+
+    int result = SUCCESS;
+    if (sort_option == SORT_BY_NAME) {
+        const char **names = (const char **)malloc(sizeof(*names) * (n > 0 ? n : 1));
+        if (!names) {
+            free(view);
+            return NULL;
+        }
+        for (int i = 0; i < n; ++i) names[i] = library->hot[i].node->data.original_filename;
+        result = sort_pairs_by_string(view, (size_t)n, names, MAX_FILENAME_LENGTH);
+        free(names);
+    } else if (sort_option == SORT_BY_DATE || sort_option == SORT_BY_SIZE) {
+        result = sort_pairs(view, (size_t)n);
+    }
+    if (result != SUCCESS) {
+        free(view);
+        return NULL;
+    }
+    return view;
 }
 
-static int cmp_date(const void *a, const void *b)
+/* Reorder the hot records by a sort option and relink the list to match;
+   no entry is copied. The library is left as it was if memory runs out. */
+static void sort_hot_index(encryption_library_t *library, sort_option_t sort_option)
 {
-    const file_metadata_t *x = (const file_metadata_t *)a;
-    const file_metadata_t *y = (const file_metadata_t *)b;
-    if (x->encryption_id < y->encryption_id) return 1;
-    if (x->encryption_id > y->encryption_id) return -1;
-    return 0;
+    sort_pair_t *view = sorted_view(library, sort_option);
+    library_hot_t *sorted = (library_hot_t *)malloc(sizeof(library_hot_t) *
+                                                    (size_t)library->hot_capacity);
+    if (!view || !sorted) {
+        free(view);
+        free(sorted);
+        return;
+    }
+    for (int i = 0; i < library->count; ++i) sorted[i] = library->hot[view[i].index];
+    free(view);
+    free(library->hot);
+    library->hot = sorted;
+
+    library->head = library->hot[0].node;
+    for (int i = 0; i + 1 < library->count; ++i) {
+        library->hot[i].node->next = library->hot[i + 1].node;
+    }
+    library->hot[library->count - 1].node->next = NULL;
 }
 
-static int cmp_size(const void *a, const void *b)
+static uint32_t name_hash(const char *name)
 {
-    const file_metadata_t *x = (const file_metadata_t *)a;
-    const file_metadata_t *y = (const file_metadata_t *)b;
-    if (x->original_size < y->original_size) return 1;
-    if (x->original_size > y->original_size) return -1;
-    return 0;
+    const char *end = memchr(name, '\0', MAX_FILENAME_LENGTH);
+    size_t length = end ? (size_t)(end - name) : MAX_FILENAME_LENGTH;
+    return (uint32_t)checksum_buffer((const unsigned char *)name, length);
 }
 
 /*
@@ -421,17 +910,7 @@ static int cmp_size(const void *a, const void *b)
 void sort_library_by_name(encryption_library_t *library)
 {
     if (!library || library->count <= 1) return;
-    int n = library->count;
-    file_metadata_t *arr = malloc(sizeof(file_metadata_t) * n);
-    if (!arr) return;
-    file_node_t *cur = library->head;
-    for (int i = 0; i < n && cur; ++i, cur = cur->next) arr[i] = cur->data;
-    qsort(arr, n, sizeof(file_metadata_t), cmp_name);
-    /* rebuild linked list in sorted order */
-    cur = library->head;
-    int i = 0;
-    while (cur && i < n) { cur->data = arr[i++]; cur = cur->next; }
-    free(arr);
+    sort_hot_index(library, SORT_BY_NAME);
 }
 
 /*
@@ -442,15 +921,7 @@ void sort_library_by_name(encryption_library_t *library)
 void sort_library_by_date(encryption_library_t *library)
 {
     if (!library || library->count <= 1) return;
-    int n = library->count;
-    file_metadata_t *arr = malloc(sizeof(file_metadata_t) * n);
-    if (!arr) return;
-    file_node_t *cur = library->head;
-    for (int i = 0; i < n && cur; ++i, cur = cur->next) arr[i] = cur->data;
-    qsort(arr, n, sizeof(file_metadata_t), cmp_date);
-    cur = library->head; int i = 0;
-    while (cur && i < n) { cur->data = arr[i++]; cur = cur->next; }
-    free(arr);
+    sort_hot_index(library, SORT_BY_DATE);
 }
 
 /*
@@ -461,15 +932,7 @@ void sort_library_by_date(encryption_library_t *library)
 void sort_library_by_size(encryption_library_t *library)
 {
     if (!library || library->count <= 1) return;
-    int n = library->count;
-    file_metadata_t *arr = malloc(sizeof(file_metadata_t) * n);
-    if (!arr) return;
-    file_node_t *cur = library->head;
-    for (int i = 0; i < n && cur; ++i, cur = cur->next) arr[i] = cur->data;
-    qsort(arr, n, sizeof(file_metadata_t), cmp_size);
-    cur = library->head; int i = 0;
-    while (cur && i < n) { cur->data = arr[i++]; cur = cur->next; }
-    free(arr);
+    sort_hot_index(library, SORT_BY_SIZE);
 }
 
 /*
@@ -38,6 +38,16 @@ int save_encryption_library(encryption_library_t *library);
  */
 int add_file_to_library(encryption_library_t *library, const file_metadata_t *metadata);
 
+/*
+ * Append a batch of entries to the library in one pass, finding the end of
+ * the list once instead of once per entry
+ * library Pointer to the encryption library
+ * entries Array of file metadata to add, in order
+ * count Number of entries
+ * SUCCESS on success, or ERROR_MEMORY_ALLOCATION (nothing is added)
+ */
+int add_files_to_library(encryption_library_t *library, const file_metadata_t *entries, int count);
+
 /*
  * Remove a library entry at the specified index
  * library Pointer to the encryption library
@@ -60,6 +70,13 @@ void display_library_contents(encryption_library_t *library, sort_option_t sort_
  */
 void display_file_information(encryption_library_t *library, int index);
 
+/*
+ * Report entries that share an encrypted file through deduplication and
+ * the storage and encryption work that saved
+ * library Pointer to encryption library
+ */
+void display_dedup_savings(encryption_library_t *library);
+
 /*
  * Search the library for filenames containing a substring
  * library Pointer to encryption library
@@ -91,6 +108,62 @@ int rename_encrypted_file(encryption_library_t *library, int index, const char *
 /* Helper accessors for linked-list based library */
 int get_library_count(encryption_library_t *library);
 file_metadata_t *get_library_entry(encryption_library_t *library, int index);
+file_metadata_t *find_library_entry_by_encrypted_name(encryption_library_t *library,
+                                                      const char *encrypted_filename);
+file_metadata_t *find_library_entry_by_original_name(encryption_library_t *library,
+                                                     const char *original_filename);
+file_metadata_t *find_library_entry_by_content(encryption_library_t *library, long original_size,
+                                               const char *checksum, const char *key_fingerprint);
+
+/*
+ * Index of a library entry, for the index-based functions above
+ * library Pointer to the encryption library
+ * entry Entry returned by one of the lookups above
+ * Its 0-based index, or -1 if it is not in the library
+ */
+int get_library_index(encryption_library_t *library, const file_metadata_t *entry);
+
+/*
+ * Tell the library that an entry was changed through its pointer after a
+ * later lookup; its lookup and sort record is re-read from it
+ * library Pointer to the encryption library
+ * entry Entry that was changed
+ */
+void library_entry_updated(encryption_library_t *library, const file_metadata_t *entry);
+
+/*
+ * Re-read the lookup and sort records of every entry, after changing many
+ * entries through pointers taken from the list
+ * library Pointer to the encryption library
+ */
+void library_entries_updated(encryption_library_t *library);
+
+/*
+ * Path of an entry's encrypted file on disk: file_path for files in the
+ * fanned-out layout, encrypted_filename for entries from before it
+ * metadata Library entry
+ * Path to open (never NULL for a valid entry)
+ */
+const char *encrypted_file_location(const file_metadata_t *metadata);
+
+/*
+ * Count the entries whose encrypted file is at a location; deduplicated
+ * entries share one file, which may only be removed with the last of them.
+ * Packed entries are not counted (their packfile is shared by design).
+ * library Pointer to the encryption library
+ * location Path as returned by encrypted_file_location
+ * Number of entries using the file
+ */
+int count_location_references(encryption_library_t *library, const char *location);
+
+/*
+ * Record the name and location of a newly written encrypted file
+ * metadata Entry to update
+ * encrypted_filename Name the library shows and looks the entry up by
+ * file_path Where the file was written
+ */
+void set_encrypted_location(file_metadata_t *metadata, const char *encrypted_filename,
+                            const char *file_path);
 void free_library(encryption_library_t *library);
 
 /* ========================================================================
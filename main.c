@@ -6,7 +6,7 @@
  * This file contains the main function and core program initialization/cleanup logic.
  * $env:Path = 'C:\msys64\mingw64\bin;' + $env:Path
  * gcc --version
- * Compilation: gcc -o ccrypt main.c ui.c encryption.c library.c utils.c -lm
+ * Compilation: gcc -o ccrypt main.c ui.c encryption.c library.c sort.c utils.c platform.c checksum.c checksum_cache.c chunk_store.c sync.c batch.c pack.c verify.c buffer_pool.c stats.c trace.c metrics.c alloc.c -DCCRYPT_STATS -pthread -lm
  * Usage: ./ccrypt
  */
 
@@ -14,6 +14,17 @@
 #include "ui.h"
 #include "library.h"
 #include "utils.h"
+#include "encryption.h"
+#include "verify.h"
+#include "checksum_cache.h"
+#include "chunk_store.h"
+#include "sync.h"
+#include "batch.h"
+#include "pack.h"
+#include "buffer_pool.h"
+#include "stats.h"
+#include "trace.h"
+#include "metrics.h"
 
 /* ========================================================================
  * GLOBAL VARIABLES
@@ -38,6 +49,43 @@ int main(int argc, char *argv[])
     /* Local encryption library instance */
     encryption_library_t library;
 
+    /* --stats anywhere on the command line times every pipeline stage,
+       --trace <file> records each stage as an event and --metrics <file>
+       [--metrics-interval <seconds>] exports counters while running;
+       looked for first so the library load is timed too */
+    int metrics_interval = METRICS_DEFAULT_INTERVAL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+            metrics_interval = atoi(argv[i + 1]);
+        }
+        /* Large pipeline buffers on transparent huge pages, where supported */
+        if (strcmp(argv[i], "--huge-pages") == 0) buffer_pool_use_huge_pages(1);
+        /* Checksums remembered between runs (default CHECKSUM_CACHE_CAPACITY) */
+        if (strcmp(argv[i], "--checksum-cache") == 0 && i + 1 < argc) {
+            checksum_cache_set_capacity(atoi(argv[i + 1]));
+        }
+    }
+    for (int i = 1; i < argc; ++i) {
+        int wants_trace = strcmp(argv[i], "--trace") == 0 && i + 1 < argc;
+        int wants_metrics = strcmp(argv[i], "--metrics") == 0 && i + 1 < argc;
+        if (strcmp(argv[i], "--stats") == 0 || wants_trace || wants_metrics) {
+#ifdef CCRYPT_STATS
+            if (wants_trace) {
+                trace_start(argv[i + 1]);
+            } else if (wants_metrics) {
+                if (metrics_start(argv[i + 1], metrics_interval) != SUCCESS) {
+                    printf("Warning: could not start metrics export to '%s'\n", argv[i + 1]);
+                }
+            } else {
+                stats_enable();
+            }
+#else
+            (void)metrics_interval;
+            printf("Note: this build has no statistics (rebuild without STATS=0)\n");
+#endif
+        }
+    }
+
     /* Initialize program and load library */
     if (initialize_program(&library) != SUCCESS) {
         fprintf(stderr, "Error: Failed to initialize program\n");
@@ -54,6 +102,123 @@ int main(int argc, char *argv[])
             }
             return EXIT_SUCCESS;
         }
+        if (strcmp(argv[i], "--verify") == 0) {
+            /* Check every library file against its checksum and exit */
+            int verify_result = verify_library(&library, 0, NULL);
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (verify_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--scrub") == 0 && i + 1 < argc) {
+            /* Report which chunks of an encrypted file are damaged and exit */
+            int scrub_result = scrub_encrypted_file(argv[i + 1], NULL);
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (scrub_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--store") == 0 && i + 1 < argc) {
+            /* Encrypt into the deduplicated chunk store and add a library entry */
+            char password[MAX_PASSWORD_LENGTH];
+            char encrypted_filename[MAX_FILENAME_LENGTH];
+            char recipe_path[MAX_PATH_LENGTH];
+            file_metadata_t metadata;
+            int store_result = ERROR_INVALID_PASSWORD;
+            printf("Enter encryption password: ");
+            if (fgets(password, sizeof(password), stdin)) {
+                password[strcspn(password, "\r\n")] = 0;
+                store_result = generate_encrypted_filename(argv[i + 1], encrypted_filename,
+                                                           sizeof(encrypted_filename), 0);
+                if (store_result == SUCCESS &&
+                    find_library_entry_by_encrypted_name(&library, encrypted_filename)) {
+                    store_result = generate_encrypted_filename(argv[i + 1], encrypted_filename,
+                                                               sizeof(encrypted_filename),
+                                                               library.next_id);
+                }
+                if (store_result == SUCCESS) {
+                    store_result = generate_encrypted_path(library.next_id, recipe_path,
+                                                           sizeof(recipe_path));
+                }
+                if (store_result == SUCCESS) {
+                    store_result = encrypt_file_to_store(argv[i + 1], recipe_path, password, &metadata);
+                }
+                if (store_result == SUCCESS) {
+                    set_encrypted_location(&metadata, encrypted_filename, recipe_path);
+                    metadata.encryption_id = library.next_id;
+                    compute_key_fingerprint(password, metadata.key_fingerprint,
+                                            sizeof(metadata.key_fingerprint));
+                    store_result = add_file_to_library(&library, &metadata);
+                    if (store_result == SUCCESS) library.next_id++;
+                }
+            }
+            secure_memory_clear(password, sizeof(password));
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (store_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--sync") == 0 && i + 1 < argc) {
+            /* Encrypt new and changed files under a directory and exit */
+            char password[MAX_PASSWORD_LENGTH];
+            int sync_result = ERROR_INVALID_PASSWORD;
+            printf("Enter encryption password: ");
+            if (fgets(password, sizeof(password), stdin)) {
+                password[strcspn(password, "\r\n")] = 0;
+                sync_result = sync_directory(&library, argv[i + 1], password, NULL);
+            }
+            secure_memory_clear(password, sizeof(password));
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (sync_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            /* Encrypt every file under a directory in parallel and exit;
+               --pack anywhere on the command line stores small files in packfiles */
+            int use_packs = 0;
+            for (int j = 1; j < argc; ++j) {
+                if (strcmp(argv[j], "--pack") == 0) use_packs = 1;
+            }
+            char password[MAX_PASSWORD_LENGTH];
+            int batch_result = ERROR_INVALID_PASSWORD;
+            printf("Enter encryption password: ");
+            if (fgets(password, sizeof(password), stdin)) {
+                password[strcspn(password, "\r\n")] = 0;
+                batch_result = batch_encrypt_directory(&library, argv[i + 1], password, 0, use_packs,
+                                                       0, NULL);
+            }
+            secure_memory_clear(password, sizeof(password));
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (batch_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--repack") == 0) {
+            /* Rewrite every packfile holding deleted objects and exit */
+            int repack_result = repack_library(&library, 1, NULL);
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (repack_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--decrypt-range") == 0 && i + 4 < argc) {
+            /* --decrypt-range <file> <offset> <length> <output> */
+            char password[MAX_PASSWORD_LENGTH];
+            int range_result = ERROR_INVALID_PASSWORD;
+            printf("Enter decryption password: ");
+            if (fgets(password, sizeof(password), stdin)) {
+                password[strcspn(password, "\r\n")] = 0;
+                range_result = decrypt_file_range(argv[i + 1], argv[i + 4], password,
+                                                  strtol(argv[i + 2], NULL, 10),
+                                                  strtol(argv[i + 3], NULL, 10));
+            }
+            secure_memory_clear(password, sizeof(password));
+            if (cleanup_program(&library) != SUCCESS) {
+                fprintf(stderr, "Warning: Failed to properly cleanup program\n");
+            }
+            return (range_result == SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
     }
     
     /* Run main program loop */
@@ -90,6 +255,9 @@ int initialize_program(encryption_library_t *library)
         printf("Creating new encryption library\n");
         result = SUCCESS; /* New library is okay */
     }
+
+    /* A missing or damaged checksum cache just starts empty */
+    checksum_cache_load(CHECKSUM_CACHE_FILENAME);
     
     return result;
 }
@@ -107,10 +275,25 @@ int cleanup_program(encryption_library_t *library)
         printf("Saving encryption library...\n");
         result = save_encryption_library(library);
     }
-    /* free library nodes */
+    /* Keep checksums of unchanged files for the next run */
+    if (checksum_cache_save() != SUCCESS) {
+        printf("Warning: could not save checksum cache\n");
+    }
+    checksum_cache_free();
+#ifdef CCRYPT_STATS
+    stats_report();
+    trace_finish();
+    metrics_stop();
+#endif
+    /* free library nodes and the buffers kept for reuse */
     free_library(library);
+    buffer_pool_trim();
     /* Clear sensitive data from memory */
     secure_memory_clear(library, sizeof(encryption_library_t));
+#ifdef CCRYPT_ALLOC_TRACKING
+    /* Last, so whatever is still live has leaked */
+    alloc_report();
+#endif
     
     return result;
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+/*
+ * metrics.c
+ * Metrics textfile exporter for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file keeps the exported counters and histograms and writes them in
+ * the Prometheus text exposition format. Buckets are stored per bucket and
+ * only made cumulative when written, so an observation is one atomic
+ * addition to its bucket plus the count and sum.
+ */
+
+#include "ccrypt.h"
+#include "metrics.h"
+
+#ifdef CCRYPT_STATS
+
+#include <threads.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "utils.h"
+
+#define METRICS_BUCKETS 8   /* the last bucket is +Inf */
+
+/* Bucket upper bounds in nanoseconds, and as written in the le label */
+static const uint64_t bucket_bounds[METRICS_BUCKETS - 1] = {
+    10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL
+};
+static const char *bucket_labels[METRICS_BUCKETS] = {
+    "1e-05", "0.0001", "0.001", "0.01", "0.1", "1", "10", "+Inf"
+};
+
+static const char *error_names[METRICS_ERROR_CODES] = {
+    "SUCCESS", "ERROR_FILE_NOT_FOUND", "ERROR_INVALID_PATH", "ERROR_PERMISSION_DENIED",
+    "ERROR_INVALID_PASSWORD", "ERROR_MEMORY_ALLOCATION", "ERROR_LIBRARY_CORRUPT",
+    "ERROR_ENCRYPTION_FAILED", "ERROR_COMPRESSION_FAILED", "ERROR_RENAME_FAILED",
+    "ERROR_DELETE_FAILED", "ERROR_NEW_FILE_NAME", "ERROR_CONTAINER_CORRUPT",
+    "ERROR_CHECKSUM_MISMATCH"
+};
+
+static const char *operation_names[STATS_OPERATION_COUNT] = { "encrypt", "decrypt" };
+
+/* Counters */
+static atomic_ullong files_processed[STATS_OPERATION_COUNT];
+static atomic_ullong bytes_in[STATS_OPERATION_COUNT];
+static atomic_ullong bytes_out[STATS_OPERATION_COUNT];
+static atomic_ullong errors[METRICS_ERROR_CODES + 1];   /* the last counts unknown codes */
+static atomic_ullong stage_buckets[STATS_STAGE_COUNT][METRICS_BUCKETS];
+static atomic_ullong stage_count[STATS_STAGE_COUNT];
+static atomic_ullong stage_sum_ns[STATS_STAGE_COUNT];
+
+/* Exporter */
+static int exporting = 0;      /* set before any worker starts */
+static char metrics_path[MAX_PATH_LENGTH];
+static int metrics_interval;
+static thrd_t exporter;
+static mtx_t exporter_lock;
+static cnd_t exporter_wake;
+static int exporter_stopping;  /* guarded by exporter_lock */
+
+/* forward declarations for internal helpers */
+static int exporter_thread(void *arg);
+static int write_metrics(void);
+static void write_stage_histograms(FILE *fp);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Rewrite the file every interval until told to stop */
+static int exporter_thread(void *arg)
+{
+    (void)arg;
+    mtx_lock(&exporter_lock);
+    while (!exporter_stopping) {
+        struct timespec deadline;
+        timespec_get(&deadline, TIME_UTC);
+        deadline.tv_sec += metrics_interval;
+        while (!exporter_stopping &&
+               cnd_timedwait(&exporter_wake, &exporter_lock, &deadline) == thrd_success) {
+            /* woken early: loop until the deadline or a stop */
+        }
+        if (exporter_stopping) break;
+        mtx_unlock(&exporter_lock);
+        write_metrics();
+        mtx_lock(&exporter_lock);
+    }
+    mtx_unlock(&exporter_lock);
+    return 0;
+}
+
+/* Write every metric to a temporary file and move it into place, so the
+   collector never reads a half-written file */
+static int write_metrics(void)
+{
+    char temp_path[MAX_PATH_LENGTH + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", metrics_path);
+    FILE *fp = fopen(temp_path, "w");
+    if (!fp) return ERROR_PERMISSION_DENIED;
+
+    fprintf(fp, "# HELP ccrypt_files_processed_total Files encrypted or decrypted.\n"
+                "# TYPE ccrypt_files_processed_total counter\n");
+    for (int op = 0; op < STATS_OPERATION_COUNT; ++op) {
+        fprintf(fp, "ccrypt_files_processed_total{operation=\"%s\"} %llu\n", operation_names[op],
+                (unsigned long long)atomic_load(&files_processed[op]));
+    }
+    fprintf(fp, "# HELP ccrypt_bytes_in_total Bytes read by finished files.\n"
+                "# TYPE ccrypt_bytes_in_total counter\n");
+    for (int op = 0; op < STATS_OPERATION_COUNT; ++op) {
+        fprintf(fp, "ccrypt_bytes_in_total{operation=\"%s\"} %llu\n", operation_names[op],
+                (unsigned long long)atomic_load(&bytes_in[op]));
+    }
+    fprintf(fp, "# HELP ccrypt_bytes_out_total Bytes written by finished files.\n"
+                "# TYPE ccrypt_bytes_out_total counter\n");
+    for (int op = 0; op < STATS_OPERATION_COUNT; ++op) {
+        fprintf(fp, "ccrypt_bytes_out_total{operation=\"%s\"} %llu\n", operation_names[op],
+                (unsigned long long)atomic_load(&bytes_out[op]));
+    }
+
+    uint64_t plain = atomic_load(&bytes_in[STATS_OPERATION_ENCRYPT]);
+    uint64_t stored = atomic_load(&bytes_out[STATS_OPERATION_ENCRYPT]);
+    fprintf(fp, "# HELP ccrypt_compression_ratio Encrypted bytes written per plaintext byte read.\n"
+                "# TYPE ccrypt_compression_ratio gauge\n"
+                "ccrypt_compression_ratio %.6f\n", plain ? (double)stored / (double)plain : 0.0);
+
+    fprintf(fp, "# HELP ccrypt_errors_total Failed operations by error code.\n"
+                "# TYPE ccrypt_errors_total counter\n");
+    for (int i = 1; i <= METRICS_ERROR_CODES; ++i) {
+        unsigned long long count = atomic_load(&errors[i]);
+        if (count == 0) continue;
+        fprintf(fp, "ccrypt_errors_total{code=\"%s\"} %llu\n",
+                i < METRICS_ERROR_CODES ? error_names[i] : "UNKNOWN", count);
+    }
+
+    write_stage_histograms(fp);
+    fprintf(fp, "# HELP ccrypt_metrics_timestamp_seconds When this file was written.\n"
+                "# TYPE ccrypt_metrics_timestamp_seconds gauge\n"
+                "ccrypt_metrics_timestamp_seconds %lld\n", (long long)time(NULL));
+
+    if (fclose(fp) != 0) {
+        remove(temp_path);
+        return ERROR_PERMISSION_DENIED;
+    }
+    /* rename replaces in one step on POSIX; Windows needs the target gone */
+    if (rename(temp_path, metrics_path) != 0) {
+        remove(metrics_path);
+        if (rename(temp_path, metrics_path) != 0) {
+            remove(temp_path);
+            return ERROR_PERMISSION_DENIED;
+        }
+    }
+    return SUCCESS;
+}
+
+static void write_stage_histograms(FILE *fp)
+{
+    fprintf(fp, "# HELP ccrypt_stage_duration_seconds Time spent in each pipeline stage.\n"
+                "# TYPE ccrypt_stage_duration_seconds histogram\n");
+    for (int stage = 0; stage < STATS_STAGE_COUNT; ++stage) {
+        uint64_t count = atomic_load(&stage_count[stage]);
+        if (count == 0) continue;
+        /* Buckets are read one at a time while workers add to them, so the
+           cumulative values are capped at the count read above */
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRICS_BUCKETS; ++b) {
+            cumulative += atomic_load(&stage_buckets[stage][b]);
+            if (cumulative > count || b == METRICS_BUCKETS - 1) cumulative = count;
+            fprintf(fp, "ccrypt_stage_duration_seconds_bucket{stage=\"%s\",le=\"%s\"} %llu\n",
+                    stats_stage_name((stats_stage_t)stage), bucket_labels[b],
+                    (unsigned long long)cumulative);
+        }
+        fprintf(fp, "ccrypt_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n",
+                stats_stage_name((stats_stage_t)stage),
+                (double)atomic_load(&stage_sum_ns[stage]) / 1e9);
+        fprintf(fp, "ccrypt_stage_duration_seconds_count{stage=\"%s\"} %llu\n",
+                stats_stage_name((stats_stage_t)stage), (unsigned long long)count);
+    }
+}
+
+/* ========================================================================
+ * METRICS FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Start the exporter thread
+ * [Chu-Cheng Yu]
+ */
+int metrics_start(const char *output_path, int interval_seconds)
+{
+    if (exporting) return SUCCESS;
+    if (!output_path || strlen(output_path) >= sizeof(metrics_path)) return ERROR_INVALID_PATH;
+    safe_string_copy(metrics_path, output_path, sizeof(metrics_path));
+    metrics_interval = interval_seconds > 0 ? interval_seconds : METRICS_DEFAULT_INTERVAL;
+    exporter_stopping = 0;
+
+    if (mtx_init(&exporter_lock, mtx_plain) != thrd_success) return ERROR_MEMORY_ALLOCATION;
+    if (cnd_init(&exporter_wake) != thrd_success) {
+        mtx_destroy(&exporter_lock);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    exporting = 1;
+    if (thrd_create(&exporter, exporter_thread, NULL) != thrd_success) {
+        exporting = 0;
+        cnd_destroy(&exporter_wake);
+        mtx_destroy(&exporter_lock);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Whether metrics are being kept
+ * [Chu-Cheng Yu]
+ */
+int metrics_active(void)
+{
+    return exporting;
+}
+
+/*
+ * Add one stage duration to its latency histogram
+ * [Chu-Cheng Yu]
+ */
+void metrics_observe_stage(stats_stage_t stage, uint64_t nanoseconds)
+{
+    if (!exporting || stage < 0 || stage >= STATS_STAGE_COUNT) return;
+    int bucket = 0;
+    while (bucket < METRICS_BUCKETS - 1 && nanoseconds > bucket_bounds[bucket]) bucket++;
+    atomic_fetch_add_explicit(&stage_buckets[stage][bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stage_sum_ns[stage], nanoseconds, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stage_count[stage], 1, memory_order_relaxed);
+}
+
+/*
+ * Count a finished file
+ * [Chu-Cheng Yu]
+ */
+void metrics_count_file(stats_operation_t operation, uint64_t in, uint64_t out)
+{
+    if (!exporting || operation < 0 || operation >= STATS_OPERATION_COUNT) return;
+    atomic_fetch_add_explicit(&files_processed[operation], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_in[operation], in, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_out[operation], out, memory_order_relaxed);
+}
+
+/*
+ * Count a failed operation by its error code
+ * [Chu-Cheng Yu]
+ */
+void metrics_count_error(int error_code)
+{
+    if (!exporting) return;
+    int slot = -error_code;
+    if (slot <= 0 || slot >= METRICS_ERROR_CODES) slot = METRICS_ERROR_CODES;
+    atomic_fetch_add_explicit(&errors[slot], 1, memory_order_relaxed);
+}
+
+/*
+ * Stop the exporter thread and write the final values
+ * [Chu-Cheng Yu]
+ */
+int metrics_stop(void)
+{
+    if (!exporting) return SUCCESS;
+    mtx_lock(&exporter_lock);
+    exporter_stopping = 1;
+    cnd_signal(&exporter_wake);
+    mtx_unlock(&exporter_lock);
+    thrd_join(exporter, NULL);
+    cnd_destroy(&exporter_wake);
+    mtx_destroy(&exporter_lock);
+
+    int result = write_metrics();
+    exporting = 0;
+    if (result != SUCCESS) {
+        printf("Error: could not write metrics '%s'\n", metrics_path);
+    } else {
+        printf("Wrote metrics to %s\n", metrics_path);
+    }
+    return result;
+}
+
+#endif /* CCRYPT_STATS */
@@ -0,0 +1,74 @@
+/*
+ * metrics.h
+ * Header file for the metrics textfile exporter
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines --metrics, which keeps counters and stage latency
+ * histograms for long-running jobs and rewrites them every few seconds as
+ * a Prometheus textfile (for node_exporter's textfile collector). Updates
+ * are relaxed atomic additions; the file is written by a thread of its
+ * own. Like the statistics it is compiled only when CCRYPT_STATS is
+ * defined, and it is fed through the same STATS_ macros.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "ccrypt.h"
+#include "stats.h"
+
+#define METRICS_DEFAULT_INTERVAL 10   /* seconds between rewrites */
+#define METRICS_ERROR_CODES 14        /* SUCCESS down to ERROR_CHECKSUM_MISMATCH */
+
+#ifdef CCRYPT_STATS
+
+/* ========================================================================
+ * METRICS FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Start the exporter thread; call before any worker threads start
+ * output_path Path of the textfile (written via a temporary file and a rename)
+ * interval_seconds Seconds between rewrites (at least 1)
+ * SUCCESS on success, ERROR_INVALID_PATH for a bad path, or
+ * ERROR_MEMORY_ALLOCATION if the thread cannot be started
+ */
+int metrics_start(const char *output_path, int interval_seconds);
+
+/*
+ * Whether metrics are being kept
+ * Nonzero between metrics_start and metrics_stop
+ */
+int metrics_active(void);
+
+/*
+ * Add one stage duration to its latency histogram
+ * stage Stage that ran
+ * nanoseconds How long it took
+ */
+void metrics_observe_stage(stats_stage_t stage, uint64_t nanoseconds);
+
+/*
+ * Count a finished file
+ * operation STATS_OPERATION_ENCRYPT or STATS_OPERATION_DECRYPT
+ * bytes_in Bytes read
+ * bytes_out Bytes written
+ */
+void metrics_count_file(stats_operation_t operation, uint64_t bytes_in, uint64_t bytes_out);
+
+/*
+ * Count a failed operation by its error code
+ * error_code One of the ERROR_* codes
+ */
+void metrics_count_error(int error_code);
+
+/*
+ * Stop the exporter thread and write the final values
+ * SUCCESS on success (or when not exporting), ERROR_PERMISSION_DENIED if
+ * the file cannot be written
+ */
+int metrics_stop(void);
+
+#endif /* CCRYPT_STATS */
+
+#endif /* METRICS_H */
@@ -0,0 +1,500 @@
+/*
+ * pack.c
+ * Packfile storage of small encrypted files for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file appends the containers of small files to shared packfiles,
+ * reads them back with positioned reads, and rewrites packs to reclaim the
+ * space of deleted objects.
+ */
+
+#include "ccrypt.h"
+#include "pack.h"
+#include "encryption.h"
+#include "library.h"
+#include "checksum.h"
+#include "utils.h"
+#include "platform.h"
+
+/* forward declarations for internal helpers */
+static int start_new_pack(pack_writer_t *writer);
+static int decrypt_container_buffer(const unsigned char *object, size_t length,
+                                    const char *output_path, const char *password,
+                                    long *output_size);
+static int cmp_pack_location(const void *a, const void *b);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Close the current pack and create the next free one; caller holds the lock */
+static int start_new_pack(pack_writer_t *writer)
+{
+    if (writer->fp) {
+        int flushed = platform_flush_to_disk(writer->fp);
+        if (fclose(writer->fp) != 0 || flushed != SUCCESS) {
+            writer->fp = NULL;
+            return ERROR_PERMISSION_DENIED;
+        }
+        writer->fp = NULL;
+    }
+
+    /* Packs left behind by an interrupted run are never appended to */
+    char name[MAX_FILENAME_LENGTH];
+    for (int attempt = 0; attempt < 1000 && !writer->fp; ++attempt) {
+        pack_filename(writer->next_pack_id, name, sizeof(name));
+        writer->pack_id = writer->next_pack_id++;
+        writer->fp = fopen(name, "wx");
+    }
+    if (!writer->fp) return ERROR_PERMISSION_DENIED;
+
+    pack_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, PACK_SIGNATURE, sizeof(header.signature));
+    header.version = PACK_VERSION;
+    if (fwrite(&header, sizeof(header), 1, writer->fp) != 1) return ERROR_PERMISSION_DENIED;
+    writer->size = sizeof(header);
+    return SUCCESS;
+}
+
+/* Decrypt a complete container held in memory, verifying both checksums */
+static int decrypt_container_buffer(const unsigned char *object, size_t length,
+                                    const char *output_path, const char *password,
+                                    long *output_size)
+{
+    container_header_t header;
+    if (length < sizeof(header)) return ERROR_CONTAINER_CORRUPT;
+    memcpy(&header, object, sizeof(header));
+    if (memcmp(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature)) != 0 ||
+        header.version != CONTAINER_VERSION || header.chunk_size == 0 ||
+        header.chunk_size > MAX_CHUNK_SIZE) {
+        return ERROR_CONTAINER_CORRUPT;
+    }
+
+    unsigned char *output_data = malloc(header.chunk_size);
+    if (!output_data) return ERROR_MEMORY_ALLOCATION;
+    FILE *fout = fopen(output_path, "wb");
+    if (!fout) {
+        printf("Error: could not create output file.\n");
+        free(output_data);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    checksum_state_t plain_state;
+    checksum_state_t cipher_state;
+    checksum_init(&plain_state);
+    checksum_init(&cipher_state);
+
+    int result = SUCCESS;
+    size_t position = sizeof(header);
+    uint64_t total = 0;
+    while (total < header.original_size) {
+        chunk_header_t chunk;
+        if (length - position < sizeof(chunk)) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+        memcpy(&chunk, object + position, sizeof(chunk));
+        position += sizeof(chunk);
+        if (chunk.raw_size == 0 || chunk.raw_size > header.chunk_size ||
+            chunk.stored_size > chunk.raw_size ||
+            chunk.raw_size > header.original_size - total ||
+            chunk.stored_size > length - position) {
+            result = ERROR_CONTAINER_CORRUPT;
+            break;
+        }
+
+        const unsigned char *stored_data = object + position;
+        checksum_update(&cipher_state, stored_data, chunk.stored_size);
+        long n = 0;
+        result = decrypt_decompress_chunk(stored_data, (long)chunk.stored_size, password,
+                                          (long)total, output_data, (long)chunk.raw_size, &n);
+        if (result != SUCCESS) break;
+        checksum_update(&plain_state, output_data, (size_t)n);
+        if (fwrite(output_data, 1, (size_t)n, fout) != (size_t)n) {
+            result = ERROR_FILE_NOT_FOUND;
+            break;
+        }
+        position += chunk.stored_size;
+        total += (uint64_t)n;
+    }
+
+    free(output_data);
+    if (fclose(fout) != 0 && result == SUCCESS) result = ERROR_FILE_NOT_FOUND;
+
+    if (result == SUCCESS && (header.flags & CONTAINER_FLAG_CIPHER_CHECKSUM) &&
+        checksum_final(&cipher_state) != header.ciphertext_checksum) {
+        printf("Error: encrypted file has been modified or damaged.\n");
+        result = ERROR_CHECKSUM_MISMATCH;
+    } else if (result == SUCCESS && checksum_final(&plain_state) != header.plaintext_checksum) {
+        printf("Error: decrypted data does not match its checksum (wrong password?).\n");
+        result = ERROR_CHECKSUM_MISMATCH;
+    }
+    if (result != SUCCESS) {
+        remove(output_path);
+        return result;
+    }
+    *output_size = (long)total;
+    return SUCCESS;
+}
+
+/* Group packed entries by pack, in file order within each pack */
+static int cmp_pack_location(const void *a, const void *b)
+{
+    const file_metadata_t *x = *(const file_metadata_t *const *)a;
+    const file_metadata_t *y = *(const file_metadata_t *const *)b;
+    if (x->pack_id != y->pack_id) return x->pack_id < y->pack_id ? -1 : 1;
+    if (x->pack_offset != y->pack_offset) return x->pack_offset < y->pack_offset ? -1 : 1;
+    return 0;
+}
+
+/* ========================================================================
+ * PACK FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Build the filename of a packfile
+ * [Chu-Cheng Yu]
+ */
+void pack_filename(uint64_t pack_id, char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size == 0) return;
+    snprintf(buffer, buffer_size, PACK_FILENAME_FORMAT, (unsigned long long)pack_id);
+}
+
+/*
+ * Prepare a writer that starts a new pack after every pack in use
+ * [Chu-Cheng Yu]
+ */
+int pack_writer_open(pack_writer_t *writer, encryption_library_t *library)
+{
+    if (!writer || !library) return ERROR_INVALID_PATH;
+    memset(writer, 0, sizeof(*writer));
+    if (mtx_init(&writer->lock, mtx_plain) != thrd_success) return ERROR_MEMORY_ALLOCATION;
+
+    /* The pack is only created when the first object arrives */
+    writer->next_pack_id = 1;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if (cur->data.pack_id >= writer->next_pack_id) writer->next_pack_id = cur->data.pack_id + 1;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Append one container to the current pack
+ * [Chu-Cheng Yu]
+ */
+int pack_writer_append(pack_writer_t *writer, const unsigned char *object, size_t length,
+                       unsigned long encryption_id, uint64_t *pack_id, uint64_t *offset)
+{
+    if (!writer || !object || length == 0 || !pack_id || !offset) return ERROR_INVALID_PATH;
+
+    mtx_lock(&writer->lock);
+    int result = SUCCESS;
+    if (!writer->fp ||
+        (writer->size > sizeof(pack_header_t) &&
+         writer->size + sizeof(pack_record_t) + length > (uint64_t)PACK_TARGET_SIZE)) {
+        result = start_new_pack(writer);
+    }
+
+    if (result == SUCCESS) {
+        pack_record_t record;
+        record.length = length;
+        record.encryption_id = encryption_id;
+        if (fwrite(&record, sizeof(record), 1, writer->fp) != 1 ||
+            fwrite(object, 1, length, writer->fp) != length) {
+            result = ERROR_PERMISSION_DENIED;
+        } else {
+            *pack_id = writer->pack_id;
+            *offset = writer->size + sizeof(record);
+            writer->size += sizeof(record) + length;
+        }
+    }
+    mtx_unlock(&writer->lock);
+    return result;
+}
+
+/*
+ * Flush the current pack to disk and release the writer
+ * [Chu-Cheng Yu]
+ */
+int pack_writer_close(pack_writer_t *writer)
+{
+    if (!writer) return ERROR_INVALID_PATH;
+    int result = SUCCESS;
+    if (writer->fp) {
+        if (platform_flush_to_disk(writer->fp) != SUCCESS) result = ERROR_PERMISSION_DENIED;
+        if (fclose(writer->fp) != 0) result = ERROR_PERMISSION_DENIED;
+        writer->fp = NULL;
+    }
+    mtx_destroy(&writer->lock);
+    return result;
+}
+
+/*
+ * Encrypt a small file into an in-memory container
+ * [Chu-Cheng Yu]
+ */
+int pack_encrypt_object(const char *input_path, const char *password, int use_compression,
+                        unsigned char **object, size_t *length, file_metadata_t *metadata)
+{
+    if (!input_path || !password || !object || !length || !metadata) return ERROR_INVALID_PATH;
+    *object = NULL;
+
+    platform_file_id_t source_id;
+    if (platform_file_identity(input_path, &source_id) != SUCCESS) return ERROR_FILE_NOT_FOUND;
+    if (source_id.size == 0 || source_id.size > PACK_OBJECT_MAX_SIZE) return ERROR_INVALID_PATH;
+    size_t size = (size_t)source_id.size;
+
+    FILE *fin = fopen(input_path, "rb");
+    if (!fin) return ERROR_FILE_NOT_FOUND;
+    unsigned char *plain = malloc(size);
+    size_t capacity = sizeof(container_header_t) + sizeof(chunk_header_t) + size +
+                      sizeof(chunk_index_entry_t);
+    unsigned char *buffer = malloc(capacity);
+    if (!plain || !buffer) {
+        free(plain);
+        free(buffer);
+        fclose(fin);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    size_t got = fread(plain, 1, size, fin);
+    fclose(fin);
+    if (got != size) {
+        free(plain);
+        free(buffer);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    /* One chunk: header, chunk header, payload, one index entry */
+    unsigned char *stored = buffer + sizeof(container_header_t) + sizeof(chunk_header_t);
+    long stored_size = (long)size;
+    int result;
+    if (use_compression) {
+        result = compress_encrypt_chunk(plain, (long)size, password, 0, stored, &stored_size);
+    } else {
+        result = encrypt_data_at(plain, (long)size, password, 0, stored);
+    }
+    if (result != SUCCESS) {
+        free(plain);
+        free(buffer);
+        return result;
+    }
+
+    chunk_header_t chunk;
+    chunk.raw_size = (uint32_t)size;
+    chunk.stored_size = (uint32_t)stored_size;
+    memcpy(buffer + sizeof(container_header_t), &chunk, sizeof(chunk));
+
+    chunk_index_entry_t entry;
+    entry.offset = sizeof(container_header_t);
+    entry.raw_size = chunk.raw_size;
+    entry.stored_size = chunk.stored_size;
+    entry.hash = checksum_buffer(stored, (size_t)stored_size);
+    memcpy(stored + stored_size, &entry, sizeof(entry));
+
+    container_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature));
+    header.version = CONTAINER_VERSION;
+    header.flags = (use_compression ? CONTAINER_FLAG_COMPRESSED : 0) | CONTAINER_FLAG_CIPHER_CHECKSUM;
+    header.chunk_size = CHUNK_SIZE;
+    header.original_size = size;
+    header.payload_size = (uint64_t)stored_size;
+    header.plaintext_checksum = checksum_buffer(plain, size);
+    header.ciphertext_checksum = entry.hash;
+    header.index_offset = sizeof(header) + sizeof(chunk) + (uint64_t)stored_size;
+    header.chunk_count = 1;
+    merkle_root(&entry.hash, 1, &header.merkle_root);
+    memcpy(buffer, &header, sizeof(header));
+    free(plain);
+
+    *object = buffer;
+    *length = (size_t)header.index_offset + sizeof(entry);
+
+    memset(metadata, 0, sizeof(file_metadata_t));
+    safe_string_copy(metadata->original_filename, input_path, sizeof(metadata->original_filename));
+    metadata->is_compressed = use_compression;
+    metadata->original_size = (long)size;
+    metadata->encrypted_size = (long)*length;
+    metadata->encryption_method = (int)ENC_XOR;
+    metadata->source_mtime_ns = source_id.mtime_ns;
+    format_checksum(header.plaintext_checksum, metadata->checksum, sizeof(metadata->checksum));
+    return SUCCESS;
+}
+
+/*
+ * Read a packed container with one positioned read
+ * [Chu-Cheng Yu]
+ */
+int pack_read_object(const file_metadata_t *metadata, unsigned char **object)
+{
+    if (!metadata || !object || metadata->pack_id == 0 || metadata->pack_length == 0 ||
+        metadata->pack_length > MAX_CHUNK_SIZE) {
+        return ERROR_INVALID_PATH;
+    }
+    *object = NULL;
+
+    char name[MAX_FILENAME_LENGTH];
+    pack_filename(metadata->pack_id, name, sizeof(name));
+    FILE *fp = fopen(name, "rb");
+    if (!fp) return ERROR_FILE_NOT_FOUND;
+    unsigned char *buffer = malloc((size_t)metadata->pack_length);
+    if (!buffer) {
+        fclose(fp);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    int result = platform_read_at(fp, buffer, (size_t)metadata->pack_length, metadata->pack_offset);
+    fclose(fp);
+    if (result != SUCCESS) {
+        free(buffer);
+        return result;
+    }
+    *object = buffer;
+    return SUCCESS;
+}
+
+/*
+ * Decrypt a packed file into an output file
+ * [Chu-Cheng Yu]
+ */
+int decrypt_packed_file(const file_metadata_t *metadata, const char *output_path,
+                        const char *password, long *output_size)
+{
+    if (!metadata || !output_path || !password || !output_size) return ERROR_INVALID_PATH;
+    unsigned char *object = NULL;
+    int result = pack_read_object(metadata, &object);
+    if (result != SUCCESS) {
+        printf("Error: could not read packed object for %s\n", metadata->encrypted_filename);
+        return result;
+    }
+    result = decrypt_container_buffer(object, (size_t)metadata->pack_length, output_path,
+                                      password, output_size);
+    free(object);
+    return result;
+}
+
+/*
+ * Rewrite packs holding garbage and remove the old ones
+ * [Chu-Cheng Yu]
+ */
+int repack_library(encryption_library_t *library, int force, pack_gc_report_t *report)
+{
+    if (!library) return ERROR_INVALID_PATH;
+    pack_gc_report_t totals;
+    memset(&totals, 0, sizeof(totals));
+
+    int count = 0;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if (cur->data.pack_id != 0) count++;
+    }
+    if (count == 0) {
+        if (report) *report = totals;
+        return SUCCESS;
+    }
+
+    file_metadata_t **entries = (file_metadata_t **)malloc(sizeof(file_metadata_t *) * (size_t)count);
+    uint64_t *old_packs = (uint64_t *)malloc(sizeof(uint64_t) * (size_t)count);
+    if (!entries || !old_packs) {
+        free(entries);
+        free(old_packs);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    int n = 0;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if (cur->data.pack_id != 0) entries[n++] = &cur->data;
+    }
+    qsort(entries, (size_t)count, sizeof(file_metadata_t *), cmp_pack_location);
+
+    pack_writer_t writer;
+    int result = pack_writer_open(&writer, library);
+    int writer_open = result == SUCCESS;
+    int old_count = 0;
+    for (int start = 0; result == SUCCESS && start < count; ) {
+        uint64_t pack_id = entries[start]->pack_id;
+        int end = start;
+        while (end < count && entries[end]->pack_id == pack_id) end++;
+
+        /* Linked duplicates share an object, so live bytes count each offset once */
+        uint64_t live = 0;
+        for (int i = start; i < end; ++i) {
+            if (i == start || entries[i]->pack_offset != entries[i - 1]->pack_offset) {
+                live += sizeof(pack_record_t) + entries[i]->pack_length;
+            }
+        }
+        char name[MAX_FILENAME_LENGTH];
+        pack_filename(pack_id, name, sizeof(name));
+        platform_file_id_t id;
+        if (platform_file_identity(name, &id) != SUCCESS) {
+            printf("Warning: packfile %s is missing\n", name);
+            start = end;
+            continue;
+        }
+        uint64_t used = sizeof(pack_header_t) + live;
+        uint64_t garbage = id.size > used ? id.size - used : 0;
+        if (garbage == 0 || (!force && garbage * 100 < id.size * PACK_GC_PERCENT)) {
+            start = end;
+            continue;
+        }
+
+        /* Copy the live objects; entries move to the new pack as they go */
+        FILE *fp = fopen(name, "rb");
+        if (!fp) result = ERROR_FILE_NOT_FOUND;
+        for (int i = start; result == SUCCESS && i < end; ) {
+            uint64_t old_offset = entries[i]->pack_offset;
+            unsigned char *object = malloc((size_t)entries[i]->pack_length);
+            if (!object) {
+                result = ERROR_MEMORY_ALLOCATION;
+                break;
+            }
+            uint64_t new_pack = 0;
+            uint64_t new_offset = 0;
+            result = platform_read_at(fp, object, (size_t)entries[i]->pack_length, old_offset);
+            if (result == SUCCESS) {
+                result = pack_writer_append(&writer, object, (size_t)entries[i]->pack_length,
+                                            entries[i]->encryption_id, &new_pack, &new_offset);
+            }
+            free(object);
+            for (; result == SUCCESS && i < end && entries[i]->pack_offset == old_offset; ++i) {
+                entries[i]->pack_id = new_pack;
+                entries[i]->pack_offset = new_offset;
+                library->is_modified = 1;
+            }
+        }
+        if (fp) fclose(fp);
+        if (result == SUCCESS) {
+            old_packs[old_count++] = pack_id;
+            totals.packs_rewritten++;
+            totals.bytes_reclaimed += (long long)garbage;
+        }
+        start = end;
+    }
+    if (writer_open) {
+        int closed = pack_writer_close(&writer);
+        if (result == SUCCESS) result = closed;
+    }
+    library_entries_updated(library);
+
+    /* The library must point at the new packs before the old ones go */
+    if (result == SUCCESS && old_count > 0) {
+        result = save_encryption_library(library);
+    }
+    if (result == SUCCESS) {
+        for (int i = 0; i < old_count; ++i) {
+            char name[MAX_FILENAME_LENGTH];
+            pack_filename(old_packs[i], name, sizeof(name));
+            if (remove(name) == 0) totals.packs_removed++;
+        }
+        if (old_count > 0) {
+            printf("Repacked %d packfiles, reclaiming %lld bytes\n", totals.packs_rewritten,
+                   totals.bytes_reclaimed);
+        }
+    } else {
+        printf("Error: repacking failed (error %d); existing packfiles were kept\n", result);
+    }
+
+    free(entries);
+    free(old_packs);
+    if (report) *report = totals;
+    return result;
+}
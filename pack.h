@@ -0,0 +1,129 @@
+/*
+ * pack.h
+ * Header file for packfile storage of small encrypted files
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines packfiles, which hold the containers of many small
+ * files back to back so a batch of them costs a few large writes instead of
+ * one file each. The library records where each container lives; objects
+ * are read back with a single positioned read, and packs are rewritten to
+ * drop the objects of deleted entries.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <threads.h>
+
+#include "ccrypt.h"
+
+/*
+ * pack_writer
+ * The packfile currently being appended to; safe to share between threads
+ */
+typedef struct {
+    mtx_t lock;
+    FILE *fp;                /* NULL until the first object is appended */
+    uint64_t pack_id;
+    uint64_t size;           /* bytes written to the current pack */
+    uint64_t next_pack_id;
+} pack_writer_t;
+
+/*
+ * pack_gc_report
+ * Totals for a repack run
+ */
+typedef struct {
+    int packs_rewritten;
+    int packs_removed;
+    long long bytes_reclaimed;
+} pack_gc_report_t;
+
+/* ========================================================================
+ * PACK FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Build the filename of a packfile
+ * pack_id Pack id (at least 1)
+ * buffer Buffer to receive the filename
+ * buffer_size Size of the buffer
+ */
+void pack_filename(uint64_t pack_id, char *buffer, size_t buffer_size);
+
+/*
+ * Prepare a writer that starts a new pack after every pack in use
+ * writer Writer to initialise
+ * library Pointer to the encryption library (read for the pack ids in use)
+ * SUCCESS on success, or an error code on failure
+ */
+int pack_writer_open(pack_writer_t *writer, encryption_library_t *library);
+
+/*
+ * Append one container to the current pack, starting a new pack once the
+ * current one passes PACK_TARGET_SIZE
+ * writer Open pack writer
+ * object Complete container bytes
+ * length Container length
+ * encryption_id Library id the object is written for
+ * pack_id Out parameter to receive the pack the object went to
+ * offset Out parameter to receive the object's offset in that pack
+ * SUCCESS on success, or an error code on failure
+ */
+int pack_writer_append(pack_writer_t *writer, const unsigned char *object, size_t length,
+                       unsigned long encryption_id, uint64_t *pack_id, uint64_t *offset);
+
+/*
+ * Flush the current pack to disk and release the writer
+ * writer Writer to close
+ * SUCCESS on success, ERROR_PERMISSION_DENIED if the pack could not be written
+ */
+int pack_writer_close(pack_writer_t *writer);
+
+/*
+ * Encrypt a small file into an in-memory container, the same bytes
+ * encrypt_file would write for it
+ * input_path Path to the file (at most PACK_OBJECT_MAX_SIZE bytes)
+ * password Encryption password
+ * use_compression 1 to compress before encryption, 0 otherwise
+ * object Out parameter to receive the malloc'd container
+ * length Out parameter to receive the container length
+ * metadata Pointer to metadata structure to populate (pack fields are left 0)
+ * SUCCESS on success, ERROR_INVALID_PATH if the file is empty or too large,
+ * or another error code on failure
+ */
+int pack_encrypt_object(const char *input_path, const char *password, int use_compression,
+                        unsigned char **object, size_t *length, file_metadata_t *metadata);
+
+/*
+ * Read a packed container with one positioned read
+ * metadata Library entry of a packed file
+ * object Out parameter to receive the malloc'd container of pack_length bytes
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND if the pack is missing or short
+ */
+int pack_read_object(const file_metadata_t *metadata, unsigned char **object);
+
+/*
+ * Decrypt a packed file into an output file
+ * metadata Library entry of a packed file
+ * output_path Path where the decrypted output should be written
+ * password Password used for decryption
+ * output_size Out parameter to receive the bytes written
+ * SUCCESS on success, or an error code on failure (output is removed)
+ */
+int decrypt_packed_file(const file_metadata_t *metadata, const char *output_path,
+                        const char *password, long *output_size);
+
+/*
+ * Reclaim the space of deleted objects: packs where at least
+ * PACK_GC_PERCENT of the bytes are garbage (any garbage when forced) have
+ * their live objects copied into a new pack, the library is saved, and
+ * only then are the old packs and packs nothing refers to removed
+ * library Pointer to the encryption library
+ * force 1 to rewrite every pack holding garbage
+ * report Optional pointer to receive the totals
+ * SUCCESS on success, or an error code on failure (old packs are kept)
+ */
+int repack_library(encryption_library_t *library, int force, pack_gc_report_t *report);
+
+#endif /* PACK_H */
@@ -0,0 +1,361 @@
+/*
+ * platform.c
+ * Operating system specific helpers for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file isolates the POSIX and Windows calls CCrypt uses; everything
+ * else in the program sticks to the standard C library.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifdef __linux__
+#define _DEFAULT_SOURCE   /* MADV_HUGEPAGE */
+#endif
+
+#include "ccrypt.h"
+#include "platform.h"
+
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <errno.h>
+#endif
+
+/* ========================================================================
+ * PLATFORM FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Flush a stream and ask the operating system to commit it to disk
+ * [Chu-Cheng Yu]
+ */
+int platform_flush_to_disk(FILE *fp)
+{
+    if (!fp) return ERROR_INVALID_PATH;
+    if (fflush(fp) != 0) return ERROR_PERMISSION_DENIED;
+#ifdef _WIN32
+    if (_commit(_fileno(fp)) != 0) return ERROR_PERMISSION_DENIED;
+#else
+    if (fsync(fileno(fp)) != 0) return ERROR_PERMISSION_DENIED;
+#endif
+    return SUCCESS;
+}
+
+/*
+ * Truncate a file to the given length
+ * [Chu-Cheng Yu]
+ */
+int platform_truncate_file(const char *file_path, long size)
+{
+    if (!file_path || size < 0) return ERROR_INVALID_PATH;
+#ifdef _WIN32
+    int fd = _open(file_path, _O_RDWR | _O_BINARY);
+    if (fd < 0) return ERROR_PERMISSION_DENIED;
+    int rc = _chsize_s(fd, size);
+    _close(fd);
+    if (rc != 0) return ERROR_PERMISSION_DENIED;
+#else
+    if (truncate(file_path, (off_t)size) != 0) return ERROR_PERMISSION_DENIED;
+#endif
+    return SUCCESS;
+}
+
+/*
+ * Read bytes at an absolute file offset without moving the stream position
+ * [Chu-Cheng Yu]
+ */
+int platform_read_at(FILE *fp, void *buffer, size_t size, uint64_t offset)
+{
+    if (!fp || (!buffer && size > 0)) return ERROR_INVALID_PATH;
+    unsigned char *out = (unsigned char *)buffer;
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(fp));
+    if (handle == INVALID_HANDLE_VALUE) return ERROR_FILE_NOT_FOUND;
+    while (size > 0) {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFFu);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD want = size > 0x40000000u ? 0x40000000u : (DWORD)size;
+        DWORD got = 0;
+        if (!ReadFile(handle, out, want, &got, &overlapped) || got == 0) return ERROR_FILE_NOT_FOUND;
+        out += got;
+        size -= got;
+        offset += got;
+    }
+#else
+    int fd = fileno(fp);
+    while (size > 0) {
+        ssize_t got = pread(fd, out, size, (off_t)offset);
+        if (got <= 0) return ERROR_FILE_NOT_FOUND;
+        out += got;
+        size -= (size_t)got;
+        offset += (uint64_t)got;
+    }
+#endif
+    return SUCCESS;
+}
+
+/*
+ * Move a stream to a 64-bit file offset
+ * [Chu-Cheng Yu]
+ */
+int platform_seek(FILE *fp, uint64_t offset)
+{
+    if (!fp || offset > (uint64_t)INT64_MAX) return ERROR_INVALID_PATH;
+#ifdef _WIN32
+    if (_fseeki64(fp, (__int64)offset, SEEK_SET) != 0) return ERROR_FILE_NOT_FOUND;
+#else
+    if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) return ERROR_FILE_NOT_FOUND;
+#endif
+    return SUCCESS;
+}
+
+/*
+ * Size of an open file, buffered writes included
+ * [Chu-Cheng Yu]
+ */
+int platform_stream_size(FILE *fp, uint64_t *size)
+{
+    if (!fp || !size) return ERROR_INVALID_PATH;
+    if (fflush(fp) != 0) return ERROR_FILE_NOT_FOUND;
+#ifdef _WIN32
+    struct _stati64 st;
+    if (_fstati64(_fileno(fp), &st) != 0) return ERROR_FILE_NOT_FOUND;
+#else
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0) return ERROR_FILE_NOT_FOUND;
+#endif
+    *size = (uint64_t)st.st_size;
+    return SUCCESS;
+}
+
+/*
+ * Read a monotonic clock for measuring elapsed time
+ * [Chu-Cheng Yu]
+ */
+double platform_monotonic_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/*
+ * Read a monotonic clock in whole nanoseconds
+ * [Chu-Cheng Yu]
+ */
+uint64_t platform_monotonic_nanoseconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    uint64_t ticks = (uint64_t)counter.QuadPart;
+    uint64_t hz = (uint64_t)frequency.QuadPart;
+    return ticks / hz * 1000000000ULL + ticks % hz * 1000000000ULL / hz;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*
+ * Largest resident memory the process has used so far
+ * [Chu-Cheng Yu]
+ */
+uint64_t platform_peak_memory(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (uint64_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;           /* bytes on macOS */
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;    /* kilobytes elsewhere */
+#endif
+#endif
+}
+
+/*
+ * Number of online processors, for sizing worker pools
+ * [Chu-Cheng Yu]
+ */
+int platform_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/*
+ * Read the device, inode, size and modification time of a file
+ * [Chu-Cheng Yu]
+ */
+int platform_file_identity(const char *file_path, platform_file_id_t *id)
+{
+    if (!file_path || !id) return ERROR_INVALID_PATH;
+#ifdef _WIN32
+    HANDLE h = CreateFileA(file_path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return ERROR_FILE_NOT_FOUND;
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return ERROR_FILE_NOT_FOUND;
+    id->device = info.dwVolumeSerialNumber;
+    id->inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    id->size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    /* FILETIME counts 100 ns intervals */
+    id->mtime_ns = (((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) |
+                    info.ftLastWriteTime.dwLowDateTime) * 100;
+#else
+    struct stat st;
+    if (stat(file_path, &st) != 0) return ERROR_FILE_NOT_FOUND;
+    id->device = (uint64_t)st.st_dev;
+    id->inode = (uint64_t)st.st_ino;
+    id->size = (uint64_t)st.st_size;
+    id->mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    return SUCCESS;
+}
+
+/*
+ * List the entries of a directory, skipping "." and ".."
+ * [Chu-Cheng Yu]
+ */
+int platform_list_directory(const char *directory_path, platform_dir_callback_t callback,
+                            void *context)
+{
+    if (!directory_path || !callback) return ERROR_INVALID_PATH;
+    char path[MAX_PATH_LENGTH];
+    int result = SUCCESS;
+#ifdef _WIN32
+    char pattern[MAX_PATH_LENGTH];
+    snprintf(pattern, sizeof(pattern), "%s\\*", directory_path);
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA(pattern, &found);
+    if (h == INVALID_HANDLE_VALUE) return ERROR_FILE_NOT_FOUND;
+    do {
+        if (strcmp(found.cFileName, ".") == 0 || strcmp(found.cFileName, "..") == 0) continue;
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) continue;
+        if (snprintf(path, sizeof(path), "%s\\%s", directory_path, found.cFileName) >= (int)sizeof(path)) continue;
+        result = callback(path, (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0, context);
+    } while (result == SUCCESS && FindNextFileA(h, &found));
+    FindClose(h);
+#else
+    DIR *dir = opendir(directory_path);
+    if (!dir) return ERROR_FILE_NOT_FOUND;
+    struct dirent *entry;
+    while (result == SUCCESS && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (snprintf(path, sizeof(path), "%s/%s", directory_path, entry->d_name) >= (int)sizeof(path)) continue;
+        struct stat st;
+        if (lstat(path, &st) != 0) continue;
+        /* Symlinks are neither followed nor encrypted, so a link cannot
+           lead a tree walk in circles */
+        if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) continue;
+        result = callback(path, S_ISDIR(st.st_mode), context);
+    }
+    closedir(dir);
+#endif
+    return result;
+}
+
+/*
+ * Create a directory unless it already exists
+ * [Chu-Cheng Yu]
+ */
+int platform_make_directory(const char *directory_path)
+{
+    if (!directory_path) return ERROR_INVALID_PATH;
+#ifdef _WIN32
+    if (_mkdir(directory_path) == 0 || errno == EEXIST) return SUCCESS;
+#else
+    if (mkdir(directory_path, 0777) == 0 || errno == EEXIST) return SUCCESS;
+#endif
+    return ERROR_PERMISSION_DENIED;
+}
+
+/*
+ * Change the working directory of the process
+ * [Chu-Cheng Yu]
+ */
+int platform_change_directory(const char *directory_path)
+{
+    if (!directory_path) return ERROR_INVALID_PATH;
+#ifdef _WIN32
+    return _chdir(directory_path) == 0 ? SUCCESS : ERROR_FILE_NOT_FOUND;
+#else
+    return chdir(directory_path) == 0 ? SUCCESS : ERROR_FILE_NOT_FOUND;
+#endif
+}
+
+/*
+ * Ask for transparent huge pages behind a buffer
+ * [Chu-Cheng Yu]
+ */
+void platform_advise_huge_pages(void *buffer, size_t size)
+{
+#if defined(MADV_HUGEPAGE)
+    /* madvise wants page-aligned ranges; only whole huge pages benefit */
+    const uintptr_t huge = 2 * 1024 * 1024;
+    uintptr_t start = ((uintptr_t)buffer + huge - 1) & ~(huge - 1);
+    uintptr_t end = ((uintptr_t)buffer + size) & ~(huge - 1);
+    if (end > start) madvise((void *)start, (size_t)(end - start), MADV_HUGEPAGE);
+#else
+    (void)buffer;
+    (void)size;
+#endif
+}
+
+/*
+ * Read the processor's cycle counter, where there is one to read
+ * [Chu-Cheng Yu]
+ */
+uint64_t platform_cycle_counter(void)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,156 @@
+/*
+ * platform.h
+ * Header file for operating system specific helpers
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header wraps the few facilities CCrypt needs beyond standard C
+ * (durable flushes, truncation, clocks, processor count) behind one
+ * interface so the rest of the program stays portable.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "ccrypt.h"
+
+/*
+ * platform_file_id
+ * What identifies one version of a file on disk: if none of these change,
+ * neither has the content (barring deliberate timestamp forgery)
+ */
+typedef struct {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t mtime_ns;       /* modification time in nanoseconds */
+} platform_file_id_t;
+
+/*
+ * Called once per directory entry by platform_list_directory
+ * path Path of the entry (directory path joined with its name)
+ * is_directory Nonzero for subdirectories
+ * context Caller data passed through unchanged
+ * SUCCESS to continue, anything else to stop listing and return it
+ */
+typedef int (*platform_dir_callback_t)(const char *path, int is_directory, void *context);
+
+/* ========================================================================
+ * PLATFORM FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Flush a stream and ask the operating system to commit it to disk
+ * fp Open stream to flush
+ * SUCCESS on success, ERROR_PERMISSION_DENIED on failure
+ */
+int platform_flush_to_disk(FILE *fp);
+
+/*
+ * Truncate a file to the given length
+ * file_path Path to the file
+ * size New file length in bytes
+ * SUCCESS on success, ERROR_PERMISSION_DENIED on failure
+ */
+int platform_truncate_file(const char *file_path, long size);
+
+/*
+ * Read bytes at an absolute file offset without moving the stream position,
+ * so several threads can read one open file at once
+ * fp Open stream to read from
+ * buffer Destination buffer
+ * size Bytes to read
+ * offset File offset of the first byte
+ * SUCCESS if all size bytes were read, ERROR_FILE_NOT_FOUND otherwise
+ */
+int platform_read_at(FILE *fp, void *buffer, size_t size, uint64_t offset);
+
+/*
+ * Move a stream to an absolute file offset; unlike fseek the offset is not
+ * limited to a long, which is 32 bits on Windows
+ * fp Open stream to position
+ * offset File offset to move to
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND on failure
+ */
+int platform_seek(FILE *fp, uint64_t offset);
+
+/*
+ * Size of an open file, including bytes still buffered in the stream
+ * fp Open stream
+ * size Out parameter to receive the size in bytes
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND on failure
+ */
+int platform_stream_size(FILE *fp, uint64_t *size);
+
+/*
+ * Read a monotonic clock for measuring elapsed time
+ * Seconds since an arbitrary fixed point
+ */
+double platform_monotonic_seconds(void);
+
+/*
+ * Read a monotonic clock in whole nanoseconds, for timing short stages
+ * Nanoseconds since an arbitrary fixed point
+ */
+uint64_t platform_monotonic_nanoseconds(void);
+
+/*
+ * Largest resident memory the process has used so far
+ * Peak resident set size in bytes, or 0 where it cannot be read
+ */
+uint64_t platform_peak_memory(void);
+
+/*
+ * Number of online processors, for sizing worker pools
+ * Processor count (at least 1)
+ */
+int platform_cpu_count(void);
+
+/*
+ * Read the device, inode, size and modification time of a file
+ * file_path Path to the file
+ * id Out parameter to receive the identity
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND if the file cannot be examined
+ */
+int platform_file_identity(const char *file_path, platform_file_id_t *id);
+
+/*
+ * List the entries of a directory, skipping "." and ".."
+ * directory_path Path of the directory
+ * callback Function called for each entry
+ * context Passed to callback
+ * SUCCESS after every entry, ERROR_FILE_NOT_FOUND if the directory cannot
+ * be opened, or the first non-SUCCESS value returned by callback
+ */
+int platform_list_directory(const char *directory_path, platform_dir_callback_t callback,
+                            void *context);
+
+/*
+ * Create a directory unless it already exists (the parent must exist)
+ * directory_path Path of the directory
+ * SUCCESS if the directory exists afterwards, ERROR_PERMISSION_DENIED otherwise
+ */
+int platform_make_directory(const char *directory_path);
+
+/*
+ * Change the working directory of the process
+ * directory_path Path of the new working directory
+ * SUCCESS on success, ERROR_FILE_NOT_FOUND if it cannot be entered
+ */
+int platform_change_directory(const char *directory_path);
+
+/*
+ * Ask for transparent huge pages behind the whole huge pages inside a
+ * buffer; a hint only, ignored where unsupported
+ * buffer Start of the buffer
+ * size Size of the buffer in bytes
+ */
+void platform_advise_huge_pages(void *buffer, size_t size);
+
+/*
+ * Read the processor's cycle counter (the time-stamp counter on x86),
+ * for reporting cycles per byte in benchmarks
+ * Counter value, or 0 on processors without one
+ */
+uint64_t platform_cycle_counter(void);
+
+#endif /* PLATFORM_H */
@@ -0,0 +1,207 @@
+/*
+ * sort.c
+ * Sort engine for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file implements the sort engine. The radix sort makes one pass to
+ * count all eight byte digits of every key, then one scatter pass per
+ * digit, skipping digits that are the same in every key (the high bytes
+ * of sizes and ids usually are). Strings whose 8-byte prefixes tie are
+ * finished with a three-way radix quicksort on the bytes after the prefix.
+ */
+
+#include "ccrypt.h"
+#include "sort.h"
+
+#define SORT_KEY_BYTES 8
+
+/* forward declarations for internal helpers */
+static void insertion_sort(sort_pair_t *pairs, size_t count);
+static void radix_sort(sort_pair_t *pairs, size_t count, sort_pair_t *scratch);
+static int byte_at(const char *const *strings, const sort_pair_t *pair, size_t depth,
+                   size_t max_length);
+static void string_insertion_sort(sort_pair_t *pairs, size_t count, const char *const *strings,
+                                  size_t depth, size_t max_length);
+static void multikey_quicksort(sort_pair_t *pairs, size_t count, const char *const *strings,
+                               size_t depth, size_t max_length);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Stable sort for short runs */
+static void insertion_sort(sort_pair_t *pairs, size_t count)
+{
+    for (size_t i = 1; i < count; ++i) {
+        sort_pair_t pair = pairs[i];
+        size_t j = i;
+        while (j > 0 && pairs[j - 1].key > pair.key) {
+            pairs[j] = pairs[j - 1];
+            j--;
+        }
+        pairs[j] = pair;
+    }
+}
+
+/* LSD radix sort, one byte per pass; scratch holds count pairs */
+static void radix_sort(sort_pair_t *pairs, size_t count, sort_pair_t *scratch)
+{
+    size_t counts[SORT_KEY_BYTES][256] = {{0}};
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t key = pairs[i].key;
+        for (int digit = 0; digit < SORT_KEY_BYTES; ++digit) {
+            counts[digit][(key >> (8 * digit)) & 0xFF]++;
+        }
+    }
+
+    sort_pair_t *from = pairs;
+    sort_pair_t *to = scratch;
+    for (int digit = 0; digit < SORT_KEY_BYTES; ++digit) {
+        int shift = 8 * digit;
+        size_t *bucket = counts[digit];
+        if (bucket[(from[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            size_t n = bucket[b];
+            bucket[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            to[bucket[(from[i].key >> shift) & 0xFF]++] = from[i];
+        }
+        sort_pair_t *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != pairs) memcpy(pairs, from, count * sizeof(sort_pair_t));
+}
+
+/* Byte of a pair's string at depth, 0 past its end */
+static int byte_at(const char *const *strings, const sort_pair_t *pair, size_t depth,
+                   size_t max_length)
+{
+    return depth < max_length ? (unsigned char)strings[pair->index][depth] : 0;
+}
+
+/* Sort a short run whose strings agree on their first depth bytes */
+static void string_insertion_sort(sort_pair_t *pairs, size_t count, const char *const *strings,
+                                  size_t depth, size_t max_length)
+{
+    for (size_t i = 1; i < count; ++i) {
+        sort_pair_t pair = pairs[i];
+        const char *text = strings[pair.index] + depth;
+        size_t j = i;
+        while (j > 0 && strncmp(strings[pairs[j - 1].index] + depth, text,
+                                max_length - depth) > 0) {
+            pairs[j] = pairs[j - 1];
+            j--;
+        }
+        pairs[j] = pair;
+    }
+}
+
+/* Bentley-Sedgewick three-way radix quicksort; the strings agree on
+   their first depth bytes, none of which is the terminator */
+static void multikey_quicksort(sort_pair_t *pairs, size_t count, const char *const *strings,
+                               size_t depth, size_t max_length)
+{
+    while (count > 1 && depth < max_length) {
+        if (count < SORT_SMALL) {
+            string_insertion_sort(pairs, count, strings, depth, max_length);
+            return;
+        }
+        int pivot = byte_at(strings, &pairs[count / 2], depth, max_length);
+        size_t less = 0, i = 0, greater = count;
+        while (i < greater) {
+            int c = byte_at(strings, &pairs[i], depth, max_length);
+            if (c < pivot) {
+                sort_pair_t swap = pairs[less];
+                pairs[less++] = pairs[i];
+                pairs[i++] = swap;
+            } else if (c > pivot) {
+                sort_pair_t swap = pairs[--greater];
+                pairs[greater] = pairs[i];
+                pairs[i] = swap;
+            } else {
+                i++;
+            }
+        }
+        multikey_quicksort(pairs, less, strings, depth, max_length);
+        multikey_quicksort(pairs + greater, count - greater, strings, depth, max_length);
+        if (pivot == 0) return;   /* the middle run ended here: all equal */
+        pairs += less;
+        count = greater - less;
+        depth++;
+    }
+}
+
+/* ========================================================================
+ * SORT ENGINE FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Key of a signed number
+ * [Chu-Cheng Yu]
+ */
+uint64_t sort_signed_key(long long value)
+{
+    return (uint64_t)value ^ ((uint64_t)1 << 63);
+}
+
+/*
+ * Key of a string's 8-byte prefix
+ * [Chu-Cheng Yu]
+ */
+uint64_t sort_string_key(const char *text)
+{
+    uint64_t key = 0;
+    int ended = 0;
+    for (int i = 0; i < SORT_KEY_BYTES; ++i) {
+        unsigned char c = ended ? 0 : (unsigned char)text[i];
+        ended = c == 0;
+        key = (key << 8) | c;
+    }
+    return key;
+}
+
+/*
+ * Sort pairs by ascending key
+ * [Chu-Cheng Yu]
+ */
+int sort_pairs(sort_pair_t *pairs, size_t count)
+{
+    if (!pairs || count < 2) return SUCCESS;
+    if (count < SORT_SMALL) {
+        insertion_sort(pairs, count);
+        return SUCCESS;
+    }
+    sort_pair_t *scratch = (sort_pair_t *)malloc(count * sizeof(sort_pair_t));
+    if (!scratch) return ERROR_MEMORY_ALLOCATION;
+    radix_sort(pairs, count, scratch);
+    free(scratch);
+    return SUCCESS;
+}
+
+/*
+ * Sort pairs by the strings they index
+ * [Chu-Cheng Yu]
+ */
+int sort_pairs_by_string(sort_pair_t *pairs, size_t count, const char *const *strings,
+                         size_t max_length)
+{
+    if (!pairs || !strings) return SUCCESS;
+    int result = sort_pairs(pairs, count);
+    if (result != SUCCESS) return result;
+
+    /* A prefix that ends in a nonzero byte may continue past it */
+    for (size_t start = 0; start < count; ) {
+        size_t end = start + 1;
+        while (end < count && pairs[end].key == pairs[start].key) end++;
+        if (end - start > 1 && (pairs[start].key & 0xFF) != 0) {
+            multikey_quicksort(pairs + start, end - start, strings, SORT_KEY_BYTES, max_length);
+        }
+        start = end;
+    }
+    return SUCCESS;
+}
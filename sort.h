@@ -0,0 +1,69 @@
+/*
+ * sort.h
+ * Header file for the sort engine
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the sort engine behind the library views. It sorts
+ * compact (key, index) pairs instead of whole entries: numbers with an
+ * LSD radix sort on their 64-bit key, and strings with the same radix sort
+ * on an 8-byte prefix followed by a multikey quicksort of the entries
+ * whose prefixes tie. The number sort is stable and runs in time linear
+ * in the number of pairs; equal strings may come out in any order.
+ */
+
+#ifndef SORT_H
+#define SORT_H
+
+#include "ccrypt.h"
+
+#define SORT_SMALL 32   /* below this many pairs an insertion sort is used */
+
+/*
+ * sort_pair
+ * One element to sort: its key and the position it came from
+ */
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} sort_pair_t;
+
+/* ========================================================================
+ * SORT ENGINE FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Key of a signed number; ascending keys order the numbers ascending
+ * value Number to encode
+ * The key (complement it for descending order)
+ */
+uint64_t sort_signed_key(long long value);
+
+/*
+ * Key of a string: its first 8 bytes, big-endian, zero past the end, so
+ * key order matches strcmp order as far as the prefix goes
+ * text String to encode
+ * The key
+ */
+uint64_t sort_string_key(const char *text);
+
+/*
+ * Sort pairs by ascending key
+ * pairs Pairs to sort in place
+ * count Number of pairs
+ * SUCCESS, or ERROR_MEMORY_ALLOCATION if no scratch space was available
+ */
+int sort_pairs(sort_pair_t *pairs, size_t count);
+
+/*
+ * Sort pairs by the strings they index, in strncmp order; each key must
+ * be sort_string_key of its string
+ * pairs Pairs to sort in place
+ * count Number of pairs
+ * strings String of each index, at most max_length bytes
+ * max_length Bytes compared at most, as for strncmp
+ * SUCCESS, or ERROR_MEMORY_ALLOCATION if no scratch space was available
+ */
+int sort_pairs_by_string(sort_pair_t *pairs, size_t count, const char *const *strings,
+                         size_t max_length);
+
+#endif /* SORT_H */
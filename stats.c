@@ -0,0 +1,186 @@
+/*
+ * stats.c
+ * Pipeline statistics for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file accumulates the stage times recorded through the STATS_ macros
+ * and prints them per file and per run. Nothing here is compiled unless
+ * CCRYPT_STATS is defined.
+ */
+
+#include "ccrypt.h"
+#include "stats.h"
+
+#ifdef CCRYPT_STATS
+
+#include "platform.h"
+#include "trace.h"
+#include "metrics.h"
+
+static const char *stage_names[STATS_STAGE_COUNT] = {
+    "read", "compress+encrypt", "encrypt", "decrypt", "checksum", "write",
+    "library save", "library load"
+};
+
+/* Set once before any worker starts, so plain reads are safe afterwards */
+static int stats_active = 0;
+
+/* forward declarations for internal helpers */
+static int collecting(void);
+
+/* Run totals */
+static atomic_ullong run_calls[STATS_STAGE_COUNT];
+static atomic_ullong run_nanoseconds[STATS_STAGE_COUNT];
+static atomic_ullong run_bytes[STATS_STAGE_COUNT];
+static atomic_ullong run_files;
+static atomic_ullong run_allocations;
+static atomic_ullong run_allocated_bytes;
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Whether anything consumes stage times: --stats, --trace or --metrics */
+static int collecting(void)
+{
+    return stats_active || trace_active() || metrics_active();
+}
+
+/* ========================================================================
+ * STATS FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Name of a stage
+ * [Chu-Cheng Yu]
+ */
+const char *stats_stage_name(stats_stage_t stage)
+{
+    return (stage >= 0 && stage < STATS_STAGE_COUNT) ? stage_names[stage] : "unknown";
+}
+
+/*
+ * Start collecting statistics
+ * [Chu-Cheng Yu]
+ */
+void stats_enable(void)
+{
+    stats_active = 1;
+}
+
+/*
+ * Read the statistics clock
+ * [Chu-Cheng Yu]
+ */
+uint64_t stats_clock(void)
+{
+    return collecting() ? platform_monotonic_nanoseconds() : 0;
+}
+
+/*
+ * Add the time since a stats_clock reading to a stage
+ * [Chu-Cheng Yu]
+ */
+void stats_record(stats_file_t *file, stats_stage_t stage, uint64_t started, uint64_t bytes)
+{
+    if (!collecting() || stage < 0 || stage >= STATS_STAGE_COUNT) return;
+    uint64_t now = platform_monotonic_nanoseconds();
+    uint64_t elapsed = now - started;
+    trace_record(stage, started, now, bytes);
+    metrics_observe_stage(stage, elapsed);
+    if (!stats_active) return;
+    atomic_fetch_add_explicit(&run_calls[stage], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&run_nanoseconds[stage], elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&run_bytes[stage], bytes, memory_order_relaxed);
+    if (file) {
+        atomic_fetch_add_explicit(&file->nanoseconds[stage], elapsed, memory_order_relaxed);
+        atomic_fetch_add_explicit(&file->bytes[stage], bytes, memory_order_relaxed);
+    }
+}
+
+/*
+ * Clear the stage totals of a file
+ * [Chu-Cheng Yu]
+ */
+void stats_file_begin(stats_file_t *file, stats_operation_t operation)
+{
+    file->operation = operation;
+    for (int i = 0; i < STATS_STAGE_COUNT; ++i) {
+        atomic_init(&file->nanoseconds[i], 0);
+        atomic_init(&file->bytes[i], 0);
+    }
+}
+
+/*
+ * Count a finished file and print the stages it spent time in
+ * [Chu-Cheng Yu]
+ */
+void stats_file_end(stats_file_t *file, const char *path, uint64_t bytes_in, uint64_t bytes_out)
+{
+    metrics_count_file(file->operation, bytes_in, bytes_out);
+    if (!stats_active) return;
+    atomic_fetch_add_explicit(&run_files, 1, memory_order_relaxed);
+
+    /* One line per file; built first so workers' lines do not interleave */
+    char line[MAX_PATH_LENGTH + 256];
+    uint64_t total = 0;
+    int used = snprintf(line, sizeof(line), "Stats: %s:", path ? path : "?");
+    for (int i = 0; i < STATS_STAGE_COUNT; ++i) {
+        uint64_t ns = atomic_load(&file->nanoseconds[i]);
+        uint64_t bytes = atomic_load(&file->bytes[i]);
+        if (ns == 0 && bytes == 0) continue;
+        total += ns;
+        if (used >= 0 && (size_t)used < sizeof(line)) {
+            used += snprintf(line + used, sizeof(line) - (size_t)used, " %s %.3f ms,",
+                             stage_names[i], (double)ns / 1e6);
+        }
+    }
+    printf("%s total %.3f ms\n", line, (double)total / 1e6);
+}
+
+/*
+ * Count a failed operation
+ * [Chu-Cheng Yu]
+ */
+void stats_count_error(int error_code)
+{
+    metrics_count_error(error_code);
+}
+
+/*
+ * Count a pipeline buffer allocation
+ * [Chu-Cheng Yu]
+ */
+void stats_count_allocation(uint64_t bytes)
+{
+    if (!stats_active) return;
+    atomic_fetch_add_explicit(&run_allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&run_allocated_bytes, bytes, memory_order_relaxed);
+}
+
+/*
+ * Print the run totals of every stage that ran
+ * [Chu-Cheng Yu]
+ */
+void stats_report(void)
+{
+    if (!stats_active) return;
+    printf("\nPipeline statistics (%llu files)\n", (unsigned long long)atomic_load(&run_files));
+    printf("%-18s %10s %14s %12s %10s\n", "Stage", "Calls", "Bytes", "Time (ms)", "MB/s");
+    for (int i = 0; i < STATS_STAGE_COUNT; ++i) {
+        uint64_t calls = atomic_load(&run_calls[i]);
+        if (calls == 0) continue;
+        uint64_t ns = atomic_load(&run_nanoseconds[i]);
+        uint64_t bytes = atomic_load(&run_bytes[i]);
+        double seconds = (double)ns / 1e9;
+        printf("%-18s %10llu %14llu %12.3f %10.1f\n", stage_names[i],
+               (unsigned long long)calls, (unsigned long long)bytes, seconds * 1e3,
+               seconds > 0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0);
+    }
+    printf("Peak memory: %.1f MB; pipeline buffers: %llu allocations, %.1f MB\n",
+           (double)platform_peak_memory() / (1024.0 * 1024.0),
+           (unsigned long long)atomic_load(&run_allocations),
+           (double)atomic_load(&run_allocated_bytes) / (1024.0 * 1024.0));
+}
+
+#endif /* CCRYPT_STATS */
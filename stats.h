@@ -0,0 +1,149 @@
+/*
+ * stats.h
+ * Header file for pipeline statistics
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines per-stage timing of the encryption pipeline (reads,
+ * compression, encryption, checksums, writes and library saves), kept per
+ * file and per run and printed with --stats (and traced with --trace, see
+ * trace.h, or exported with --metrics, see metrics.h). Everything is reached through
+ * the STATS_ macros, which compile to nothing unless CCRYPT_STATS is
+ * defined (the Makefile defines it unless built with STATS=0).
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "ccrypt.h"
+
+/*
+ * stats_stage
+ * Timed stages of the pipeline
+ */
+typedef enum {
+    STATS_READ = 0,          /* plaintext or container reads */
+    STATS_COMPRESS,          /* compress_encrypt_chunk: RLE with the XOR folded in */
+    STATS_ENCRYPT,           /* encrypt_data_at on chunks stored uncompressed */
+    STATS_DECRYPT,           /* decrypt_decompress_chunk */
+    STATS_CHECKSUM,          /* content checksums and chunk hashes */
+    STATS_WRITE,             /* container and plaintext writes */
+    STATS_LIBRARY_SAVE,      /* save_encryption_library */
+    STATS_LIBRARY_LOAD,      /* load_encryption_library */
+    STATS_STAGE_COUNT
+} stats_stage_t;
+
+/*
+ * stats_operation
+ * What a file went through
+ */
+typedef enum {
+    STATS_OPERATION_ENCRYPT = 0,
+    STATS_OPERATION_DECRYPT,
+    STATS_OPERATION_COUNT
+} stats_operation_t;
+
+#ifdef CCRYPT_STATS
+
+#include <stdatomic.h>
+
+/*
+ * stats_file
+ * Stage totals of one file; segments of a large file are timed on
+ * several workers at once, so the totals are atomic
+ */
+typedef struct {
+    atomic_ullong nanoseconds[STATS_STAGE_COUNT];
+    atomic_ullong bytes[STATS_STAGE_COUNT];
+    stats_operation_t operation;
+} stats_file_t;
+
+/* ========================================================================
+ * STATS FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Name of a stage, as printed in reports and traces
+ * stage Stage to name
+ * The name, or "unknown"
+ */
+const char *stats_stage_name(stats_stage_t stage);
+
+/*
+ * Start collecting statistics; call before any worker threads start
+ */
+void stats_enable(void);
+
+/*
+ * Read the statistics clock
+ * Monotonic nanoseconds, or 0 while statistics, trace and metrics are all off
+ */
+uint64_t stats_clock(void);
+
+/*
+ * Add the time since a stats_clock reading to a stage
+ * file Stage totals of the file being processed, or NULL for run-wide work
+ * stage Stage that ran
+ * started Value of stats_clock when the stage started
+ * bytes Bytes the stage processed
+ */
+void stats_record(stats_file_t *file, stats_stage_t stage, uint64_t started, uint64_t bytes);
+
+/*
+ * Clear the stage totals of a file before processing it
+ * file Stage totals to clear
+ * operation What the file is going through
+ */
+void stats_file_begin(stats_file_t *file, stats_operation_t operation);
+
+/*
+ * Count a finished file and print its stage times
+ * file Stage totals of the file
+ * path Path of the file
+ * bytes_in Bytes read from the source
+ * bytes_out Bytes written
+ */
+void stats_file_end(stats_file_t *file, const char *path, uint64_t bytes_in, uint64_t bytes_out);
+
+/*
+ * Count a failed operation
+ * error_code One of the ERROR_* codes
+ */
+void stats_count_error(int error_code);
+
+/*
+ * Count a pipeline buffer the buffer pool had to allocate afresh
+ * bytes Size of the allocation
+ */
+void stats_count_allocation(uint64_t bytes);
+
+/*
+ * Print the run totals of every stage, peak memory and allocations
+ */
+void stats_report(void);
+
+#define STATS_FILE(name) stats_file_t name
+#define STATS_FILE_BEGIN(file, operation) stats_file_begin(&(file), (operation))
+#define STATS_FILE_END(file, path, bytes_in, bytes_out) \
+    stats_file_end(&(file), (path), (uint64_t)(bytes_in), (uint64_t)(bytes_out))
+#define STATS_START(timer) uint64_t timer = stats_clock()
+#define STATS_STOP(file, stage, timer, bytes) \
+    stats_record(&(file), (stage), (timer), (uint64_t)(bytes))
+#define STATS_STOP_RUN(stage, timer, bytes) \
+    stats_record(NULL, (stage), (timer), (uint64_t)(bytes))
+#define STATS_ALLOCATION(bytes) stats_count_allocation((uint64_t)(bytes))
+#define STATS_ERROR(error_code) stats_count_error(error_code)
+
+#else /* !CCRYPT_STATS */
+
+#define STATS_FILE(name)
+#define STATS_FILE_BEGIN(file, operation) ((void)0)
+#define STATS_FILE_END(file, path, bytes_in, bytes_out) ((void)0)
+#define STATS_START(timer) ((void)0)
+#define STATS_STOP(file, stage, timer, bytes) ((void)0)
+#define STATS_STOP_RUN(stage, timer, bytes) ((void)0)
+#define STATS_ALLOCATION(bytes) ((void)0)
+#define STATS_ERROR(error_code) ((void)0)
+
+#endif /* CCRYPT_STATS */
+
+#endif /* STATS_H */
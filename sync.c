@@ -0,0 +1,254 @@
+/*
+ * sync.c
+ * Incremental directory synchronisation for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file walks a directory tree and brings the library up to date with
+ * it, skipping files whose size and modification time are unchanged.
+ */
+
+#include "ccrypt.h"
+#include "sync.h"
+#include "encryption.h"
+#include "chunk_store.h"
+#include "library.h"
+#include "utils.h"
+#include "platform.h"
+#include "stats.h"
+
+/* Paths collected by the directory walk */
+typedef struct {
+    char (*paths)[MAX_PATH_LENGTH];
+    int count;
+    int capacity;
+} path_list_t;
+
+/* forward declarations for internal helpers */
+static int collect_path(const char *path, int is_directory, void *context);
+static int count_references(encryption_library_t *library, const char *encrypted_filename);
+static int choose_encrypted_name(encryption_library_t *library, const char *source_path,
+                                 char *encrypted_filename, size_t buffer_size);
+static int reencrypt_entry(encryption_library_t *library, file_metadata_t *entry,
+                           const char *source_path, const char *password,
+                           const char *key_fingerprint, long *chunks_rewritten);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Directory walk callback: recurse into directories, remember files */
+static int collect_path(const char *path, int is_directory, void *context)
+{
+    path_list_t *list = (path_list_t *)context;
+    if (is_directory) {
+        int result = platform_list_directory(path, collect_path, context);
+        return result == ERROR_FILE_NOT_FOUND ? SUCCESS : result;
+    }
+    if (is_ccrypt_artifact(path)) return SUCCESS;
+
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        char (*paths)[MAX_PATH_LENGTH] = realloc(list->paths, sizeof(*paths) * (size_t)capacity);
+        if (!paths) return ERROR_MEMORY_ALLOCATION;
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    safe_string_copy(list->paths[list->count++], path, MAX_PATH_LENGTH);
+    return SUCCESS;
+}
+
+/* Number of entries using an encrypted filename; shared files are
+   counted by location (see count_location_references) */
+static int count_references(encryption_library_t *library, const char *encrypted_filename)
+{
+    int references = 0;
+    for (file_node_t *cur = library->head; cur; cur = cur->next) {
+        if (strncmp(cur->data.encrypted_filename, encrypted_filename, MAX_FILENAME_LENGTH) == 0) {
+            references++;
+        }
+    }
+    return references;
+}
+
+/* Encrypted filename for a new source; sources from different directories
+   can share a base name, so fall back to one carrying the library id */
+static int choose_encrypted_name(encryption_library_t *library, const char *source_path,
+                                 char *encrypted_filename, size_t buffer_size)
+{
+    int result = generate_encrypted_filename(source_path, encrypted_filename, buffer_size, 0);
+    if (result != SUCCESS) return result;
+    if (count_references(library, encrypted_filename) == 0) return SUCCESS;
+    return generate_encrypted_filename(source_path, encrypted_filename, buffer_size,
+                                       library->next_id);
+}
+
+/*
+ * Re-encrypt a changed source over its library entry, patching chunks in
+ * place when the container allows it and rewriting the file otherwise
+ */
+static int reencrypt_entry(encryption_library_t *library, file_metadata_t *entry,
+                           const char *source_path, const char *password,
+                           const char *key_fingerprint, long *chunks_rewritten)
+{
+    int same_key = strncmp(entry->key_fingerprint, key_fingerprint,
+                           sizeof(entry->key_fingerprint)) == 0;
+    /* A packed object lives inside a pack the other entries share */
+    int shared = entry->pack_id != 0 ||
+                 count_location_references(library, encrypted_file_location(entry)) > 1;
+    char location[MAX_PATH_LENGTH];
+    safe_string_copy(location, encrypted_file_location(entry), sizeof(location));
+    int exists = validate_file_path(location) == SUCCESS;
+
+    if (same_key && !shared && exists) {
+        if (is_store_recipe(location)) {
+            /* Only the chunks that changed are added to the store */
+            file_metadata_t updated;
+            int result = encrypt_file_to_store(source_path, location, password, &updated);
+            if (result != SUCCESS) return result;
+            set_encrypted_location(&updated, entry->encrypted_filename, entry->file_path);
+            updated.encryption_id = entry->encryption_id;
+            safe_string_copy(updated.key_fingerprint, key_fingerprint, sizeof(updated.key_fingerprint));
+            *entry = updated;
+            return SUCCESS;
+        }
+
+        int result = update_container_chunks(source_path, location, password,
+                                             chunks_rewritten, entry);
+        if (result == SUCCESS) {
+            printf("Updated: %s → %s (%ld chunks rewritten)\n", source_path,
+                   entry->encrypted_filename, *chunks_rewritten);
+            return SUCCESS;
+        }
+        if (result != ERROR_CONTAINER_CORRUPT) return result;
+    }
+
+    /* Full re-encrypt. A shared encrypted file still belongs to the other
+       entries, so this entry gets a name and a file of its own; a missing
+       one is written to a new place in the fanned-out layout. */
+    char encrypted_filename[MAX_FILENAME_LENGTH];
+    if (shared) {
+        int result = choose_encrypted_name(library, source_path, encrypted_filename,
+                                           sizeof(encrypted_filename));
+        if (result != SUCCESS) return result;
+    } else {
+        safe_string_copy(encrypted_filename, entry->encrypted_filename, sizeof(encrypted_filename));
+    }
+    if (shared || !exists) {
+        int result = generate_encrypted_path(library->next_id++, location, sizeof(location));
+        if (result != SUCCESS) return result;
+    }
+
+    char temp_path[MAX_PATH_LENGTH + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", location);
+    file_metadata_t updated;
+    int result = encrypt_file(source_path, temp_path, password, entry->is_compressed,
+                              ENC_XOR, &updated);
+    if (result != SUCCESS) return result;
+    remove(location);
+    if (rename(temp_path, location) != 0) {
+        remove(temp_path);
+        return ERROR_RENAME_FAILED;
+    }
+    set_encrypted_location(&updated, encrypted_filename, location);
+    updated.encryption_id = entry->encryption_id;
+    safe_string_copy(updated.key_fingerprint, key_fingerprint, sizeof(updated.key_fingerprint));
+    *entry = updated;
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * SYNC FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Encrypt new and changed files under a directory and update the library
+ * [Chu-Cheng Yu]
+ */
+int sync_directory(encryption_library_t *library, const char *directory_path,
+                   const char *password, sync_report_t *report)
+{
+    if (!library || !directory_path || !password) return ERROR_INVALID_PATH;
+    if (strlen(password) == 0) return ERROR_INVALID_PASSWORD;
+
+    sync_report_t totals;
+    memset(&totals, 0, sizeof(totals));
+    double start = platform_monotonic_seconds();
+
+    path_list_t list;
+    memset(&list, 0, sizeof(list));
+    int result = platform_list_directory(directory_path, collect_path, &list);
+    if (result != SUCCESS) {
+        printf("Error: could not read directory '%s'\n", directory_path);
+        free(list.paths);
+        return result;
+    }
+
+    char key_fingerprint[KEY_FINGERPRINT_LENGTH + 1];
+    compute_key_fingerprint(password, key_fingerprint, sizeof(key_fingerprint));
+
+    for (int i = 0; i < list.count; ++i) {
+        const char *path = list.paths[i];
+        totals.files_seen++;
+
+        platform_file_id_t id;
+        if (platform_file_identity(path, &id) != SUCCESS || id.size == 0) {
+            continue;   /* vanished or empty: nothing to encrypt */
+        }
+
+        file_metadata_t *entry = find_library_entry_by_original_name(library, path);
+        if (entry && (uint64_t)entry->original_size == id.size &&
+            entry->source_mtime_ns == id.mtime_ns &&
+            strncmp(entry->key_fingerprint, key_fingerprint, sizeof(entry->key_fingerprint)) == 0) {
+            totals.files_unchanged++;
+            continue;
+        }
+
+        if (entry) {
+            long chunks = 0;
+            result = reencrypt_entry(library, entry, path, password, key_fingerprint, &chunks);
+            library_entry_updated(library, entry);
+            if (result == SUCCESS) {
+                totals.files_changed++;
+                totals.chunks_rewritten += chunks;
+                library->is_modified = 1;
+            }
+        } else {
+            char encrypted_filename[MAX_FILENAME_LENGTH];
+            char location[MAX_PATH_LENGTH];
+            file_metadata_t metadata;
+            result = choose_encrypted_name(library, path, encrypted_filename,
+                                           sizeof(encrypted_filename));
+            if (result == SUCCESS) {
+                result = generate_encrypted_path(library->next_id, location, sizeof(location));
+            }
+            if (result == SUCCESS) {
+                result = encrypt_file(path, location, password, 0, ENC_XOR, &metadata);
+            }
+            if (result == SUCCESS) {
+                set_encrypted_location(&metadata, encrypted_filename, location);
+                metadata.encryption_id = library->next_id;
+                safe_string_copy(metadata.key_fingerprint, key_fingerprint,
+                                 sizeof(metadata.key_fingerprint));
+                result = add_file_to_library(library, &metadata);
+            }
+            if (result == SUCCESS) {
+                library->next_id++;
+                totals.files_new++;
+            }
+        }
+        if (result != SUCCESS) {
+            printf("Error: could not sync '%s' (error %d)\n", path, result);
+            totals.files_failed++;
+            STATS_ERROR(result);
+        }
+    }
+    free(list.paths);
+
+    totals.seconds = platform_monotonic_seconds() - start;
+    printf("Sync of %s: %d files, %d new, %d changed (%ld chunks patched), %d unchanged, "
+           "%d failed (%.3f s)\n", directory_path, totals.files_seen, totals.files_new,
+           totals.files_changed, totals.chunks_rewritten, totals.files_unchanged,
+           totals.files_failed, totals.seconds);
+    if (report) *report = totals;
+    return totals.files_failed ? ERROR_ENCRYPTION_FAILED : SUCCESS;
+}
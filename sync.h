@@ -0,0 +1,48 @@
+/*
+ * sync.h
+ * Header file for incremental directory synchronisation
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the sync operation, which keeps the library up to
+ * date with a directory tree: new files are encrypted, files whose size or
+ * modification time changed are re-encrypted (only their changed chunks
+ * where the container allows it) and unchanged files are not read at all.
+ */
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "ccrypt.h"
+
+/*
+ * sync_report
+ * Totals for a sync run
+ */
+typedef struct {
+    int files_seen;
+    int files_new;
+    int files_changed;
+    int files_unchanged;
+    int files_failed;
+    long chunks_rewritten;   /* chunks patched into existing containers */
+    double seconds;
+} sync_report_t;
+
+/* ========================================================================
+ * SYNC FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Encrypt new and changed files under a directory and update their library
+ * entries in place, then print a summary
+ * library Pointer to the encryption library
+ * directory_path Root of the tree to synchronise (walked recursively)
+ * password Encryption password
+ * report Optional pointer to receive the totals
+ * SUCCESS if every file is up to date, ERROR_ENCRYPTION_FAILED if any file
+ * failed, or another error code if the tree cannot be read
+ */
+int sync_directory(encryption_library_t *library, const char *directory_path,
+                   const char *password, sync_report_t *report);
+
+#endif /* SYNC_H */
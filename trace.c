@@ -0,0 +1,193 @@
+/*
+ * trace.c
+ * Pipeline trace export for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file records stage events into per-thread buffers and writes them as
+ * Chrome trace-event JSON. A thread's first event links its buffer into a
+ * shared list with a compare-and-swap; after that only the owning thread
+ * touches the buffer until trace_finish.
+ */
+
+#include "ccrypt.h"
+#include "trace.h"
+
+#ifdef CCRYPT_STATS
+
+#include <stdatomic.h>
+
+#include "platform.h"
+#include "utils.h"
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t bytes;
+    stats_stage_t stage;
+} trace_event_t;
+
+typedef struct trace_block {
+    struct trace_block *next;
+    int count;
+    trace_event_t events[TRACE_BLOCK_EVENTS];
+} trace_block_t;
+
+/* Events of one thread */
+typedef struct trace_buffer {
+    struct trace_buffer *next;
+    int thread_number;
+    trace_block_t *first;
+    trace_block_t *last;
+} trace_buffer_t;
+
+static int tracing = 0;        /* set before any worker starts */
+static char trace_path[MAX_PATH_LENGTH];
+static uint64_t trace_origin_ns;
+static _Atomic(trace_buffer_t *) trace_buffers = NULL;
+static atomic_int trace_threads = 0;
+static atomic_ullong trace_dropped = 0;
+static _Thread_local trace_buffer_t *thread_buffer = NULL;
+
+/* forward declarations for internal helpers */
+static trace_buffer_t *register_thread(void);
+static trace_event_t *next_event(trace_buffer_t *buffer);
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Give the calling thread a buffer and push it onto the shared list */
+static trace_buffer_t *register_thread(void)
+{
+    trace_buffer_t *buffer = (trace_buffer_t *)calloc(1, sizeof(trace_buffer_t));
+    if (!buffer) return NULL;
+    buffer->thread_number = atomic_fetch_add(&trace_threads, 1) + 1;
+    trace_buffer_t *head = atomic_load(&trace_buffers);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak(&trace_buffers, &head, buffer));
+    return buffer;
+}
+
+/* Slot for the next event, chaining a new block when the last one is full */
+static trace_event_t *next_event(trace_buffer_t *buffer)
+{
+    if (!buffer->last || buffer->last->count == TRACE_BLOCK_EVENTS) {
+        trace_block_t *block = (trace_block_t *)malloc(sizeof(trace_block_t));
+        if (!block) return NULL;
+        block->next = NULL;
+        block->count = 0;
+        if (buffer->last) buffer->last->next = block;
+        else buffer->first = block;
+        buffer->last = block;
+    }
+    return &buffer->last->events[buffer->last->count++];
+}
+
+/* ========================================================================
+ * TRACE FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Start recording events
+ * [Chu-Cheng Yu]
+ */
+int trace_start(const char *output_path)
+{
+    if (!output_path || strlen(output_path) >= sizeof(trace_path)) return ERROR_INVALID_PATH;
+    safe_string_copy(trace_path, output_path, sizeof(trace_path));
+    trace_origin_ns = platform_monotonic_nanoseconds();
+    tracing = 1;
+    return SUCCESS;
+}
+
+/*
+ * Whether events are being recorded
+ * [Chu-Cheng Yu]
+ */
+int trace_active(void)
+{
+    return tracing;
+}
+
+/*
+ * Record one stage of the calling thread
+ * [Chu-Cheng Yu]
+ */
+void trace_record(stats_stage_t stage, uint64_t start_ns, uint64_t end_ns, uint64_t bytes)
+{
+    if (!tracing) return;
+    if (!thread_buffer) thread_buffer = register_thread();
+    trace_event_t *event = thread_buffer ? next_event(thread_buffer) : NULL;
+    if (!event) {
+        atomic_fetch_add_explicit(&trace_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    event->start_ns = start_ns;
+    event->end_ns = end_ns;
+    event->bytes = bytes;
+    event->stage = stage;
+}
+
+/*
+ * Write the recorded events as Chrome trace-event JSON
+ * [Chu-Cheng Yu]
+ */
+int trace_finish(void)
+{
+    if (!tracing) return SUCCESS;
+    tracing = 0;
+
+    FILE *fp = fopen(trace_path, "w");
+    if (!fp) printf("Error: could not write trace '%s'\n", trace_path);
+
+    /* Complete ("X") events in microseconds since trace_start */
+    long long written = 0;
+    int first = 1;
+    if (fp) fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    trace_buffer_t *buffer = atomic_exchange(&trace_buffers, NULL);
+    while (buffer) {
+        if (fp) {
+            fprintf(fp, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+                    "\"args\":{\"name\":\"thread %d\"}}", first ? "" : ",\n",
+                    buffer->thread_number, buffer->thread_number);
+            first = 0;
+        }
+        trace_block_t *block = buffer->first;
+        while (block) {
+            for (int i = 0; fp && i < block->count; ++i) {
+                const trace_event_t *event = &block->events[i];
+                uint64_t start = event->start_ns - trace_origin_ns;
+                uint64_t duration = event->end_ns - event->start_ns;
+                fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"cat\":\"ccrypt\",\"name\":\"%s\","
+                        "\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"args\":{\"bytes\":%llu}}",
+                        buffer->thread_number, stats_stage_name(event->stage),
+                        (unsigned long long)(start / 1000), (unsigned)(start % 1000),
+                        (unsigned long long)(duration / 1000), (unsigned)(duration % 1000),
+                        (unsigned long long)event->bytes);
+                written++;
+            }
+            trace_block_t *next = block->next;
+            free(block);
+            block = next;
+        }
+        trace_buffer_t *next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    thread_buffer = NULL;
+    if (!fp) return ERROR_PERMISSION_DENIED;
+
+    fprintf(fp, "\n]}\n");
+    if (fclose(fp) != 0) {
+        printf("Error: could not write trace '%s'\n", trace_path);
+        return ERROR_PERMISSION_DENIED;
+    }
+    unsigned long long dropped = atomic_load(&trace_dropped);
+    printf("Wrote trace of %lld events to %s", written, trace_path);
+    if (dropped) printf(" (%llu dropped: out of memory)", dropped);
+    printf("\n");
+    return SUCCESS;
+}
+
+#endif /* CCRYPT_STATS */
@@ -0,0 +1,59 @@
+/*
+ * trace.h
+ * Header file for pipeline trace export
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines --trace, which keeps every stage timed through the
+ * STATS_ macros as a begin/end event and writes them at exit in Chrome's
+ * trace-event JSON format (chrome://tracing, Perfetto). Each thread appends
+ * to a buffer of its own, so recording takes no locks. Like the statistics
+ * it is compiled only when CCRYPT_STATS is defined.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "ccrypt.h"
+#include "stats.h"
+
+#ifdef CCRYPT_STATS
+
+#define TRACE_BLOCK_EVENTS 4096  /* events per buffer block; blocks are chained */
+
+/* ========================================================================
+ * TRACE FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Start recording events; call before any worker threads start
+ * output_path Path of the JSON file written by trace_finish
+ * SUCCESS on success, ERROR_INVALID_PATH if the path is too long
+ */
+int trace_start(const char *output_path);
+
+/*
+ * Whether events are being recorded
+ * Nonzero after trace_start
+ */
+int trace_active(void);
+
+/*
+ * Record one stage of the calling thread
+ * stage Stage that ran
+ * start_ns Clock reading when it started
+ * end_ns Clock reading when it ended
+ * bytes Bytes the stage processed
+ */
+void trace_record(stats_stage_t stage, uint64_t start_ns, uint64_t end_ns, uint64_t bytes);
+
+/*
+ * Write the recorded events and free the buffers; every thread that
+ * recorded must have finished
+ * SUCCESS on success (or when not tracing), ERROR_PERMISSION_DENIED if
+ * the file cannot be written
+ */
+int trace_finish(void);
+
+#endif /* CCRYPT_STATS */
+
+#endif /* TRACE_H */
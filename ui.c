@@ -12,6 +12,9 @@
 #include "encryption.h"
 #include "library.h"
 #include "utils.h"
+#include "verify.h"
+#include "batch.h"
+#include "stats.h"
 
 /* ========================================================================
  * USER INTERFACE FUNCTIONS
@@ -147,6 +150,7 @@ int process_user_command(int choice, encryption_library_t *library)
  */
 void display_error(int error_code, const char *context)
 {
+    STATS_ERROR(error_code);
     printf("\nError in %s: ", context);
     
     switch (error_code) {
@@ -174,6 +178,12 @@ void display_error(int error_code, const char *context)
         case ERROR_COMPRESSION_FAILED:
             printf("Compression operation failed\n");
             break;
+        case ERROR_CONTAINER_CORRUPT:
+            printf("Encrypted file is corrupted\n");
+            break;
+        case ERROR_CHECKSUM_MISMATCH:
+            printf("Checksum mismatch (wrong password or modified file)\n");
+            break;
         default:
             printf("Unknown error (code: %d)\n", error_code);
             break;
@@ -292,10 +302,13 @@ int file_management_menu(encryption_library_t *library)
         printf("2. Search files by name\n");
         printf("3. Delete encrypted file\n");
         printf("4. Rename encrypted file\n");
-        printf("5. Return to main menu\n");
+        printf("5. Verify library integrity\n");
+        printf("6. Show deduplication savings\n");
+        printf("7. Encrypt a directory\n");
+        printf("8. Return to main menu\n");
         printf("========================================\n");
         
-        choice = get_user_choice("Select an option: ", 1, 5);
+        choice = get_user_choice("Select an option: ", 1, 8);
         
         switch (choice) {
             case 1: // View file details
@@ -372,7 +385,19 @@ int file_management_menu(encryption_library_t *library)
                 }
                 break;
                 
-            case 5: // Return to main menu
+            case 5: // Verify library
+                result = verify_library(library, 0, NULL);
+                break;
+                
+            case 6: // Deduplication report
+                display_dedup_savings(library);
+                break;
+                
+            case 7: // Batch encrypt a directory tree
+                result = encrypt_directory_workflow(library);
+                break;
+                
+            case 8: // Return to main menu
                 printf("Returning to main menu...\n");
                 break;
                 
@@ -381,12 +406,12 @@ int file_management_menu(encryption_library_t *library)
                 break;
         }
         
-        if (result != SUCCESS && choice != 5) {
+        if (result != SUCCESS && choice != 8) {
             display_error(result, "File management operation");
             result = SUCCESS; /* Continue menu on non-fatal errors */
         }
         
-    } while (choice != 5);
+    } while (choice != 8);
     
     return result;
 }
@@ -9,6 +9,9 @@
 
 #include "ccrypt.h"
 #include "utils.h"
+#include "checksum.h"
+#include "checksum_cache.h"
+#include "platform.h"
 
 /* ========================================================================
  * UTILITY FUNCTIONS
@@ -59,8 +62,52 @@ int generate_encrypted_filename(const char *original_path, char *encrypted_filen
         *ext = '\0';  /* Truncate at the extension */
     }
     
-    /* Create encrypted filename: original_name_without_ext.ccrypt */
-    snprintf(encrypted_filename, buffer_size, "%s.ccrypt", base_name);
+    /* Create encrypted filename: original_name_without_ext.ccrypt, or with
+       the id appended when the plain name is already taken */
+    if (id == 0) {
+        snprintf(encrypted_filename, buffer_size, "%s.ccrypt", base_name);
+    } else {
+        base_name[MAX_FILENAME_LENGTH - 32] = '\0'; /* room for "-<id>.ccrypt" */
+        snprintf(encrypted_filename, buffer_size, "%s-%lu.ccrypt", base_name, id);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Generate the fanned-out path of a new encrypted file
+ * [Chu-Cheng Yu]
+ */
+int generate_encrypted_path(unsigned long id, char *file_path, size_t buffer_size)
+{
+    if (!file_path || buffer_size == 0) return ERROR_INVALID_PATH;
+
+    /* Consecutive ids land in unrelated directories */
+    uint64_t h = (uint64_t)id;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    unsigned int top = (unsigned int)(h >> 56);
+    unsigned int second = (unsigned int)(h >> 48) & 0xffu;
+
+    char directory[MAX_PATH_LENGTH];
+    int result = platform_make_directory(ENCRYPTED_FILES_DIRECTORY);
+    if (result == SUCCESS) {
+        snprintf(directory, sizeof(directory), "%s/%02x", ENCRYPTED_FILES_DIRECTORY, top);
+        result = platform_make_directory(directory);
+    }
+    if (result == SUCCESS) {
+        snprintf(directory, sizeof(directory), "%s/%02x/%02x", ENCRYPTED_FILES_DIRECTORY, top, second);
+        result = platform_make_directory(directory);
+    }
+    if (result != SUCCESS) {
+        printf("Error: could not create directory for encrypted files\n");
+        return result;
+    }
+    if (snprintf(file_path, buffer_size, "%s/%lu.ccrypt", directory, id) >= (int)buffer_size) {
+        return ERROR_INVALID_PATH;
+    }
     return SUCCESS;
 }
 
@@ -70,10 +117,17 @@ int generate_encrypted_filename(const char *original_path, char *encrypted_filen
  */
 void secure_memory_clear(void *data, size_t size)
 {
-    volatile unsigned char *ptr = (volatile unsigned char *)data;
-    for (size_t i = 0; i < size; i++) {
-        ptr[i] = 0;
-    }
+    if (!data || size == 0) return;
+#if defined(__GNUC__) || defined(__clang__)
+    /* The library's vectorised memset; the empty asm claims to read the
+       memory afterwards, so the compiler cannot drop the stores as dead */
+    memset(data, 0, size);
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+    /* Called through a volatile pointer the compiler cannot see through */
+    static void *(*const volatile clear_bytes)(void *, int, size_t) = memset;
+    clear_bytes(data, 0, size);
+#endif
 }
 
 /*
@@ -93,24 +147,54 @@ int safe_string_copy(char *dest, const char *src, size_t dest_size)
 }
 
 /*
- * Compute a simple non-cryptographic checksum for a file
+ * Compute the 64-bit checksum (see checksum.h) of a file's contents
  * file_path Path to the file
- * checksum Buffer to receive a textual hex checksum
- * buffer_size Size of the checksum buffer
+ * checksum Buffer to receive the checksum as 16 hex digits
+ * buffer_size Size of the checksum buffer (more than CHECKSUM_HEX_LENGTH)
  * SUCCESS on success, or an error code on failure
  * [Chu-Cheng Yu]
  */
 int calculate_file_checksum(const char *file_path, char *checksum, size_t buffer_size)
 {
-    if (!file_path || !checksum || buffer_size < 3) return ERROR_INVALID_PATH;
-    /* Simple non-cryptographic checksum: sum of bytes mod 65536 as hex */
+    if (!file_path || !checksum || buffer_size <= CHECKSUM_HEX_LENGTH) return ERROR_INVALID_PATH;
+
+    /* Unchanged since it was last hashed: reuse the cached value */
+    platform_file_id_t before;
+    int have_id = platform_file_identity(file_path, &before) == SUCCESS;
+    uint64_t cached;
+    if (have_id && checksum_cache_lookup(&before, CHECKSUM_KIND_FILE, &cached) == SUCCESS) {
+        format_checksum(cached, checksum, buffer_size);
+        return SUCCESS;
+    }
+
     FILE *f = fopen(file_path, "rb");
     if (!f) return ERROR_FILE_NOT_FOUND;
-    unsigned long sum = 0;
-    int c;
-    while ((c = fgetc(f)) != EOF) sum = (sum + (unsigned char)c) & 0xFFFFFFFFu;
+
+    /* Hash in large blocks rather than a stdio call per byte */
+    unsigned char *block = malloc(CHUNK_SIZE);
+    if (!block) {
+        fclose(f);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    checksum_state_t state;
+    checksum_init(&state);
+    size_t n;
+    while ((n = fread(block, 1, CHUNK_SIZE, f)) > 0) {
+        checksum_update(&state, block, n);
+    }
+    int read_error = ferror(f);
     fclose(f);
-    snprintf(checksum, buffer_size, "%08lx", sum);
+    free(block);
+    if (read_error) return ERROR_FILE_NOT_FOUND;
+
+    /* Only cache if the file did not change while it was being read */
+    uint64_t value = checksum_final(&state);
+    platform_file_id_t after;
+    if (have_id && platform_file_identity(file_path, &after) == SUCCESS &&
+        memcmp(&before, &after, sizeof(before)) == 0) {
+        checksum_cache_store(&after, CHECKSUM_KIND_FILE, value);
+    }
+    format_checksum(value, checksum, buffer_size);
     return SUCCESS;
 }
 
@@ -150,4 +234,28 @@ void format_file_size(long size, char *buffer, size_t buffer_size)
     int unit = 0;
     while (s >= 1024.0 && unit < 3) { s /= 1024.0; unit++; }
     snprintf(buffer, buffer_size, "%.2f %s", s, units[unit]);
-}
\ No newline at end of file
+}
+
+/*
+ * Check whether a path is a file CCrypt itself writes
+ * [Chu-Cheng Yu]
+ */
+int is_ccrypt_artifact(const char *path)
+{
+    static const char *const suffixes[] = { ".ccrypt", JOURNAL_SUFFIX, PACK_SUFFIX, ".tmp" };
+    static const char *const names[] = { LIBRARY_FILENAME, CHECKSUM_CACHE_FILENAME,
+                                         CHUNK_STORE_FILENAME };
+    size_t len = strlen(path);
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+        size_t n = strlen(suffixes[i]);
+        if (len >= n && strcmp(path + len - n, suffixes[i]) == 0) return 1;
+    }
+    const char *base = strrchr(path, '/');
+    const char *alt = strrchr(path, '\\');
+    if (alt && (!base || alt > base)) base = alt;
+    base = base ? base + 1 : path;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(base, names[i]) == 0) return 1;
+    }
+    return 0;
+}
@@ -24,18 +24,31 @@
 int validate_file_path(const char *file_path);
 
 /*
- * Generate a secure filename for encrypted file
+ * Generate the name an encrypted file is shown and looked up by in the library
  * original_path Path to the original file
  * encrypted_filename Buffer to store generated filename
  * buffer_size Size of the filename buffer
- * id Unique ID to use in filename generation
+ * id Unique ID to use in filename generation: 0 gives "<base>.ccrypt",
+ *    anything else "<base>-<id>.ccrypt" for when the plain name is taken
  * SUCCESS on success, error code on failure
  */
 int generate_encrypted_filename(const char *original_path, char *encrypted_filename, 
                                size_t buffer_size, unsigned long id);
 
 /*
- * Securely clear memory containing sensitive data
+ * Generate where a new encrypted file is stored, creating its directories.
+ * Files are spread over ENCRYPTED_FILES_DIRECTORY/ab/cd/<id>.ccrypt by a
+ * hash of the id, so no directory grows past a few hundred entries.
+ * id Library id of the file
+ * file_path Buffer to store the path
+ * buffer_size Size of the path buffer
+ * SUCCESS on success, or an error code if the directories cannot be created
+ */
+int generate_encrypted_path(unsigned long id, char *file_path, size_t buffer_size);
+
+/*
+ * Securely clear memory containing sensitive data; a full-speed memset the
+ * compiler is not allowed to optimise away
  * data Pointer to memory to clear
  * size Size of memory to clear in bytes
  */
@@ -51,10 +64,10 @@ void secure_memory_clear(void *data, size_t size);
 int safe_string_copy(char *dest, const char *src, size_t dest_size);
 
 /*
- * Compute a simple non-cryptographic checksum for a file
+ * Compute the 64-bit checksum (see checksum.h) of a file's contents
  * file_path Path to the file
- * checksum Buffer to receive a textual hex checksum
- * buffer_size Size of the checksum buffer
+ * checksum Buffer to receive the checksum as 16 hex digits
+ * buffer_size Size of the checksum buffer (more than CHECKSUM_HEX_LENGTH)
  * SUCCESS on success, or an error code on failure
  */
 int calculate_file_checksum(const char *file_path, char *checksum, size_t buffer_size);
@@ -76,4 +89,13 @@ int get_file_extension(const char *filename, char *extension, size_t buffer_size
  */
 void format_file_size(long size, char *buffer, size_t buffer_size);
 
+/*
+ * Check whether a path is a file CCrypt itself writes (encrypted files,
+ * journals, packfiles, temporaries, the library, cache and chunk store), which
+ * directory operations must never take as a source
+ * path Path to check
+ * 1 if the path is a CCrypt artifact, 0 otherwise
+ */
+int is_ccrypt_artifact(const char *path);
+
 #endif /* UTILS_H */
\ No newline at end of file
@@ -0,0 +1,377 @@
+/*
+ * verify.c
+ * Library integrity verification for CCrypt
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This file hashes the encrypted files tracked in the library on a pool of
+ * worker threads and compares them with the checksums in their containers.
+ */
+
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "ccrypt.h"
+#include "verify.h"
+#include "encryption.h"
+#include "library.h"
+#include "checksum.h"
+#include "checksum_cache.h"
+#include "platform.h"
+#include "pack.h"
+
+#define MAX_VERIFY_WORKERS 64
+
+/* One file to check, and where its result goes */
+typedef struct {
+    const file_metadata_t *metadata;
+    verify_status_t status;
+} verify_job_t;
+
+/* State shared by all workers; jobs are handed out by an atomic cursor */
+typedef struct {
+    verify_job_t *jobs;
+    int job_count;
+    atomic_int next_job;
+    atomic_llong bytes_hashed;
+    const chunk_store_t *store;  /* read-only once the workers start */
+} verify_pool_t;
+
+/* ========================================================================
+ * INTERNAL HELPERS
+ * ======================================================================== */
+
+/* Largest encrypted files first */
+static int cmp_job_size(const void *a, const void *b)
+{
+    const verify_job_t *x = (const verify_job_t *)a;
+    const verify_job_t *y = (const verify_job_t *)b;
+    if (x->metadata->encrypted_size < y->metadata->encrypted_size) return 1;
+    if (x->metadata->encrypted_size > y->metadata->encrypted_size) return -1;
+    return 0;
+}
+
+/* Hash the chunk payloads of a chunked container */
+static verify_status_t hash_container_payload(FILE *fp, const container_header_t *header,
+                                              unsigned char *buffer, size_t buffer_size,
+                                              checksum_state_t *state, long long *bytes_hashed)
+{
+    uint64_t total = 0;
+    while (total < header->original_size) {
+        chunk_header_t chunk;
+        if (fread(&chunk, sizeof(chunk), 1, fp) != 1) return VERIFY_TRUNCATED;
+        if (chunk.raw_size == 0 || chunk.stored_size > chunk.raw_size ||
+            chunk.stored_size > buffer_size) {
+            return VERIFY_MODIFIED;
+        }
+        if (fread(buffer, 1, chunk.stored_size, fp) != chunk.stored_size) return VERIFY_TRUNCATED;
+        checksum_update(state, buffer, chunk.stored_size);
+        *bytes_hashed += chunk.stored_size;
+        total += chunk.raw_size;
+    }
+    return total == header->original_size ? VERIFY_OK : VERIFY_MODIFIED;
+}
+
+/* Hash the XOR stream in front of an in-place trailer */
+static verify_status_t hash_in_place_payload(FILE *fp, const container_header_t *trailer,
+                                             unsigned char *buffer, size_t buffer_size,
+                                             checksum_state_t *state, long long *bytes_hashed)
+{
+    uint64_t remaining = trailer->original_size;
+    fseek(fp, 0, SEEK_SET);
+    while (remaining > 0) {
+        size_t n = remaining < buffer_size ? (size_t)remaining : buffer_size;
+        if (fread(buffer, 1, n, fp) != n) return VERIFY_TRUNCATED;
+        checksum_update(state, buffer, n);
+        *bytes_hashed += (long long)n;
+        remaining -= n;
+    }
+    return VERIFY_OK;
+}
+
+/* Check that every chunk a recipe names is in the store with the size the
+   recipe expects; the chunks themselves can only be checked with the password */
+static verify_status_t verify_recipe(FILE *fp, const chunk_store_t *store)
+{
+    recipe_header_t header;
+    if (platform_seek(fp, 0) != SUCCESS || fread(&header, sizeof(header), 1, fp) != 1) {
+        return VERIFY_TRUNCATED;
+    }
+    if (header.version != RECIPE_VERSION) return VERIFY_MODIFIED;
+    if (!store) return VERIFY_MISSING;
+
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < header.chunk_count; ++i) {
+        recipe_entry_t entry;
+        if (fread(&entry, sizeof(entry), 1, fp) != 1) return VERIFY_TRUNCATED;
+        const chunk_store_entry_t *chunk = chunk_store_find(store, entry.chunk_id);
+        if (!chunk) return VERIFY_MISSING;
+        if (chunk->raw_size != entry.raw_size) return VERIFY_MODIFIED;
+        total += entry.raw_size;
+    }
+    return total == header.original_size ? VERIFY_OK : VERIFY_MODIFIED;
+}
+
+/* Check a packed object: one positioned read, then hash its chunks in memory */
+static verify_status_t verify_packed_object(const file_metadata_t *metadata,
+                                            long long *bytes_hashed)
+{
+    char name[MAX_FILENAME_LENGTH];
+    pack_filename(metadata->pack_id, name, sizeof(name));
+    platform_file_id_t id;
+    if (platform_file_identity(name, &id) != SUCCESS) return VERIFY_MISSING;
+    if (id.size < metadata->pack_offset + metadata->pack_length) return VERIFY_TRUNCATED;
+
+    unsigned char *object;
+    if (pack_read_object(metadata, &object) != SUCCESS) return VERIFY_TRUNCATED;
+
+    verify_status_t status = VERIFY_MODIFIED;
+    size_t length = (size_t)metadata->pack_length;
+    container_header_t header;
+    if (length >= sizeof(header)) {
+        memcpy(&header, object, sizeof(header));
+        if (memcmp(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature)) == 0 &&
+            header.version == CONTAINER_VERSION) {
+            checksum_state_t state;
+            checksum_init(&state);
+            size_t pos = sizeof(header);
+            uint64_t total = 0;
+            status = VERIFY_OK;
+            while (status == VERIFY_OK && total < header.original_size) {
+                chunk_header_t chunk;
+                if (length - pos < sizeof(chunk)) {
+                    status = VERIFY_TRUNCATED;
+                    break;
+                }
+                memcpy(&chunk, object + pos, sizeof(chunk));
+                pos += sizeof(chunk);
+                if (chunk.raw_size == 0 || chunk.stored_size > chunk.raw_size) {
+                    status = VERIFY_MODIFIED;
+                } else if (length - pos < chunk.stored_size) {
+                    status = VERIFY_TRUNCATED;
+                } else {
+                    checksum_update(&state, object + pos, chunk.stored_size);
+                    *bytes_hashed += chunk.stored_size;
+                    pos += chunk.stored_size;
+                    total += chunk.raw_size;
+                }
+            }
+            if (status == VERIFY_OK && (total != header.original_size ||
+                                        checksum_final(&state) != header.ciphertext_checksum)) {
+                status = VERIFY_MODIFIED;
+            }
+        }
+    }
+    free(object);
+    return status;
+}
+
+/* Worker thread: claim jobs until none are left */
+static int verify_worker(void *arg)
+{
+    verify_pool_t *pool = (verify_pool_t *)arg;
+    unsigned char *buffer = malloc(CHUNK_SIZE);
+    if (!buffer) return ERROR_MEMORY_ALLOCATION;
+
+    long long hashed = 0;
+    int index;
+    while ((index = atomic_fetch_add(&pool->next_job, 1)) < pool->job_count) {
+        verify_job_t *job = &pool->jobs[index];
+        job->status = verify_encrypted_file(job->metadata, pool->store, buffer, CHUNK_SIZE,
+                                            &hashed);
+    }
+    atomic_fetch_add(&pool->bytes_hashed, hashed);
+    free(buffer);
+    return SUCCESS;
+}
+
+static const char *status_name(verify_status_t status)
+{
+    switch (status) {
+        case VERIFY_OK: return "ok";
+        case VERIFY_MISSING: return "missing";
+        case VERIFY_TRUNCATED: return "truncated";
+        case VERIFY_MODIFIED: return "modified";
+        case VERIFY_UNVERIFIABLE: return "unverifiable";
+        default: return "unknown";
+    }
+}
+
+/* ========================================================================
+ * VERIFICATION FUNCTIONS
+ * ======================================================================== */
+
+/*
+ * Check one encrypted file against its container checksum
+ * [Chu-Cheng Yu]
+ */
+verify_status_t verify_encrypted_file(const file_metadata_t *metadata, const chunk_store_t *store,
+                                      unsigned char *buffer, size_t buffer_size,
+                                      long long *bytes_hashed)
+{
+    if (!metadata || !buffer || buffer_size < CHUNK_SIZE || !bytes_hashed) return VERIFY_MISSING;
+    if (metadata->pack_id) return verify_packed_object(metadata, bytes_hashed);
+
+    FILE *fp = fopen(encrypted_file_location(metadata), "rb");
+    if (!fp) return VERIFY_MISSING;
+
+    /* A recipe's entry is also charged for the chunks it added to the
+       store, so the size check below does not apply to it */
+    char signature[8];
+    if (fread(signature, sizeof(signature), 1, fp) == 1 &&
+        memcmp(signature, RECIPE_SIGNATURE, sizeof(signature)) == 0) {
+        verify_status_t status = verify_recipe(fp, store);
+        fclose(fp);
+        return status;
+    }
+
+    /* Cheap size check before reading anything else */
+    uint64_t size = 0;
+    if (platform_stream_size(fp, &size) != SUCCESS) {
+        fclose(fp);
+        return VERIFY_MISSING;
+    }
+    if (metadata->encrypted_size > 0 && size != (uint64_t)metadata->encrypted_size) {
+        fclose(fp);
+        return size < (uint64_t)metadata->encrypted_size ? VERIFY_TRUNCATED : VERIFY_MODIFIED;
+    }
+    if (platform_seek(fp, 0) != SUCCESS) {
+        fclose(fp);
+        return VERIFY_MISSING;
+    }
+
+    container_header_t header;
+    checksum_state_t state;
+    checksum_init(&state);
+    verify_status_t status;
+    int in_place = 0;
+    if (fread(&header, sizeof(header), 1, fp) == 1 &&
+        memcmp(header.signature, CONTAINER_SIGNATURE, sizeof(header.signature)) == 0) {
+        status = (header.version != CONTAINER_VERSION || header.chunk_size > buffer_size)
+                 ? VERIFY_MODIFIED : VERIFY_OK;
+    } else if (read_in_place_trailer(fp, &header) == SUCCESS) {
+        status = VERIFY_OK;
+        in_place = 1;
+    } else {
+        /* Headerless files from before containers carry no checksum */
+        status = VERIFY_UNVERIFIABLE;
+    }
+
+    /* A payload hashed on an earlier run needs only its header read again;
+       a cached value that no longer matches is dropped and recomputed */
+    platform_file_id_t id;
+    int have_id = platform_file_identity(encrypted_file_location(metadata), &id) == SUCCESS;
+    if (status == VERIFY_OK && have_id && (header.flags & CONTAINER_FLAG_CIPHER_CHECKSUM)) {
+        uint64_t cached;
+        if (checksum_cache_lookup(&id, CHECKSUM_KIND_PAYLOAD, &cached) == SUCCESS) {
+            if (cached == header.ciphertext_checksum) {
+                fclose(fp);
+                return VERIFY_OK;
+            }
+            checksum_cache_invalidate(&id, CHECKSUM_KIND_PAYLOAD);
+        }
+    }
+
+    if (status == VERIFY_OK) {
+        if (in_place) {
+            status = hash_in_place_payload(fp, &header, buffer, buffer_size, &state, bytes_hashed);
+        } else {
+            status = hash_container_payload(fp, &header, buffer, buffer_size, &state, bytes_hashed);
+        }
+    }
+    fclose(fp);
+
+    if (status == VERIFY_OK) {
+        uint64_t payload_checksum = checksum_final(&state);
+        if (have_id) checksum_cache_store(&id, CHECKSUM_KIND_PAYLOAD, payload_checksum);
+        if (!(header.flags & CONTAINER_FLAG_CIPHER_CHECKSUM)) {
+            status = VERIFY_UNVERIFIABLE;
+        } else if (payload_checksum != header.ciphertext_checksum) {
+            status = VERIFY_MODIFIED;
+        }
+    }
+    return status;
+}
+
+/*
+ * Verify every file in the library with a bounded pool of worker threads
+ * [Chu-Cheng Yu]
+ */
+int verify_library(encryption_library_t *library, int worker_count, verify_report_t *report)
+{
+    if (!library) return ERROR_INVALID_PATH;
+
+    verify_report_t totals;
+    memset(&totals, 0, sizeof(totals));
+    if (library->count == 0) {
+        printf("No encrypted files in library.\n");
+        if (report) *report = totals;
+        return SUCCESS;
+    }
+
+    verify_pool_t pool;
+    pool.job_count = library->count;
+    pool.jobs = (verify_job_t *)malloc(sizeof(verify_job_t) * (size_t)pool.job_count);
+    if (!pool.jobs) return ERROR_MEMORY_ALLOCATION;
+    atomic_init(&pool.next_job, 0);
+    atomic_init(&pool.bytes_hashed, 0);
+
+    /* Recipes are checked against the store's index, built once here */
+    platform_file_id_t store_id;
+    chunk_store_t store;
+    int have_store = platform_file_identity(CHUNK_STORE_FILENAME, &store_id) == SUCCESS &&
+                     chunk_store_open(&store, CHUNK_STORE_FILENAME) == SUCCESS;
+    pool.store = have_store ? &store : NULL;
+
+    file_node_t *cur = library->head;
+    for (int i = 0; i < pool.job_count && cur; ++i, cur = cur->next) {
+        pool.jobs[i].metadata = &cur->data;
+        pool.jobs[i].status = VERIFY_MISSING;
+    }
+    qsort(pool.jobs, (size_t)pool.job_count, sizeof(verify_job_t), cmp_job_size);
+
+    if (worker_count <= 0) worker_count = platform_cpu_count();
+    if (worker_count > MAX_VERIFY_WORKERS) worker_count = MAX_VERIFY_WORKERS;
+    if (worker_count > pool.job_count) worker_count = pool.job_count;
+
+    double start = platform_monotonic_seconds();
+    thrd_t threads[MAX_VERIFY_WORKERS];
+    int started = 0;
+    for (; started < worker_count; ++started) {
+        if (thrd_create(&threads[started], verify_worker, &pool) != thrd_success) break;
+    }
+    if (started == 0) {
+        verify_worker(&pool); /* no threads available: verify on this one */
+    }
+    for (int i = 0; i < started; ++i) {
+        thrd_join(threads[i], NULL);
+    }
+    totals.seconds = platform_monotonic_seconds() - start;
+    totals.worker_count = started > 0 ? started : 1;
+    totals.bytes_hashed = atomic_load(&pool.bytes_hashed);
+    totals.files_checked = pool.job_count;
+
+    printf("\nLibrary verification (%d files, %d workers):\n", pool.job_count, totals.worker_count);
+    for (int i = 0; i < pool.job_count; ++i) {
+        verify_status_t status = pool.jobs[i].status;
+        totals.status_counts[status]++;
+        if (status != VERIFY_OK) {
+            printf("  %-12s %s\n", status_name(status), pool.jobs[i].metadata->encrypted_filename);
+        }
+    }
+    double mb = (double)totals.bytes_hashed / (1024.0 * 1024.0);
+    printf("OK: %d  Missing: %d  Truncated: %d  Modified: %d  Unverifiable: %d\n",
+           totals.status_counts[VERIFY_OK], totals.status_counts[VERIFY_MISSING],
+           totals.status_counts[VERIFY_TRUNCATED], totals.status_counts[VERIFY_MODIFIED],
+           totals.status_counts[VERIFY_UNVERIFIABLE]);
+    printf("Hashed %.1f MB in %.3f s (%.1f MB/s, %.0f files/s)\n", mb, totals.seconds,
+           totals.seconds > 0 ? mb / totals.seconds : 0.0,
+           totals.seconds > 0 ? pool.job_count / totals.seconds : 0.0);
+
+    free(pool.jobs);
+    if (have_store) chunk_store_close(&store);
+    if (report) *report = totals;
+
+    int failed = totals.status_counts[VERIFY_MISSING] + totals.status_counts[VERIFY_TRUNCATED] +
+                 totals.status_counts[VERIFY_MODIFIED];
+    return failed > 0 ? ERROR_CHECKSUM_MISMATCH : SUCCESS;
+}
@@ -0,0 +1,68 @@
+/*
+ * verify.h
+ * Header file for library integrity verification
+ * Chu-Cheng Yu and contributors
+ * October 2025
+ * This header defines the verify operation, which checks that every
+ * encrypted file tracked in the library still exists and still matches the
+ * ciphertext checksum recorded in its container, without needing passwords.
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "ccrypt.h"
+#include "chunk_store.h"
+
+/* Result of checking one encrypted file */
+typedef enum {
+    VERIFY_OK = 0,
+    VERIFY_MISSING,      /* file, or a chunk its recipe names, cannot be found */
+    VERIFY_TRUNCATED,    /* shorter than recorded or payload ends early */
+    VERIFY_MODIFIED,     /* checksum or size does not match */
+    VERIFY_UNVERIFIABLE  /* written before checksums were recorded */
+} verify_status_t;
+
+/*
+ * verify_report
+ * Totals and throughput for a verify run
+ */
+typedef struct {
+    int files_checked;
+    int status_counts[VERIFY_UNVERIFIABLE + 1]; /* indexed by verify_status_t */
+    long long bytes_hashed;
+    double seconds;
+    int worker_count;
+} verify_report_t;
+
+/* ========================================================================
+ * VERIFICATION FUNCTION DECLARATIONS
+ * ======================================================================== */
+
+/*
+ * Check one encrypted file against its container checksum, or a chunk store
+ * recipe against the store's index (chunk contents need the password)
+ * metadata Library entry for the file
+ * store Open chunk store recipes are checked against, NULL if there is none
+ * buffer Scratch buffer used for reading
+ * buffer_size Size of the scratch buffer (at least CHUNK_SIZE)
+ * bytes_hashed Out parameter incremented by the bytes read and hashed
+ * verify_status_t result for the file
+ */
+verify_status_t verify_encrypted_file(const file_metadata_t *metadata, const chunk_store_t *store,
+                                      unsigned char *buffer, size_t buffer_size,
+                                      long long *bytes_hashed);
+
+/*
+ * Verify every file in the library with a bounded pool of worker threads,
+ * largest files first so the pool stays balanced, and print a report of
+ * missing, truncated and modified files with throughput figures
+ * library Pointer to the encryption library
+ * worker_count Number of worker threads (0 picks one per processor)
+ * report Optional pointer to receive the totals
+ * SUCCESS if every file verified, ERROR_CHECKSUM_MISMATCH if any did not,
+ * or another error code on failure
+ */
+int verify_library(encryption_library_t *library, int worker_count, verify_report_t *report);
+
+#endif /* VERIFY_H */